@@ -0,0 +1,163 @@
+﻿using OpenTK;
+using OpenTK.Graphics.OpenGL4;
+using System;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// World-space cache of the AO of the static scene (compute_aocache.c). The corners of a
+    /// grid of Const.AO_CACHE_CELL cells around the camera keep calcAO() of the closest surface,
+    /// shading interpolates eight of them instead of marching five samples per pixel.
+    /// Only corners of cells the last frame has seen are filled, at most
+    /// Const.AO_CACHE_FILL_BUDGET per frame. An edit of the scene starts a new generation,
+    /// which leaves every stored corner stale without clearing the texture. Only when the
+    /// generations wrap around the texture is cleared, a corner could match again otherwise.
+    /// </summary>
+    public class AoCache
+    {
+        const int IMAGE_UNIT = 0;
+        const int FILLS_BINDING = 10;
+        const int GROUP_SIZE = 8;           // local_size_x and _y of compute_aocache.c
+        const int GENERATIONS = 2048;       // 11 bits of the stamps, 0 marks the cleared texture
+
+        int h_fill;
+        SceneUniforms uniforms;
+
+        int uf_SceneDistance,
+            uf_FillBudget,
+            uf_PixelStride;
+
+        int tex_cache,
+            ssbo_fills;
+
+        int generation,
+            sceneVersion = -1,
+            sculptVersion = -1;
+
+        public bool IsStarted => h_fill != 0;
+
+        /// <summary>
+        /// Shading reads the cache, calcAO() per pixel otherwise. Set by the input thread.
+        /// </summary>
+        public bool Enabled { get; set; } = true;
+
+        public void Start()
+        {
+            h_fill = ShaderLoader.Link(
+                ShaderLoader.Compile(ShaderType.ComputeShader, Const.COMPUTE_AOCACHE_FILENAME));
+
+            ShaderLoader.BindMapBlock(h_fill);
+            uniforms = new SceneUniforms(h_fill);
+
+            uf_SceneDistance = GL.GetUniformLocation(h_fill, "sceneDistance");
+            uf_FillBudget = GL.GetUniformLocation(h_fill, "uFillBudget");
+            uf_PixelStride = GL.GetUniformLocation(h_fill, "uPixelStride");
+
+            // zero is no generation, nothing is filled
+            tex_cache = GL.GenTexture();
+            GL.BindTexture(TextureTarget.Texture3D, tex_cache);
+            GL.TexImage3D(
+                TextureTarget.Texture3D, 0,
+                PixelInternalFormat.R32ui,
+                Const.AO_CACHE_X, Const.AO_CACHE_Y, Const.AO_CACHE_Z, 0,
+                PixelFormat.RedInteger, PixelType.UnsignedInt,
+                new uint[Const.AO_CACHE_X * Const.AO_CACHE_Y * Const.AO_CACHE_Z]);
+
+            // integer textures are incomplete with linear filters
+            GL.TexParameter(TextureTarget.Texture3D, TextureParameterName.TextureMinFilter, (int)TextureMinFilter.Nearest);
+            GL.TexParameter(TextureTarget.Texture3D, TextureParameterName.TextureMagFilter, (int)TextureMagFilter.Nearest);
+            GL.BindTexture(TextureTarget.Texture3D, 0);
+
+            ssbo_fills = GL.GenBuffer();
+            GL.BindBuffer(BufferTarget.ShaderStorageBuffer, ssbo_fills);
+            GL.BufferData(BufferTarget.ShaderStorageBuffer, sizeof(uint), IntPtr.Zero, BufferUsageHint.DynamicDraw);
+            GL.BindBuffer(BufferTarget.ShaderStorageBuffer, 0);
+        }
+
+        /// <summary>
+        /// First cell of the window, in cells. It follows the camera cell by cell,
+        /// the texture wraps around, so only the cells entering the window are lost.
+        /// </summary>
+        static Vector3 WindowCorner(Vector3 eye)
+        {
+            return new Vector3(
+                (float)Math.Floor(eye.X / Const.AO_CACHE_CELL) - Const.AO_CACHE_X / 2,
+                Const.AO_CACHE_FIRST_Y,
+                (float)Math.Floor(eye.Z / Const.AO_CACHE_CELL) - Const.AO_CACHE_Z / 2);
+        }
+
+        /// <summary>
+        /// Sets the cache window of the frame, a new scene or sculpt version starts a new generation
+        /// </summary>
+        internal void OnFrame(ref FrameState frame)
+        {
+            if (!IsStarted || !Enabled)
+            {
+                frame.AoCache = Vector4.Zero;
+                return;
+            }
+
+            if (sceneVersion != frame.SceneVersion || sculptVersion != frame.SculptVersion)
+            {
+                sceneVersion = frame.SceneVersion;
+                sculptVersion = frame.SculptVersion;
+                generation = generation % (GENERATIONS - 1) + 1;
+
+                // corners of the last first generation would read as filled
+                if (generation == 1)
+                    GL.ClearTexImage(tex_cache, 0, PixelFormat.RedInteger, PixelType.UnsignedInt, IntPtr.Zero);
+            }
+
+            frame.AoCache = new Vector4(WindowCorner(frame.Origin), generation);
+        }
+
+        /// <summary>
+        /// Fills the missing corners around the surfaces of the last sample and binds the cache
+        /// </summary>
+        /// <param name="sceneDistance">Ray distance of the last sample, FrameCache.DistanceTexture</param>
+        internal void Fill(FrameState frame, int sceneDistance)
+        {
+            if (frame.AoCache.W == 0f)
+                return;
+
+            GL.UseProgram(h_fill);
+            uniforms.Set(frame);
+            GL.Uniform1(uf_FillBudget, Const.AO_CACHE_FILL_BUDGET);
+            GL.Uniform1(uf_PixelStride, Const.AO_CACHE_PIXEL_STRIDE);
+
+            GL.ActiveTexture(TextureUnit.Texture0);
+            GL.BindTexture(TextureTarget.Texture2D, sceneDistance);
+            GL.Uniform1(uf_SceneDistance, 0);
+
+            uint fills = 0;
+            GL.BindBuffer(BufferTarget.ShaderStorageBuffer, ssbo_fills);
+            GL.BufferSubData(BufferTarget.ShaderStorageBuffer, IntPtr.Zero, sizeof(uint), ref fills);
+            GL.BindBuffer(BufferTarget.ShaderStorageBuffer, 0);
+            GL.BindBufferBase(BufferRangeTarget.ShaderStorageBuffer, FILLS_BINDING, ssbo_fills);
+
+            GL.BindImageTexture(IMAGE_UNIT, tex_cache, 0, true, 0, TextureAccess.ReadWrite, SizedInternalFormat.R32ui);
+
+            int stride = GROUP_SIZE * Const.AO_CACHE_PIXEL_STRIDE;
+            GL.DispatchCompute((frame.Width + stride - 1) / stride, (frame.Height + stride - 1) / stride, 1);
+            GL.MemoryBarrier(MemoryBarrierFlags.TextureFetchBarrierBit | MemoryBarrierFlags.ShaderImageAccessBarrierBit);
+
+            GL.BindTexture(TextureTarget.Texture2D, 0);
+            GL.UseProgram(0);
+
+            GL.ActiveTexture(TextureUnit.Texture0 + Const.AO_CACHE_TEXTURE_UNIT);
+            GL.BindTexture(TextureTarget.Texture3D, tex_cache);
+            GL.ActiveTexture(TextureUnit.Texture0);
+        }
+
+        internal void Stop()
+        {
+            if (!IsStarted)
+                return;
+
+            GL.DeleteTexture(tex_cache);
+            GL.DeleteBuffers(1, ref ssbo_fills);
+            GL.DeleteProgram(h_fill);
+            h_fill = 0;
+        }
+    }
+}
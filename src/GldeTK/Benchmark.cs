@@ -0,0 +1,696 @@
+﻿using OpenTK;
+using System;
+using System.Diagnostics;
+using System.IO;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Offline measurements on the CPU reference paths, run with --bench [name]
+    /// and redirect the output: GldeTK.exe --bench culling > bench.txt
+    /// </summary>
+    public static class Benchmark
+    {
+        const int WIDTH = 160;
+        const int HEIGHT = 120;
+
+        public static void Run(string[] args)
+        {
+            string name = args.Length > 1 ? args[1] : "all";
+
+            if (name == "all" || name == "culling")
+                Culling();
+
+            if (name == "all" || name == "lipschitz")
+                LipschitzBounds();
+
+            if (name == "all" || name == "ccd")
+                ContinuousCollision();
+
+            if (name == "all" || name == "bodies")
+                Bodies();
+
+            if (name == "all" || name == "mesh")
+                Polygonize();
+
+            if (name == "all" || name == "pack")
+                Pack();
+
+            if (name == "all" || name == "stream")
+                Streaming();
+
+            if (name == "all" || name == "sculpt")
+                Sculpting();
+
+            if (name == "all" || name == "blend")
+                Blending();
+        }
+
+        /// <summary>
+        /// March steps skipped by the interval culling of empty tile depth ranges
+        /// </summary>
+        static void Culling()
+        {
+            Console.WriteLine($"Interval tile culling, {WIDTH}x{HEIGHT}, {Const.BIN_TILE_SIZE}px tiles");
+            Console.WriteLine("scene            empty tiles   steps full   steps culled   skipped   culling ms");
+
+            var views = new[] {
+                new { Name = "ahead", Camera = new Camera(new Vector3(3, 1, 0), new Vector3(-1, 0, 0), Vector3.UnitY) },
+                new { Name = "up", Camera = new Camera(new Vector3(3, 1, 0), Vector3.Normalize(new Vector3(-0.8f, 0.6f, 0)), Vector3.UnitY) },
+                new { Name = "down", Camera = new Camera(new Vector3(3, 4, 0), Vector3.Normalize(new Vector3(-0.6f, -0.8f, 0)), Vector3.UnitY) }
+            };
+
+            foreach (var view in views)
+                foreach (int count in Const.SCENE_FIELD_SIZES)
+                {
+                    var scene = new SdScene();
+                    scene.SetElements(SdScene.Scatter(count, view.Camera.Origin, Const.SCENE_FIELD_EXTENT));
+
+                    CullingScene($"{view.Name} {count}el", scene, view.Camera);
+                }
+        }
+
+        /// <summary>
+        /// Overshoot check of the distance bounds in lipschitz.c, raw fields for comparison
+        /// </summary>
+        static void LipschitzBounds()
+        {
+            const int SAMPLES = 2000;
+
+            Console.WriteLine($"Lipschitz bounds, {SAMPLES} samples outside the surface");
+            Console.WriteLine("field                 bound L   max slope   overshoots   step/value");
+
+            Func<Vector3, float> scherk = Lipschitz.ScherkDe,
+                scherkSin = Lipschitz.ScherkSin,
+                kTower = Lipschitz.KTower,
+                planeSin = p => Lipschitz.SdPlaneSin(p, 3f);
+
+            float scherkSinGlobal = Lipschitz.ScherkSinLipschitz(Vector3.Zero, 1f);
+
+            var cases = new[] {
+                new { Name = "ScherkDe raw", L = 1f, Field = scherk, Bound = scherk },
+                new { Name = "ScherkDe global", L = Lipschitz.SCHERK, Field = scherk, Bound = (Func<Vector3, float>)(p => scherk(p) / Lipschitz.SCHERK) },
+                new { Name = "ScherkDe gradient", L = Lipschitz.SCHERK, Field = scherk, Bound = (Func<Vector3, float>)(p => Lipschitz.GradientBound(scherk, p, Lipschitz.SCHERK)) },
+                new { Name = "scherkSin raw", L = 1f, Field = scherkSin, Bound = scherkSin },
+                new { Name = "scherkSin global", L = scherkSinGlobal, Field = scherkSin, Bound = (Func<Vector3, float>)(p => scherkSin(p) / scherkSinGlobal) },
+                new { Name = "scherkSin local", L = scherkSinGlobal, Field = scherkSin, Bound = (Func<Vector3, float>)Lipschitz.ScherkSinLocalBound },
+                new { Name = "scherkSin gradient", L = scherkSinGlobal, Field = scherkSin, Bound = (Func<Vector3, float>)(p => Lipschitz.GradientBound(scherkSin, p, scherkSinGlobal)) },
+                new { Name = "kTower raw", L = 1f, Field = kTower, Bound = kTower },
+                new { Name = "kTower global", L = Lipschitz.KTOWER, Field = kTower, Bound = (Func<Vector3, float>)(p => kTower(p) / Lipschitz.KTOWER) },
+                new { Name = "kTower gradient", L = Lipschitz.KTOWER, Field = kTower, Bound = (Func<Vector3, float>)(p => Lipschitz.GradientBound(kTower, p, Lipschitz.KTOWER)) },
+                new { Name = "sdPlaneSin raw", L = 1f, Field = planeSin, Bound = planeSin },
+                new { Name = "sdPlaneSin global", L = Lipschitz.PLANE_SIN, Field = planeSin, Bound = (Func<Vector3, float>)(p => planeSin(p) / Lipschitz.PLANE_SIN) }
+            };
+
+            foreach (var c in cases)
+            {
+                Lipschitz.Report report = Lipschitz.Validate(c.Field, c.Bound, Vector3.Zero, 3f, SAMPLES);
+
+                Console.WriteLine(
+                    $"{c.Name,-20} {c.L,8:0.000} {report.MaxSlope,11:0.000} {100.0 * report.Overshoots / report.Samples,11:0.0}% {report.MeanStepRatio,12:0.000}");
+            }
+        }
+
+        /// <summary>
+        /// Tunneling of one input tick of motion at several speeds, the old
+        /// ray cast check against the conservative advancement sweeps
+        /// </summary>
+        static void ContinuousCollision()
+        {
+            const int MOVES = 2000;
+            const int PATH_SAMPLES = 256;
+            const float RADIUS = 0.25f;
+            const float CAPSULE_HEIGHT = 1.5f;
+            const float DT = Const.INPUT_UPDATE_INTERVAL / 1000f;
+
+            var scene = new SdScene();
+            scene.SetElements(SdScene.Scatter(64, Vector3.Zero, Const.SCENE_FIELD_EXTENT));
+            var physics = new Physics(scene);
+            var random = new Random(1);
+
+            Console.WriteLine($"Continuous collision, {MOVES} moves of {DT * 1000:0}ms, radius {RADIUS}");
+            Console.WriteLine("method            speed m/s   tunneled   contacts   stopped short   mean steps   us/move");
+
+            Vector3 axis = new Vector3(0f, CAPSULE_HEIGHT, 0f);
+
+            // true clearance of a moved shape, sampled densely along the path and the segment
+            Func<Vector3, Vector3, float, float> clearance = (start, motion, height) =>
+            {
+                float d = float.MaxValue;
+                for (int i = 0; i <= PATH_SAMPLES; i++)
+                    for (float h = 0f; h <= height; h += RADIUS * 0.25f)
+                        d = Math.Min(d, physics.Map(start + motion * i / PATH_SAMPLES + new Vector3(0f, h, 0f)) - RADIUS);
+                return d;
+            };
+
+            foreach (float speed in new[] { 5f, 20f, Const.PHYS_TERMINAL_FALL_SPEED, 200f, 1000f })
+            {
+                var starts = new Vector3[MOVES];
+                var motions = new Vector3[MOVES];
+
+                for (int i = 0; i < MOVES; i++)
+                {
+                    do
+                        starts[i] = new Vector3(
+                            (float)(random.NextDouble() * 2 - 1) * Const.SCENE_FIELD_EXTENT,
+                            (float)random.NextDouble() * 6f + RADIUS,
+                            (float)(random.NextDouble() * 2 - 1) * Const.SCENE_FIELD_EXTENT);
+                    while (physics.Map(starts[i]) < RADIUS * 2f || physics.Map(starts[i] + axis) < RADIUS * 2f);
+
+                    Vector3 dir = Vector3.Normalize(new Vector3(
+                        (float)random.NextDouble() * 2 - 1,
+                        (float)random.NextDouble() * 2 - 1.5f,
+                        (float)random.NextDouble() * 2 - 1));
+                    motions[i] = dir * speed * DT;
+                }
+
+                var methods = new[] {
+                    new { Name = "cast ray", Height = 0f, Move = (Func<Vector3, Vector3, SweepHit>)((p, v) =>
+                        physics.CastRay(p, Vector3.NormalizeFast(v)) <= RADIUS
+                            ? new SweepHit { Hit = true, Steps = 1 }
+                            : new SweepHit { Time = 1f, Steps = 1 }) },
+                    new { Name = "sphere sweep", Height = 0f, Move = (Func<Vector3, Vector3, SweepHit>)((p, v) =>
+                        physics.SweepSphere(p, RADIUS, v)) },
+                    new { Name = "capsule sweep", Height = CAPSULE_HEIGHT, Move = (Func<Vector3, Vector3, SweepHit>)((p, v) =>
+                        physics.SweepCapsule(p, p + axis, RADIUS, v)) }
+                };
+
+                foreach (var method in methods)
+                {
+                    var hits = new SweepHit[MOVES];
+
+                    var watch = Stopwatch.StartNew();
+                    for (int i = 0; i < MOVES; i++)
+                        hits[i] = method.Move(starts[i], motions[i]);
+                    watch.Stop();
+
+                    int tunneled = 0,
+                        contacts = 0,
+                        short_ = 0;
+                    long steps = 0;
+
+                    for (int i = 0; i < MOVES; i++)
+                    {
+                        if (clearance(starts[i], motions[i] * hits[i].Time, method.Height) < 0f)
+                            tunneled++;
+                        if (hits[i].Hit)
+                            contacts++;
+                        else if (hits[i].Time < 1f)
+                            short_++;
+                        steps += hits[i].Steps;
+                    }
+
+                    Console.WriteLine(
+                        $"{method.Name,-16} {speed,10:0} {100.0 * tunneled / MOVES,9:0.0}% {100.0 * contacts / MOVES,9:0.0}% {100.0 * short_ / MOVES,14:0.0}% {(double)steps / MOVES,12:0.0} {watch.Elapsed.TotalMilliseconds * 1000 / MOVES,9:0.0}");
+                }
+            }
+        }
+
+        /// <summary>
+        /// Rigid body steps per millisecond by body count, one worker against every core
+        /// </summary>
+        static void Bodies()
+        {
+            const int WARMUP_STEPS = 20;
+            const int STEPS = 100;
+            const float DT = Const.INPUT_UPDATE_INTERVAL / 1000f;
+
+            var scene = new SdScene();
+            scene.SetElements(SdScene.Scatter(64, Vector3.Zero, Const.SCENE_FIELD_EXTENT));
+            var physics = new Physics(scene);
+
+            Console.WriteLine($"Rigid bodies, {STEPS} steps of {DT * 1000:0}ms after {WARMUP_STEPS} to settle, {Environment.ProcessorCount} cores");
+            Console.WriteLine("bodies   workers   ms/step   bodies/ms   speedup");
+
+            foreach (int count in new[] { 256, 1024, Const.BODIES_MAX, 4 * Const.BODIES_MAX })
+            {
+                double serial = 0;
+
+                foreach (int workers in new[] { 1, Environment.ProcessorCount })
+                {
+                    var random = new Random(1);
+                    var bodies = new RigidBodies(physics, count) { MaxDegreeOfParallelism = workers };
+
+                    // a falling cloud, dense enough to keep bodies in contact
+                    float extent = (float)Math.Pow(count, 1.0 / 3.0) * Const.BODIES_MAX_RADIUS * 2f;
+                    for (int i = 0; i < count; i++)
+                        bodies.Add(
+                            new Vector3(
+                                (float)(random.NextDouble() * 2 - 1) * extent,
+                                (float)random.NextDouble() * extent + 2f,
+                                (float)(random.NextDouble() * 2 - 1) * extent),
+                            new Vector3((float)random.NextDouble() - 0.5f, 0f, (float)random.NextDouble() - 0.5f),
+                            0.1f + (float)random.NextDouble() * (Const.BODIES_MAX_RADIUS - 0.1f));
+
+                    for (int i = 0; i < WARMUP_STEPS; i++)
+                        bodies.Step(DT);
+
+                    var watch = Stopwatch.StartNew();
+                    for (int i = 0; i < STEPS; i++)
+                        bodies.Step(DT);
+                    watch.Stop();
+
+                    double ms = watch.Elapsed.TotalMilliseconds / STEPS;
+                    if (workers == 1)
+                        serial = ms;
+
+                    Console.WriteLine($"{count,6} {workers,9} {ms,9:0.00} {count / ms,11:0} {serial / ms,9:0.0}x");
+                }
+            }
+
+            // narrowphase world distance, one body at a time against a batch in SIMD lanes
+            const int POINTS = Const.BODIES_MAX;
+            const int REPEATS = 50;
+            var rng = new Random(2);
+            float[] x = new float[POINTS], y = new float[POINTS], z = new float[POINTS],
+                lanes = new float[POINTS], scalar = new float[POINTS];
+            for (int i = 0; i < POINTS; i++)
+            {
+                x[i] = (float)(rng.NextDouble() * 2 - 1) * Const.SCENE_FIELD_EXTENT;
+                y[i] = (float)rng.NextDouble() * 8f - 1f;
+                z[i] = (float)(rng.NextDouble() * 2 - 1) * Const.SCENE_FIELD_EXTENT;
+            }
+
+            var scalarWatch = Stopwatch.StartNew();
+            for (int r = 0; r < REPEATS; r++)
+                for (int i = 0; i < POINTS; i++)
+                    scalar[i] = physics.MapScene(new Vector3(x[i], y[i], z[i]));
+            scalarWatch.Stop();
+
+            var lanesWatch = Stopwatch.StartNew();
+            for (int r = 0; r < REPEATS; r++)
+                physics.MapScene(x, y, z, lanes, 0, POINTS);
+            lanesWatch.Stop();
+
+            float error = 0f;
+            for (int i = 0; i < POINTS; i++)
+                error = Math.Max(error, Math.Abs(lanes[i] - scalar[i]));
+
+            Console.WriteLine();
+            Console.WriteLine($"World distance, {POINTS} bodies, {System.Numerics.Vector<float>.Count} lanes");
+            Console.WriteLine("method   bodies/ms   max error");
+            Console.WriteLine($"scalar {POINTS * REPEATS / scalarWatch.Elapsed.TotalMilliseconds,11:0} {0f,11:0.000000}");
+            Console.WriteLine($"lanes  {POINTS * REPEATS / lanesWatch.Elapsed.TotalMilliseconds,11:0} {error,11:0.000000}");
+        }
+
+        /// <summary>
+        /// Octree cells per second and memory of the polygonization of Physics.Map
+        /// </summary>
+        static void Polygonize()
+        {
+            var scene = new SdScene();
+            scene.SetElements(SdScene.Scatter(64, Vector3.Zero, Const.SCENE_FIELD_EXTENT));
+            var physics = new Physics(scene);
+
+            Console.WriteLine($"Polygonization of Physics.Map, {Const.MESH_SIZE}m cube, 64 elements, {Environment.ProcessorCount} cores");
+            Console.WriteLine("depth   cell cm   workers      nodes     leaves   triangles         ms   Mnodes/s   Mleaves/s   mesh MB   arena MB   speedup");
+
+            foreach (int depth in new[] { 6, 7, 8 })
+            {
+                double serial = 0;
+
+                foreach (int workers in new[] { 1, Environment.ProcessorCount })
+                {
+                    var polygonizer = new Polygonizer(physics.Map, Const.MESH_ORIGIN, Const.MESH_SIZE, depth) { MaxDegreeOfParallelism = workers };
+
+                    var watch = Stopwatch.StartNew();
+                    TriangleMesh mesh = polygonizer.Run();
+                    watch.Stop();
+
+                    double ms = watch.Elapsed.TotalMilliseconds;
+                    if (workers == 1)
+                        serial = ms;
+
+                    Console.WriteLine(
+                        $"{depth,5} {Const.MESH_SIZE / (1 << depth) * 100,9:0.0} {workers,9} {polygonizer.Nodes,10} {polygonizer.Leaves,10} {mesh.TriangleCount,11} {ms,10:0.0} " +
+                        $"{polygonizer.Nodes / ms / 1000,10:0.00} {polygonizer.Leaves / ms / 1000,11:0.00} {mesh.Bytes / 1048576.0,9:0.0} {polygonizer.ArenaBytes / 1048576.0,10:0.0} {serial / ms,8:0.0}x");
+                }
+            }
+        }
+
+        /// <summary>
+        /// Scene pack of the largest element block and a baked field of growing size: writing,
+        /// opening the mapping, reading the elements and streaming the field from the mapping
+        /// against reading the whole file into managed arrays
+        /// </summary>
+        static void Pack()
+        {
+            const int CHUNK = 1 << 20;
+
+            string path = Path.GetTempFileName();
+            var elements = SdScene.Scatter(SdScene.MAX_ELEMENTS, Vector3.Zero, Const.SCENE_FIELD_EXTENT);
+            var chunk = new byte[CHUNK];
+
+            Console.WriteLine($"Scene pack, {SdScene.MAX_ELEMENTS} elements and a baked field, {path}");
+            Console.WriteLine("field        file MB   write ms   open ms   block us   elements us   mapped GB/s   read all GB/s");
+
+            // the first size pays for the JIT
+            foreach (int resolution in new[] { 16, 64, 128, 256 })
+            {
+                var builder = new ScenePackBuilder();
+                builder.AddMetadata("name", "bench");
+                builder.AddElements(new SdScene().Parameters, elements);
+                builder.AddField("bench", resolution, resolution, resolution, Const.MESH_ORIGIN, Const.MESH_SIZE / (resolution - 1),
+                    new float[resolution * resolution * resolution]);
+
+                var watch = Stopwatch.StartNew();
+                long bytes = builder.Save(path);
+                double writeMs = watch.Elapsed.TotalMilliseconds;
+
+                watch.Restart();
+                using (ScenePack pack = ScenePack.Open(path))
+                {
+                    double openMs = watch.Elapsed.TotalMilliseconds;
+
+                    watch.Restart();
+                    pack.GetElementsBlock(out _);
+                    double blockUs = watch.Elapsed.TotalMilliseconds * 1000;
+
+                    watch.Restart();
+                    pack.ReadElements(out _);
+                    double elementsUs = watch.Elapsed.TotalMilliseconds * 1000;
+
+                    // what the driver does with the mapped span: one sequential pass over the pages
+                    pack.GetField("bench", out ScenePack.Field field);
+                    pack.Find(ScenePackSection.Field, "bench", out ScenePack.Section section);
+                    long fieldBytes = field.Count * sizeof(float);
+
+                    watch.Restart();
+                    for (long offset = 0; offset < fieldBytes; offset += CHUNK)
+                        Marshal.Copy(new IntPtr(field.Data.ToInt64() + offset), chunk, 0, (int)Math.Min(CHUNK, fieldBytes - offset));
+                    double mappedGBs = fieldBytes / watch.Elapsed.TotalSeconds / 1e9;
+
+                    // the stream path: the file into a managed array, then the samples into their own
+                    watch.Restart();
+                    byte[] file = File.ReadAllBytes(path);
+                    var samples = new float[field.Count];
+                    Buffer.BlockCopy(file, (int)section.Offset + ScenePack.FIELD_HEADER_SIZE, samples, 0, (int)fieldBytes);
+                    double readAllGBs = fieldBytes / watch.Elapsed.TotalSeconds / 1e9;
+
+                    Console.WriteLine(
+                        $"{resolution + "^3",-10} {bytes / 1048576.0,9:0.0} {writeMs,10:0.0} {openMs,9:0.00} {blockUs,10:0.0} {elementsUs,13:0.0} {mappedGBs,13:0.00} {readAllGBs,15:0.00}");
+                }
+            }
+
+            File.Delete(path);
+        }
+
+        /// <summary>
+        /// Residency misses of the world chunks along a straight flight, chunk loads delayed
+        /// as if read from a disk, with and without the prefetch along the velocity
+        /// </summary>
+        static void Streaming()
+        {
+            const int LOAD_MS = 30;
+            const float SECONDS = 1.5f;
+
+            Console.WriteLine($"World streaming, {Const.STREAM_CHUNK_SIZE}m chunks, {Const.STREAM_POOL_CHUNKS} pool slots, {LOAD_MS}ms loads, {SECONDS}s flights");
+            Console.WriteLine("speed m/s   prefetch   updates   misses   misses/update   loads   evictions   prefetched   update us");
+
+            foreach (float speed in new[] { 5f, 15f, 40f })
+                foreach (bool prefetch in new[] { false, true })
+                {
+                    var scene = new SdScene();
+                    var streamer = new WorldStreamer(scene, (x, z) =>
+                    {
+                        Thread.Sleep(LOAD_MS);
+                        return WorldStreamer.Generate(x, z);
+                    }) { Prefetch = prefetch };
+
+                    foreach (string counter in new[] { Const.PROFILER_STREAM_MISSES, Const.PROFILER_STREAM_LOADS, Const.PROFILER_STREAM_EVICTIONS, Const.PROFILER_STREAM_PREFETCH_HITS })
+                        Profiler.Take(counter);
+
+                    // the first chunks are in place before the flight starts
+                    streamer.Toggle();
+                    for (int i = 0; i < 10; i++)
+                    {
+                        streamer.Update(Vector3.Zero, Const.INPUT_UPDATE_INTERVAL / 1000f);
+                        Thread.Sleep(LOAD_MS);
+                    }
+                    Profiler.Take(Const.PROFILER_STREAM_MISSES);
+
+                    var clock = Stopwatch.StartNew();
+                    var updateTime = new Stopwatch();
+                    double last = 0;
+                    int updates = 0;
+
+                    while (clock.Elapsed.TotalSeconds < SECONDS)
+                    {
+                        double now = clock.Elapsed.TotalSeconds;
+                        var origin = new Vector3((float)now * speed, 1f, 0.3f * (float)now * speed);
+
+                        updateTime.Start();
+                        streamer.Update(origin, (float)(now - last));
+                        updateTime.Stop();
+
+                        last = now;
+                        updates++;
+                        Thread.Sleep((int)Const.INPUT_UPDATE_INTERVAL);
+                    }
+
+                    long misses = Profiler.Take(Const.PROFILER_STREAM_MISSES);
+
+                    Console.WriteLine(
+                        $"{speed,9:0} {(prefetch ? "on" : "off"),10} {updates,9} {misses,8} {(double)misses / updates,15:0.00} {Profiler.Take(Const.PROFILER_STREAM_LOADS),7} " +
+                        $"{Profiler.Take(Const.PROFILER_STREAM_EVICTIONS),11} {Profiler.Take(Const.PROFILER_STREAM_PREFETCH_HITS),12} {updateTime.Elapsed.TotalMilliseconds * 1000 / updates,11:0.0}");
+                }
+        }
+
+        /// <summary>
+        /// Edits applied one at a time until their bricks are baked, and the brick field
+        /// against the whole edit log evaluated at every point
+        /// </summary>
+        static void Sculpting()
+        {
+            const int QUERIES = 20000;
+            const float EXTENT = 20f;
+
+            Console.WriteLine($"Sculpt, {Const.SCULPT_BRICK_CELLS}^3 cells of {Const.SCULPT_CELL}m per brick, {Sculpt.BRICK_BYTES}B a brick, {QUERIES} queries within {Const.SCULPT_MARGIN}m of the surface");
+            Console.WriteLine("edits   ms/edit   max ms   bakes/edit   KB/edit   bricks   brick us   log us   mean error m   max error m");
+
+            foreach (int count in new[] { 16, 64, 256 })
+            {
+                var random = new Random(count);
+                var sculpt = new Sculpt();
+                Profiler.Take(Const.PROFILER_SCULPT_BAKES);
+
+                double total = 0,
+                    worst = 0;
+
+                for (int i = 0; i < count; i++)
+                {
+                    var position = new Vector3(
+                        ((float)random.NextDouble() * 2f - 1f) * EXTENT,
+                        (float)random.NextDouble() * 2f - 1f,
+                        ((float)random.NextDouble() * 2f - 1f) * EXTENT);
+                    float radius = 0.3f + (float)random.NextDouble() * 1.2f;
+
+                    var clock = Stopwatch.StartNew();
+                    sculpt.Add(new SculptEdit(
+                        (SculptOp)random.Next(4),
+                        new SdElement(SdElementType.Sphere, position, new Vector3(radius)),
+                        Const.SCULPT_SMOOTHING));
+
+                    while (sculpt.Baking > 0)
+                        Thread.Yield();
+
+                    double ms = clock.Elapsed.TotalMilliseconds;
+                    total += ms;
+                    worst = Math.Max(worst, ms);
+                }
+
+                long bakes = Profiler.Take(Const.PROFILER_SCULPT_BAKES);
+                SculptEdit[] log = sculpt.CopyEdits();
+
+                // points near the surface, where the bricks are not clamped
+                var points = new Vector3[QUERIES];
+                for (int i = 0; i < QUERIES; )
+                {
+                    var p = new Vector3(
+                        ((float)random.NextDouble() * 2f - 1f) * EXTENT,
+                        ((float)random.NextDouble() * 2f - 1f) * 2f,
+                        ((float)random.NextDouble() * 2f - 1f) * EXTENT);
+
+                    if (Math.Abs(Sculpt.Evaluate(log, p)) < Const.SCULPT_MARGIN)
+                        points[i++] = p;
+                }
+
+                float sum = 0f;
+                var brickTime = Stopwatch.StartNew();
+                foreach (Vector3 p in points)
+                    sum += sculpt.Distance(p);
+                brickTime.Stop();
+
+                var logTime = Stopwatch.StartNew();
+                foreach (Vector3 p in points)
+                    sum -= Sculpt.Evaluate(log, p);
+                logTime.Stop();
+
+                double error = 0,
+                    maxError = 0;
+                foreach (Vector3 p in points)
+                {
+                    double e = Math.Abs(sculpt.Distance(p) - Sculpt.Evaluate(log, p));
+                    error += e;
+                    maxError = Math.Max(maxError, e);
+                }
+
+                Console.WriteLine(
+                    $"{count,5} {total / count,9:0.00} {worst,8:0.00} {(double)bakes / count,12:0.0} {(double)bakes * Sculpt.BRICK_BYTES / 1024 / count,9:0.0} {sculpt.BrickCount,8} " +
+                    $"{brickTime.Elapsed.TotalMilliseconds * 1000 / QUERIES,10:0.000} {logTime.Elapsed.TotalMilliseconds * 1000 / QUERIES,8:0.000} {error / QUERIES,14:0.0000} {maxError,13:0.0000}");
+            }
+        }
+
+        /// <summary>
+        /// Blended scenes of scattered elements evaluated with every operand, and with the
+        /// operands skipped whose bounding sphere proves them unable to change the result
+        /// </summary>
+        static void Blending()
+        {
+            const int QUERIES = 20000;
+            const float EXTENT = 20f;
+            const float R = 0.5f;
+
+            Console.WriteLine($"Blended scenes, ground and scattered elements blended {R}m wide, {QUERIES} queries within {EXTENT}m");
+            Console.WriteLine("scene                 elements   eager us   lazy us   speedup   skipped   max diff m   over");
+
+            var scenes = new[] {
+                new { Name = "round union", Op = 0, Blend = SdBlend.Round },
+                new { Name = "soft union", Op = 0, Blend = SdBlend.Soft },
+                new { Name = "chamfer union", Op = 0, Blend = SdBlend.Chamfer },
+                new { Name = "smooth union", Op = 0, Blend = SdBlend.Smooth },
+                new { Name = "round difference", Op = 1, Blend = SdBlend.Round },
+                new { Name = "smooth difference", Op = 1, Blend = SdBlend.Smooth },
+                new { Name = "round intersection", Op = 2, Blend = SdBlend.Round },
+                new { Name = "chamfer intersection", Op = 2, Blend = SdBlend.Chamfer }
+            };
+
+            foreach (int count in new[] { 16, 64, 256 })
+            {
+                SdElement[] elements = SdScene.Scatter(count, Vector3.Zero, EXTENT).ToArray();
+
+                var random = new Random(count);
+                var points = new Vector3[QUERIES];
+                for (int i = 0; i < QUERIES; i++)
+                    points[i] = new Vector3(
+                        ((float)random.NextDouble() * 2f - 1f) * EXTENT,
+                        (float)random.NextDouble() * 4f - 1f,
+                        ((float)random.NextDouble() * 2f - 1f) * EXTENT);
+
+                foreach (var scene in scenes)
+                {
+                    var eager = new float[QUERIES];
+                    var lazy = new float[QUERIES];
+                    long skipped = 0;
+
+                    var eagerTime = Stopwatch.StartNew();
+                    for (int i = 0; i < QUERIES; i++)
+                        eager[i] = Blended(scene.Op, scene.Blend, elements, points[i], R, false, ref skipped);
+                    eagerTime.Stop();
+
+                    skipped = 0;
+                    var lazyTime = Stopwatch.StartNew();
+                    for (int i = 0; i < QUERIES; i++)
+                        lazy[i] = Blended(scene.Op, scene.Blend, elements, points[i], R, true, ref skipped);
+                    lazyTime.Stop();
+
+                    // a skipped intersection gives a bound, never more than the full value, the rest
+                    // differ by the rounding of the blends
+                    float maxDiff = 0f;
+                    int over = 0;
+                    for (int i = 0; i < QUERIES; i++)
+                    {
+                        maxDiff = Math.Max(maxDiff, Math.Abs(lazy[i] - eager[i]));
+                        if (lazy[i] > eager[i] + 1e-4f)
+                            over++;
+                    }
+
+                    Console.WriteLine(
+                        $"{scene.Name,-21} {count,8} {eagerTime.Elapsed.TotalMilliseconds * 1000 / QUERIES,10:0.000} {lazyTime.Elapsed.TotalMilliseconds * 1000 / QUERIES,9:0.000} " +
+                        $"{eagerTime.Elapsed.TotalMilliseconds / lazyTime.Elapsed.TotalMilliseconds,8:0.0}x {100.0 * skipped / ((long)QUERIES * count),8:0.0}% {maxDiff,12:0.00000} {over,6}");
+                }
+            }
+        }
+
+        /// <summary>
+        /// Ground blended with every element (op 0 union, 1 difference), or with every element
+        /// cut to the layer 0 to 2m above it (op 2)
+        /// </summary>
+        static float Blended(int op, SdBlend blend, SdElement[] elements, Vector3 p, float r, bool lazy, ref long skipped)
+        {
+            float d = Physics.SdPlaneY(p);
+
+            foreach (SdElement element in elements)
+            {
+                float bound = element.BoundDistance(p);
+
+                if (op == 2)
+                {
+                    float layer = Math.Abs(p.Y - 1f) - 1f;
+                    if (lazy && SdOperators.IntersectionFar(layer, bound, r))
+                    {
+                        skipped++;
+                        d = Math.Min(d, bound);
+                    }
+                    else
+                        d = Math.Min(d, SdOperators.Intersection(blend, layer, element.Distance(p), r));
+                }
+                else if (lazy && (op == 0 ? SdOperators.UnionFar(d, bound, r) : SdOperators.DifferenceFar(d, bound, r)))
+                    skipped++;
+                else
+                    d = op == 0
+                        ? SdOperators.Union(blend, d, element.Distance(p), r)
+                        : SdOperators.Difference(blend, d, element.Distance(p), r);
+            }
+
+            return d;
+        }
+
+        static void CullingScene(string name, SdScene scene, Camera camera)
+        {
+            int tilesX = (WIDTH + Const.BIN_TILE_SIZE - 1) / Const.BIN_TILE_SIZE;
+            int tilesY = (HEIGHT + Const.BIN_TILE_SIZE - 1) / Const.BIN_TILE_SIZE;
+
+            var watch = Stopwatch.StartNew();
+            var ranges = new Vector2[tilesX * tilesY];
+            int empty = 0;
+
+            // no Sculpt and no bodies, the scene alone
+            var frame = new FrameState(0f, WIDTH, HEIGHT, camera, 0, 0);
+
+            for (int ty = 0; ty < tilesY; ty++)
+                for (int tx = 0; tx < tilesX; tx++)
+                {
+                    Vector2 range = IntervalCulling.TileRange(scene, ref frame, camera, tx, ty, WIDTH, HEIGHT);
+                    ranges[ty * tilesX + tx] = range;
+
+                    if (range.X >= IntervalCulling.MAX_DIST)
+                        empty++;
+                }
+            watch.Stop();
+
+            long stepsFull = 0,
+                stepsCulled = 0;
+
+            for (int y = 0; y < HEIGHT; y++)
+                for (int x = 0; x < WIDTH; x++)
+                {
+                    Vector3 rd = camera.GetRayDirection(x + 0.5f, y + 0.5f, WIDTH, HEIGHT);
+                    Vector2 range = ranges[(y / Const.BIN_TILE_SIZE) * tilesX + x / Const.BIN_TILE_SIZE];
+                    float k = Vector3.Dot(rd, camera.Projection.Row2);
+
+                    stepsFull += IntervalCulling.March(scene, camera.Origin, rd, 0f, IntervalCulling.MAX_DIST, out float t);
+                    stepsCulled += IntervalCulling.March(
+                        scene, camera.Origin, rd,
+                        Math.Min(range.X / k, IntervalCulling.MAX_DIST),
+                        Math.Min(range.Y / k, IntervalCulling.MAX_DIST),
+                        out t);
+                }
+
+            Console.WriteLine(
+                $"{name,-16} {empty,5}/{tilesX * tilesY,-7} {stepsFull,11} {stepsCulled,14} {100.0 * (stepsFull - stepsCulled) / Math.Max(stepsFull, 1),8:0.0}% {watch.Elapsed.TotalMilliseconds,12:0.0}");
+        }
+    }
+}
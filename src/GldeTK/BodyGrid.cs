@@ -0,0 +1,178 @@
+﻿using OpenTK;
+using OpenTK.Graphics.OpenGL4;
+using System;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Uploads the RigidBodies snapshot for mapBodies() of scene.c: the bodies as a texture buffer
+    /// and a uniform grid around the camera listing the bodies within half a cell of every cell
+    /// </summary>
+    public class BodyGrid
+    {
+        const int CELLS = Const.BODY_GRID_X * Const.BODY_GRID_Y * Const.BODY_GRID_Z;
+        const float MARGIN = 0.5f * Const.BODY_GRID_CELL;
+
+        int buf_bodies,
+            tex_bodies,
+            buf_grid,
+            tex_grid;
+
+        // copy of the published bodies, uploaded as is
+        Vector4[] bodies = new Vector4[0];
+        int bodyCount;
+
+        int[] cellCount = new int[CELLS];
+        uint[] grid = new uint[CELLS + 1];
+
+        int uploadedVersion = -1;
+        Vector3 uploadedOrigin;
+        int uploadedCount;
+
+        public bool IsStarted => buf_bodies != 0;
+
+        public void Start()
+        {
+            buf_bodies = GL.GenBuffer();
+            tex_bodies = GL.GenTexture();
+            buf_grid = GL.GenBuffer();
+            tex_grid = GL.GenTexture();
+        }
+
+        /// <summary>
+        /// Grid corner, snapped to whole cells so a moving camera keeps the cells of the bodies
+        /// </summary>
+        static Vector3 GridOrigin(Vector3 eye)
+        {
+            return new Vector3(
+                ((float)Math.Floor(eye.X / Const.BODY_GRID_CELL) - Const.BODY_GRID_X / 2) * Const.BODY_GRID_CELL,
+                -Const.BODY_GRID_CELL,  // bodies rest on the ground plane
+                ((float)Math.Floor(eye.Z / Const.BODY_GRID_CELL) - Const.BODY_GRID_Z / 2) * Const.BODY_GRID_CELL);
+        }
+
+        /// <summary>
+        /// Rebuilds the grid when the bodies or the camera cell changed, sets the body
+        /// fields of the frame and binds the buffers to their texture units
+        /// </summary>
+        internal void OnFrame(ref FrameState frame, RigidBodies rigidBodies)
+        {
+            Vector3 origin = GridOrigin(frame.Origin);
+
+            if (uploadedVersion != frame.BodyVersion || uploadedOrigin != origin)
+            {
+                if (bodies.Length < rigidBodies.Capacity)
+                    bodies = new Vector4[rigidBodies.Capacity];
+
+                uploadedVersion = frame.BodyVersion;
+                uploadedOrigin = origin;
+                bodyCount = rigidBodies.CopySnapshot(bodies);
+                uploadedCount = Build(origin);
+
+                // mapBodies() reads nothing while no body is listed
+                if (uploadedCount > 0)
+                {
+                    GL.BindBuffer(BufferTarget.TextureBuffer, buf_bodies);
+                    GL.BufferData(BufferTarget.TextureBuffer, bodyCount * Vector4.SizeInBytes, bodies, BufferUsageHint.StreamDraw);
+                    GL.BindBuffer(BufferTarget.TextureBuffer, buf_grid);
+                    GL.BufferData(BufferTarget.TextureBuffer, grid.Length * sizeof(uint), grid, BufferUsageHint.StreamDraw);
+                    GL.BindBuffer(BufferTarget.TextureBuffer, 0);
+
+                    GL.BindTexture(TextureTarget.TextureBuffer, tex_bodies);
+                    GL.TexBuffer(TextureBufferTarget.TextureBuffer, SizedInternalFormat.Rgba32f, buf_bodies);
+                    GL.BindTexture(TextureTarget.TextureBuffer, tex_grid);
+                    GL.TexBuffer(TextureBufferTarget.TextureBuffer, SizedInternalFormat.R32ui, buf_grid);
+                    GL.BindTexture(TextureTarget.TextureBuffer, 0);
+                }
+            }
+
+            frame.BodyCount = uploadedCount;
+            frame.BodyGrid = new Vector4(origin, Const.BODY_GRID_CELL);
+
+            GL.ActiveTexture(TextureUnit.Texture0 + Const.BODIES_TEXTURE_UNIT);
+            GL.BindTexture(TextureTarget.TextureBuffer, tex_bodies);
+            GL.ActiveTexture(TextureUnit.Texture0 + Const.BODY_GRID_TEXTURE_UNIT);
+            GL.BindTexture(TextureTarget.TextureBuffer, tex_grid);
+            GL.ActiveTexture(TextureUnit.Texture0);
+        }
+
+        /// <summary>
+        /// Counting sort of the bodies into the cells they reach with the margin:
+        /// [0..CELLS] start of every cell list in the buffer, then the lists
+        /// </summary>
+        /// <returns>Number of listed bodies</returns>
+        int Build(Vector3 origin)
+        {
+            var size = new Vector3(Const.BODY_GRID_X, Const.BODY_GRID_Y, Const.BODY_GRID_Z) * Const.BODY_GRID_CELL;
+            int listed = 0,
+                entries = 0;
+
+            Array.Clear(cellCount, 0, CELLS);
+
+            for (int pass = 0; pass < 2; pass++)
+            {
+                if (pass == 1)
+                {
+                    // cell starts, then reuse the counts as fill cursors
+                    if (grid.Length < CELLS + 1 + entries)
+                        grid = new uint[CELLS + 1 + entries];
+
+                    uint start = CELLS + 1;
+                    for (int c = 0; c < CELLS; c++)
+                    {
+                        grid[c] = start;
+                        start += (uint)cellCount[c];
+                        cellCount[c] = 0;
+                    }
+                    grid[CELLS] = start;
+                }
+
+                for (int i = 0; i < bodyCount; i++)
+                {
+                    Vector3 p = bodies[i].Xyz - origin;
+                    float reach = bodies[i].W + MARGIN;
+
+                    // bodies closer than the margin to the border are not drawn,
+                    // so mapBodies() may step the margin past the grid border
+                    if (p.X - reach < 0f || p.Y - reach < 0f || p.Z - reach < 0f
+                        || p.X + reach > size.X || p.Y + reach > size.Y || p.Z + reach > size.Z)
+                        continue;
+
+                    if (pass == 0)
+                        listed++;
+
+                    int x0 = (int)((p.X - reach) / Const.BODY_GRID_CELL), x1 = Math.Min((int)((p.X + reach) / Const.BODY_GRID_CELL), Const.BODY_GRID_X - 1),
+                        y0 = (int)((p.Y - reach) / Const.BODY_GRID_CELL), y1 = Math.Min((int)((p.Y + reach) / Const.BODY_GRID_CELL), Const.BODY_GRID_Y - 1),
+                        z0 = (int)((p.Z - reach) / Const.BODY_GRID_CELL), z1 = Math.Min((int)((p.Z + reach) / Const.BODY_GRID_CELL), Const.BODY_GRID_Z - 1);
+
+                    for (int z = z0; z <= z1; z++)
+                        for (int y = y0; y <= y1; y++)
+                            for (int x = x0; x <= x1; x++)
+                            {
+                                int c = (z * Const.BODY_GRID_Y + y) * Const.BODY_GRID_X + x;
+
+                                if (pass == 0)
+                                    entries++;
+                                else
+                                    grid[grid[c] + cellCount[c]] = (uint)i;
+
+                                cellCount[c]++;
+                            }
+                }
+            }
+
+            return listed;
+        }
+
+        internal void Stop()
+        {
+            if (!IsStarted)
+                return;
+
+            GL.DeleteTexture(tex_bodies);
+            GL.DeleteTexture(tex_grid);
+            GL.DeleteBuffers(1, ref buf_bodies);
+            GL.DeleteBuffers(1, ref buf_grid);
+            buf_bodies = 0;
+        }
+    }
+}
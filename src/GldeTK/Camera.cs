@@ -60,6 +60,21 @@ namespace GldeTK
             UpdateProjection();
         }
 
+        /// <summary>
+        /// Same as cameraRay() of scene.c, pixel coordinates from the bottom left corner
+        /// </summary>
+        public Vector3 GetRayDirection(float x, float y, int width, int height)
+        {
+            float aspect = (float)width / height;
+            Vector3 n = Vector3.Normalize(
+                new Vector3(
+                    (2f * x / width - 1f) * aspect,
+                    2f * y / height - 1f,
+                    2f));
+
+            return Projection.Row0 * n.X + Projection.Row1 * n.Y + Projection.Row2 * n.Z;
+        }
+
         protected void UpdateProjection() => Projection = GetProjection(origin, target, up);
 
         public static Matrix3 GetProjection(Vector3 origin, Vector3 target, Vector3 up)
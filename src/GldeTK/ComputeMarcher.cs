@@ -0,0 +1,176 @@
+﻿using OpenTK.Graphics.OpenGL4;
+using System;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Compute shader backend: persistent threads march rays in waves,
+    /// finished rays are dropped and the live ones are compacted into the
+    /// other queue, then one fullscreen pass shades the stored hits.
+    /// </summary>
+    public class ComputeMarcher
+    {
+        const int RAYSTATE_SIZE = 32;   // vec4 + uvec4, std430
+        const int QUEUE_IN_BINDING = 2;
+        const int QUEUE_OUT_BINDING = 3;
+        const int COUNTERS_BINDING = 4;
+        const int COUNTER_CURSOR_OFFSET = 8;
+        const int HITMAP_IMAGE_UNIT = 0;
+
+        int h_march,
+            h_shade;
+
+        int uf_Wave,
+            uf_LastWave,
+            uf_QueueIn,
+            uf_StepsPerWave,
+            uf_HitMap;
+
+        SceneUniforms marchUniforms,
+            shadeUniforms;
+
+        int[] ssbo_rayQueue = new int[2];
+        int ssbo_rayCounters,
+            tex_hitMap;
+
+        readonly uint[] zero = new uint[1];
+
+        public bool IsStarted => h_march != 0;
+
+        /// <summary>
+        /// Compute shaders and SSBO need GL 4.3
+        /// </summary>
+        public static bool IsSupported
+        {
+            get
+            {
+                GL.GetInteger(GetPName.MajorVersion, out int major);
+                GL.GetInteger(GetPName.MinorVersion, out int minor);
+
+                return major > 4 || (major == 4 && minor >= 3);
+            }
+        }
+
+        public void Start()
+        {
+            h_march = ShaderLoader.Link(
+                ShaderLoader.Compile(ShaderType.ComputeShader, Const.COMPUTE_MARCH_FILENAME));
+
+            h_shade = ShaderLoader.Link(
+                ShaderLoader.Compile(ShaderType.VertexShader, Const.VERTEX_FILENAME),
+                ShaderLoader.Compile(ShaderType.FragmentShader, Const.FRAGMENT_SHADE_FILENAME));
+
+            ShaderLoader.BindMapBlock(h_march);
+            ShaderLoader.BindMapBlock(h_shade);
+
+            marchUniforms = new SceneUniforms(h_march);
+            shadeUniforms = new SceneUniforms(h_shade);
+
+            uf_Wave = GL.GetUniformLocation(h_march, "uWave");
+            uf_LastWave = GL.GetUniformLocation(h_march, "uLastWave");
+            uf_QueueIn = GL.GetUniformLocation(h_march, "uQueueIn");
+            uf_StepsPerWave = GL.GetUniformLocation(h_march, "uStepsPerWave");
+            uf_HitMap = GL.GetUniformLocation(h_shade, "hitMap");
+
+            GL.GenBuffers(2, ssbo_rayQueue);
+
+            ssbo_rayCounters = GL.GenBuffer();
+            GL.BindBuffer(BufferTarget.ShaderStorageBuffer, ssbo_rayCounters);
+            GL.BufferData(BufferTarget.ShaderStorageBuffer, 16, IntPtr.Zero, BufferUsageHint.DynamicCopy);
+            GL.BindBuffer(BufferTarget.ShaderStorageBuffer, 0);
+
+            tex_hitMap = GL.GenTexture();
+        }
+
+        internal void OnResize(int width, int height)
+        {
+            if (!IsStarted)
+                return;
+
+            // every pixel may still be alive after the first wave
+            foreach (int ssbo in ssbo_rayQueue)
+            {
+                GL.BindBuffer(BufferTarget.ShaderStorageBuffer, ssbo);
+                GL.BufferData(
+                    BufferTarget.ShaderStorageBuffer,
+                    width * height * RAYSTATE_SIZE,
+                    IntPtr.Zero,
+                    BufferUsageHint.DynamicCopy);
+            }
+            GL.BindBuffer(BufferTarget.ShaderStorageBuffer, 0);
+
+            GL.BindTexture(TextureTarget.Texture2D, tex_hitMap);
+            GL.TexImage2D(
+                TextureTarget.Texture2D, 0,
+                PixelInternalFormat.Rgba32f,
+                width, height, 0,
+                PixelFormat.Rgba, PixelType.Float,
+                IntPtr.Zero);
+            GL.TexParameter(TextureTarget.Texture2D, TextureParameterName.TextureMinFilter, (int)TextureMinFilter.Nearest);
+            GL.TexParameter(TextureTarget.Texture2D, TextureParameterName.TextureMagFilter, (int)TextureMagFilter.Nearest);
+            GL.BindTexture(TextureTarget.Texture2D, 0);
+        }
+
+        internal void OnFrame(FrameState frame, bool tileBinning, bool tileCulling, bool rasterElements)
+        {
+            GL.UseProgram(h_march);
+            marchUniforms.Set(frame, tileBinning, tileCulling, rasterElements);
+            GL.Uniform1(uf_StepsPerWave, Const.COMPUTE_STEPS_PER_WAVE);
+
+            GL.BindImageTexture(HITMAP_IMAGE_UNIT, tex_hitMap, 0, false, 0, TextureAccess.WriteOnly, SizedInternalFormat.Rgba32f);
+            GL.BindBufferBase(BufferRangeTarget.ShaderStorageBuffer, COUNTERS_BINDING, ssbo_rayCounters);
+            GL.BindBuffer(BufferTarget.ShaderStorageBuffer, ssbo_rayCounters);
+
+            // one extra wave flushes rays still alive after the step budget
+            int waves = (Const.COMPUTE_MAX_RAY_STEPS + Const.COMPUTE_STEPS_PER_WAVE - 1) / Const.COMPUTE_STEPS_PER_WAVE + 1;
+
+            for (int wave = 0; wave < waves; wave++)
+            {
+                int queueIn = wave & 1;
+                int queueOut = 1 - queueIn;
+
+                GL.BindBufferBase(BufferRangeTarget.ShaderStorageBuffer, QUEUE_IN_BINDING, ssbo_rayQueue[queueIn]);
+                GL.BindBufferBase(BufferRangeTarget.ShaderStorageBuffer, QUEUE_OUT_BINDING, ssbo_rayQueue[queueOut]);
+
+                // empty the output queue and rewind the cursor
+                GL.BufferSubData(BufferTarget.ShaderStorageBuffer, (IntPtr)(queueOut * sizeof(uint)), sizeof(uint), zero);
+                GL.BufferSubData(BufferTarget.ShaderStorageBuffer, (IntPtr)COUNTER_CURSOR_OFFSET, sizeof(uint), zero);
+
+                GL.Uniform1(uf_Wave, wave);
+                GL.Uniform1(uf_LastWave, wave == waves - 1 ? 1 : 0);
+                GL.Uniform1(uf_QueueIn, queueIn);
+
+                GL.DispatchCompute(Const.COMPUTE_PERSISTENT_GROUPS, 1, 1);
+                GL.MemoryBarrier(MemoryBarrierFlags.ShaderStorageBarrierBit | MemoryBarrierFlags.BufferUpdateBarrierBit);
+            }
+
+            GL.BindBuffer(BufferTarget.ShaderStorageBuffer, 0);
+            GL.MemoryBarrier(MemoryBarrierFlags.TextureFetchBarrierBit);
+
+            GL.UseProgram(h_shade);
+            shadeUniforms.Set(frame, tileBinning);
+
+            GL.ActiveTexture(TextureUnit.Texture0);
+            GL.BindTexture(TextureTarget.Texture2D, tex_hitMap);
+            GL.Uniform1(uf_HitMap, 0);
+
+            GL.DrawArrays(PrimitiveType.Triangles, 0, 3);
+
+            GL.BindTexture(TextureTarget.Texture2D, 0);
+            GL.UseProgram(0);
+        }
+
+        internal void Stop()
+        {
+            if (!IsStarted)
+                return;
+
+            GL.DeleteTexture(tex_hitMap);
+            GL.DeleteBuffers(2, ssbo_rayQueue);
+            GL.DeleteBuffers(1, ref ssbo_rayCounters);
+            GL.DeleteProgram(h_march);
+            GL.DeleteProgram(h_shade);
+            h_march = 0;
+        }
+    }
+}
@@ -1,4 +1,5 @@
-﻿using OpenTK.Input;
+﻿using OpenTK;
+using OpenTK.Input;
 
 namespace GldeTK
 {
@@ -6,23 +7,224 @@ namespace GldeTK
     {
         public const string APP_NAME = "GldeTK";
         public const string RELEASE_DATE = "11 Jan 2019";
+        public const string ARG_BENCHMARK = "--bench";
+        public const string ARG_MESH = "--mesh";
+        public const string ARG_PACK = "--pack";
+        public const string ARG_SCENE = "--scene";
 
         public const string FRAGMENT_FILENAME = "GldeTK.shaders.fragment.c";
         public const string VERTEX_FILENAME = "GldeTK.shaders.vertex.c";
         public const string GEOMETRY_FILENAME = "GldeTK.shaders.geometry.c";
+        public const string COMPUTE_MARCH_FILENAME = "GldeTK.shaders.compute_march.c";
+        public const string COMPUTE_BIN_FILENAME = "GldeTK.shaders.compute_bin.c";
+        public const string COMPUTE_CULL_FILENAME = "GldeTK.shaders.compute_cull.c";
+        public const string FRAGMENT_SHADE_FILENAME = "GldeTK.shaders.fragment_shade.c";
+        public const string COMPUTE_PARTICLES_FILENAME = "GldeTK.shaders.compute_particles.c";
+        public const string COMPUTE_QUERY_FILENAME = "GldeTK.shaders.compute_query.c";
+        public const string VERTEX_PARTICLES_FILENAME = "GldeTK.shaders.vertex_particles.c";
+        public const string FRAGMENT_PARTICLES_FILENAME = "GldeTK.shaders.fragment_particles.c";
+        public const string FRAGMENT_GBUFFER_FILENAME = "GldeTK.shaders.fragment_gbuffer.c";
+        public const string FRAGMENT_SHADOW_FILENAME = "GldeTK.shaders.fragment_shadow.c";
+        public const string FRAGMENT_AO_FILENAME = "GldeTK.shaders.fragment_ao.c";
+        public const string FRAGMENT_LIGHT_FILENAME = "GldeTK.shaders.fragment_light.c";
+        public const string FRAGMENT_SHADOWMAP_FILENAME = "GldeTK.shaders.fragment_shadowmap.c";
+        public const string COMPUTE_AOCACHE_FILENAME = "GldeTK.shaders.compute_aocache.c";
+        public const string VERTEX_HUD_FILENAME = "GldeTK.shaders.vertex_hud.c";
+        public const string FRAGMENT_HUD_FILENAME = "GldeTK.shaders.fragment_hud.c";
+        public const string VERTEX_MESH_FILENAME = "GldeTK.shaders.vertex_mesh.c";
+        public const string FRAGMENT_MESH_FILENAME = "GldeTK.shaders.fragment_mesh.c";
+        public const string FRAGMENT_DEPTH_FILENAME = "GldeTK.shaders.fragment_depth.c";
+        public const string SHADER_RESOURCE_PREFIX = "GldeTK.shaders.";
 
         public const string UBO_SDELEMENTSMAP_BLOCKNAME = "SdElements";
         public const int UBO_SDELEMENTSMAP_BLOCKCOUNT = 256;
-        public const string UF_TIMER = "iGlobalTime";
+        public const int UBO_SDELEMENTSMAP_BINDING = 1;
+        public const string UBO_FRAMEPARAMS_BLOCKNAME = "FrameParams";
+        public const int UBO_FRAMEPARAMS_BINDING = 2;
         public const string UF_RESOLUTION = "iResolution";
-        public const string UF_RAY_ORIGIN = "ro";
-        public const string UF_PROJECTION_MATRIX = "camProj";
+        public const string UF_TILE_BINNING = "uTileBinning";
+        public const string UF_TILE_LISTS = "tileLists";
+        public const string UF_TILE_CULLING = "uTileCulling";
+        public const string UF_TILE_RANGES = "tileRanges";
+        public const string UF_BODIES = "bodies";
+        public const string UF_BODY_GRID_CELLS = "bodyGrid";
+        public const string UF_SHADOW_MAP = "shadowMap";
+        public const string UF_AO_CACHE = "aoCache";
+        public const string UF_RASTER_ELEMENTS = "uRasterElements";
+        public const string UF_SCULPT_ATLAS = "sculptAtlas";
+        public const string UF_SCULPT_MAP = "sculptMap";
 
         public const float PLAYER_HIT_RADIUS = 1.0f;
+        public const float PHYS_TERMINAL_FALL_SPEED = 55f;  // m/s
+        public const int PHYS_SWEEP_MAX_STEPS = 24;         // the body stops short when it runs out
+        public const float PHYS_SWEEP_CONTACT_DIST = 0.01f;
+        public const float PHYS_GRAVITY = 9.8f;
+        public const int PHYS_RAY_MAX_STEPS = 16;           // CastRay, and physRay of compute_query.c
+        public const float PHYS_RAY_MIN_DIST = 0.1f;        // closer is a hit, on the CPU and the GPU alike
+        public const float PHYS_RAY_MAX_DIST = 100f;
+
+        public const int QUERY_SLOTS = 1024;                // queries per GPU batch
+        public const long QUERY_MAX_AGE = 100;              // ms, older GPU results fall back to the CPU
+        public const float QUERY_REUSE_DISTANCE = 0.25f;    // m between a query and the one its result answers
+        public const float QUERY_REUSE_MARGIN = 0.05f;      // m a reused ray may stray from the answered one up to its hit
+        public const int QUERY_SLOT_WALL = 0;
+        public const int QUERY_SLOT_WALL_NORMAL = 1;
+
+        public const int BODIES_MAX = 4096;
+        public const float BODIES_MAX_RADIUS = 0.5f;
+        public const int BODIES_BATCH = 256;                // bodies per parallel work item
+        public const float BODIES_RESTITUTION = 0.3f;
+        public const int BODIES_SPAWN_COUNT = 256;
+        public const float BODIES_SPAWN_SPEED = 15f;        // m/s
+
+        public const int PARTICLES_COUNT = 1 << 16;
+        public const int PARTICLES_COUNT_MAX = 1 << 20;     // opt-in, second F8
+        public const float PARTICLES_EMITTER_RADIUS = 20f;  // m, rain disc around the camera
+        public const float PARTICLES_MAX_DELTA = 0.05f;     // s, longer frames slow the rain down
+
+        public const int BODY_GRID_X = 32;                  // cells, as in scene.c
+        public const int BODY_GRID_Y = 8;
+        public const int BODY_GRID_Z = 32;
+        public const float BODY_GRID_CELL = 2f;             // m
+
+        public const int COMPUTE_PERSISTENT_GROUPS = 256;   // x64 threads, keep every SIMD unit busy
+        public const int COMPUTE_STEPS_PER_WAVE = 8;        // march steps between two compactions
+        public const int COMPUTE_MAX_RAY_STEPS = 100;       // MARCH_MAX_STEPS of scene.c
+
+        public const int BIN_TILE_SIZE = 16;                // pixels, as in scene.c
+        public const int BIN_TILE_STRIDE = 128;             // uint per tile list, as in scene.c
+        public const int TILE_LISTS_TEXTURE_UNIT = 1;
+        public const int TILE_RANGES_TEXTURE_UNIT = 2;
+        public const int BODIES_TEXTURE_UNIT = 3;
+        public const int BODY_GRID_TEXTURE_UNIT = 4;
+        public const int GBUFFER_SURFACE_TEXTURE_UNIT = 5;
+        public const int GBUFFER_NORMAL_TEXTURE_UNIT = 6;
+        public const int GBUFFER_SHADOW_TEXTURE_UNIT = 7;
+        public const int GBUFFER_OCCLUSION_TEXTURE_UNIT = 8;
+        public const int SHADOW_MAP_TEXTURE_UNIT = 9;
+        public const int AO_CACHE_TEXTURE_UNIT = 10;
+        public const int SCULPT_ATLAS_TEXTURE_UNIT = 11;
+        public const int SCULPT_MAP_TEXTURE_UNIT = 12;
+
+        public const int SHADOW_MAP_SIZE = 1024;            // texels per side
+        public const float SHADOW_MAP_EXTENT = 48f;         // m, half the side, about 9 cm texels
+        public const float SHADOW_MAP_RECENTER = 6f;        // m, the center snaps to this grid around the camera
+        public const float SHADOW_MAP_MAX_ANGLE = 0.08f;    // rad, the light turns this far before a new map
+        public const int SHADOW_MAP_INTERVAL = 8;           // frames between maps while the bodies move
+        public const int SHADOW_MAP_SLICES = 4;             // frames a map is marched over, a band each
+
+        public const float AO_CACHE_CELL = 0.125f;          // m, as in scene.c, about the reach of calcAO()
+        public const int AO_CACHE_X = 256;                  // cells, as in scene.c
+        public const int AO_CACHE_Y = 64;
+        public const int AO_CACHE_Z = 256;
+        public const int AO_CACHE_FIRST_Y = -8;             // cells, the window starts just below the ground plane
+        public const int AO_CACHE_FILL_BUDGET = 16384;      // cells per frame
+        public const int AO_CACHE_PIXEL_STRIDE = 2;         // pixels between the hits asking for cells
+
+        public const string CAPTURE_FILENAME = "capture_{0:yyyyMMdd_HHmmss}.y4m";
+        public const int CAPTURE_FPS = 30;                  // frames per second of the video, read back at this rate
+        public const int CAPTURE_QUEUE = 8;                 // frames waiting for the writer before new ones are dropped
+        public const long CAPTURE_END_TIMEOUT = 50 * 1000000;   // ns, a readback still in flight at the end is dropped after it
+        public const int CAPTURE_JOIN_TIMEOUT = 2000;       // ms, the writer finishing the file at the end
+
+        public const int HUD_MAX_INSTANCES = 4096;          // glyphs and graph bars per frame
+        public const int HUD_MARGIN = 8;                    // px
+        public const int HUD_TEXT_SCALE = 2;                // screen pixels per font pixel
+        public const int HUD_GRAPH_SAMPLES = 240;           // frames, one pixel column each
+        public const int HUD_GRAPH_HEIGHT = 60;             // px
+        public const float HUD_GRAPH_MAX_TIME = 0.05f;      // s, frame time of a full bar
+        public const uint HUD_TEXT_COLOR = 0xffffffff;      // rgba8, red in the low byte
+        public const uint HUD_BACKDROP_COLOR = 0x99000000;
+        public const uint HUD_GRAPH_GOOD_COLOR = 0xff40d040; // 60 fps and faster
+        public const uint HUD_GRAPH_SLOW_COLOR = 0xff30d0e0; // 30 fps and faster
+        public const uint HUD_GRAPH_BAD_COLOR = 0xff4040f0;
+        public const uint HUD_GRAPH_LINE_COLOR = 0x80ffffff;
+
+        public static readonly Vector3 MESH_ORIGIN = new Vector3(-32f, -4f, -32f);   // lowest corner of the polygonized cube
+        public const float MESH_SIZE = 64f;                 // m, side of the cube
+        public const int MESH_DEPTH = 9;                    // octree levels of --mesh, 12.5 cm cells
+
+        public const float STREAM_CHUNK_SIZE = 16f;         // m, side of a world chunk
+        public const int STREAM_CHUNK_CAPACITY = 8;         // elements, one pool slot
+        public const int STREAM_POOL_CHUNKS = SdScene.MAX_ELEMENTS / STREAM_CHUNK_CAPACITY;
+        public const float STREAM_RADIUS = 12f;             // m, chunks touching it are wanted, at most 3x3
+        public const float STREAM_PREFETCH_TIME = 1f;       // s, of the camera velocity ahead
+        public const float STREAM_UNLOAD_RADIUS = 48f;      // m, CPU copies of chunks out of the pool are kept within it
+        public const int STREAM_MAX_LOADS = 4;              // chunk loads in flight
+
+        public static readonly Vector3 SCULPT_ORIGIN = new Vector3(-64f, -8f, -64f);  // lowest corner of the brick grid, as in scene.c
+        public const int SCULPT_BRICKS_X = 64;              // bricks of the grid, as in scene.c
+        public const int SCULPT_BRICKS_Y = 16;
+        public const int SCULPT_BRICKS_Z = 64;
+        public const int SCULPT_BRICK_CELLS = 8;            // cells per side, the brick keeps the corners of 9x9x9
+        public const float SCULPT_CELL = 0.25f;             // m
+        public const int SCULPT_ATLAS_BRICKS = 16;          // bricks per side of the atlas, as in scene.c
+        public const int SCULPT_POOL_BRICKS = SCULPT_ATLAS_BRICKS * SCULPT_ATLAS_BRICKS * SCULPT_ATLAS_BRICKS;
+        public const float SCULPT_MARGIN = 0.5f;            // m, bricks reach this far past the edits, as in scene.c
+        public const float SCULPT_REACH = 20f;              // m, edits go where the view ray hits, this far at most
+        public const float SCULPT_BLOB_RADIUS = 0.8f;       // m
+        public const float SCULPT_HOLE_RADIUS = 1.2f;
+        public const float SCULPT_SMOOTHING = 0.3f;         // m, blend of the smooth operations
+
+        public const float FRAME_TIME_QUANTUM = 0.5f;       // s, a still view restarts its refinement once per step
+        public const int REFINE_MAX_SAMPLES = 16;           // supersampling of a still view
+        public const string PROFILER_FRAMES = "frames";
+        public const string PROFILER_FRAMES_SKIPPED = "frames.skipped";
+        public const string PROFILER_QUERIES_GPU = "queries.gpu";
+        public const string PROFILER_QUERIES_CPU = "queries.cpu";
+        public const string PROFILER_TICKS = "ticks";
+        public const string PROFILER_MAP_SAVED = "map.saved";
+        public const string PROFILER_GPU_PREFIX = "gpu.";
+        public const string PROFILER_GPU_SAMPLES = ".samples";
+        public const string PROFILER_GPU_GBUFFER = "gbuffer";
+        public const string PROFILER_GPU_SHADOW = "shadow";
+        public const string PROFILER_GPU_AO = "ao";
+        public const string PROFILER_GPU_LIGHT = "light";
+        public const string PROFILER_GPU_MARCH = "march";
+        public const string PROFILER_GPU_MESH = "mesh";
+        public const string PROFILER_SHADOW_MAPS = "shadow.maps";
+        public const string PROFILER_LATENCY = "latency";
+        public const string PROFILER_LATENCY_FRAMES = "latency.frames";
+        public const string PROFILER_CAPTURE_FRAMES = "capture.frames";
+        public const string PROFILER_CAPTURE_DROPPED = "capture.dropped";
+        public const string PROFILER_CAPTURE_US = "capture.us";
+        public const string PROFILER_HUD_US = "hud.us";
+        public const string PROFILER_STREAM_MISSES = "stream.misses";
+        public const string PROFILER_STREAM_LOADS = "stream.loads";
+        public const string PROFILER_STREAM_EVICTIONS = "stream.evictions";
+        public const string PROFILER_STREAM_PREFETCH_HITS = "stream.prefetched";
+        public const string PROFILER_SCULPT_BAKES = "sculpt.bakes";
+        public const string PROFILER_SCULPT_VISIBLE = "sculpt.visible";
+        public const string PROFILER_SCULPT_LATENCY_US = "sculpt.latency.us";
+        public const string PROFILER_SCULPT_UPLOAD_BYTES = "sculpt.upload.bytes";
+        public const string PROFILER_SCULPT_DROPPED = "sculpt.dropped";
+
+        public static readonly int[] SCENE_FIELD_SIZES = { 0, 16, 32, 64, SdScene.MAX_ELEMENTS };
+        public static readonly int[] OCCLUSION_SCALES = { 1, 2, 4 };   // quality tiers of the deferred shadows and AO
+        public static readonly int[] FRAME_LIMITER_DEPTHS = { 2, 3, 0, 1 };  // frames in flight, 0 - as the driver queues them
+        public const float SCENE_FIELD_EXTENT = 30f;
 
         public const float INPUT_UPDATE_INTERVAL = 10; // every ms
+        public const double WINDOW_EVENT_RATE = 60;    // per second, the window thread draws nothing
         public const Key INPUT_KEY_FULLSCREEN = Key.F11;
         public const Key INPUT_KEY_EXIT = Key.Escape;
+        public const Key INPUT_KEY_BACKEND = Key.F2;
+        public const Key INPUT_KEY_SCENE_FIELD = Key.F3;
+        public const Key INPUT_KEY_TILE_BINNING = Key.F4;
+        public const Key INPUT_KEY_TILE_CULLING = Key.F5;
+        public const Key INPUT_KEY_REFINEMENT = Key.F6;
+        public const Key INPUT_KEY_BODIES = Key.F7;
+        public const Key INPUT_KEY_PARTICLES = Key.F8;
+        public const Key INPUT_KEY_OCCLUSION_SCALE = Key.F9;
+        public const Key INPUT_KEY_SHADOW_MAP = Key.F10;
+        public const Key INPUT_KEY_AO_CACHE = Key.F12;
+        public const Key INPUT_KEY_FRAME_LIMITER = Key.F1;
+        public const Key INPUT_KEY_CAPTURE = Key.R;
+        public const Key INPUT_KEY_HUD = Key.H;
+        public const Key INPUT_KEY_RASTER = Key.M;
+        public const Key INPUT_KEY_STREAMING = Key.G;
+        public const Key INPUT_KEY_SCULPT_ADD = Key.B;
+        public const Key INPUT_KEY_SCULPT_CARVE = Key.N;
 
         public const int DISPLAY_BITPERPIXEL = 32;
         public const int DISPLAY_REFRESH_RATE = 60;
@@ -0,0 +1,267 @@
+﻿using OpenTK.Graphics.OpenGL4;
+using System;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Deferred backend: the march pass stores only the hit distance, material and normal
+    /// of every pixel, then the shadow, AO and lighting passes run over that G-buffer
+    /// in screen order, free of the divergence of the march loop. Shadows and AO are
+    /// low-frequency, they can be marched at a fraction of the resolution and upsampled.
+    /// </summary>
+    public class DeferredShading
+    {
+        int h_gbuffer,
+            h_shadow,
+            h_ao,
+            h_light;
+
+        SceneUniforms gbufferUniforms,
+            shadowUniforms,
+            aoUniforms,
+            lightUniforms;
+
+        int uf_ShadowScale,
+            uf_AoScale,
+            uf_LightScale;
+
+        int fbo_gbuffer,
+            fbo_shadow,
+            fbo_ao;
+
+        int tex_surface,    // t, material
+            tex_normal,     // octahedral normal
+            tex_shadow,
+            tex_occlusion;
+
+        int width,
+            height,
+            occlusionWidth,
+            occlusionHeight,
+            allocatedScale;
+
+        GpuTimer gbufferTimer = new GpuTimer(Const.PROFILER_GPU_GBUFFER),
+            shadowTimer = new GpuTimer(Const.PROFILER_GPU_SHADOW),
+            aoTimer = new GpuTimer(Const.PROFILER_GPU_AO),
+            lightTimer = new GpuTimer(Const.PROFILER_GPU_LIGHT);
+
+        public bool IsStarted => h_gbuffer != 0;
+
+        /// <summary>
+        /// G-buffer pixels per shadow and AO texel along each axis, one of Const.OCCLUSION_SCALES
+        /// </summary>
+        public int OcclusionScale { get; set; } = Const.OCCLUSION_SCALES[0];
+
+        public void Start()
+        {
+            h_gbuffer = LinkPass(Const.FRAGMENT_GBUFFER_FILENAME, out gbufferUniforms);
+            h_shadow = LinkPass(Const.FRAGMENT_SHADOW_FILENAME, out shadowUniforms);
+            h_ao = LinkPass(Const.FRAGMENT_AO_FILENAME, out aoUniforms);
+            h_light = LinkPass(Const.FRAGMENT_LIGHT_FILENAME, out lightUniforms);
+
+            uf_ShadowScale = GL.GetUniformLocation(h_shadow, "uOcclusionScale");
+            uf_AoScale = GL.GetUniformLocation(h_ao, "uOcclusionScale");
+            uf_LightScale = GL.GetUniformLocation(h_light, "uOcclusionScale");
+
+            tex_surface = GL.GenTexture();
+            tex_normal = GL.GenTexture();
+            tex_shadow = GL.GenTexture();
+            tex_occlusion = GL.GenTexture();
+
+            fbo_gbuffer = GL.GenFramebuffer();
+            fbo_shadow = GL.GenFramebuffer();
+            fbo_ao = GL.GenFramebuffer();
+
+            gbufferTimer.Start();
+            shadowTimer.Start();
+            aoTimer.Start();
+            lightTimer.Start();
+        }
+
+        static int LinkPass(string fragmentFilename, out SceneUniforms uniforms)
+        {
+            int h_program = ShaderLoader.Link(
+                ShaderLoader.Compile(ShaderType.VertexShader, Const.VERTEX_FILENAME),
+                ShaderLoader.Compile(ShaderType.FragmentShader, fragmentFilename));
+
+            ShaderLoader.BindMapBlock(h_program);
+            uniforms = new SceneUniforms(h_program);
+
+            GL.UseProgram(h_program);
+            GL.Uniform1(GL.GetUniformLocation(h_program, "gSurface"), Const.GBUFFER_SURFACE_TEXTURE_UNIT);
+            GL.Uniform1(GL.GetUniformLocation(h_program, "gNormal"), Const.GBUFFER_NORMAL_TEXTURE_UNIT);
+            GL.Uniform1(GL.GetUniformLocation(h_program, "gShadow"), Const.GBUFFER_SHADOW_TEXTURE_UNIT);
+            GL.Uniform1(GL.GetUniformLocation(h_program, "gOcclusion"), Const.GBUFFER_OCCLUSION_TEXTURE_UNIT);
+            GL.UseProgram(0);
+
+            return h_program;
+        }
+
+        internal void OnResize(int width, int height)
+        {
+            if (!IsStarted)
+                return;
+
+            this.width = width;
+            this.height = height;
+
+            // full float distance, the positions of the later passes are rebuilt from it
+            AllocateTarget(tex_surface, PixelInternalFormat.Rg32f, PixelFormat.Rg, width, height);
+            AllocateTarget(tex_normal, PixelInternalFormat.Rg16f, PixelFormat.Rg, width, height);
+
+            GL.BindFramebuffer(FramebufferTarget.Framebuffer, fbo_gbuffer);
+            GL.FramebufferTexture2D(FramebufferTarget.Framebuffer, FramebufferAttachment.ColorAttachment0, TextureTarget.Texture2D, tex_surface, 0);
+            GL.FramebufferTexture2D(FramebufferTarget.Framebuffer, FramebufferAttachment.ColorAttachment1, TextureTarget.Texture2D, tex_normal, 0);
+            GL.DrawBuffers(2, new[] { DrawBuffersEnum.ColorAttachment0, DrawBuffersEnum.ColorAttachment1 });
+            GL.BindFramebuffer(FramebufferTarget.Framebuffer, 0);
+
+            AllocateOcclusion();
+        }
+
+        /// <summary>
+        /// Shadow and AO targets at the current OcclusionScale, partial blocks at the border get a texel too
+        /// </summary>
+        void AllocateOcclusion()
+        {
+            allocatedScale = OcclusionScale;
+            occlusionWidth = (width + allocatedScale - 1) / allocatedScale;
+            occlusionHeight = (height + allocatedScale - 1) / allocatedScale;
+
+            AllocateTarget(tex_shadow, PixelInternalFormat.R8, PixelFormat.Red, occlusionWidth, occlusionHeight);
+            AllocateTarget(tex_occlusion, PixelInternalFormat.R8, PixelFormat.Red, occlusionWidth, occlusionHeight);
+
+            GL.BindFramebuffer(FramebufferTarget.Framebuffer, fbo_shadow);
+            GL.FramebufferTexture2D(FramebufferTarget.Framebuffer, FramebufferAttachment.ColorAttachment0, TextureTarget.Texture2D, tex_shadow, 0);
+
+            GL.BindFramebuffer(FramebufferTarget.Framebuffer, fbo_ao);
+            GL.FramebufferTexture2D(FramebufferTarget.Framebuffer, FramebufferAttachment.ColorAttachment0, TextureTarget.Texture2D, tex_occlusion, 0);
+            GL.BindFramebuffer(FramebufferTarget.Framebuffer, 0);
+        }
+
+        static void AllocateTarget(int texture, PixelInternalFormat internalFormat, PixelFormat format, int width, int height)
+        {
+            GL.BindTexture(TextureTarget.Texture2D, texture);
+            GL.TexImage2D(
+                TextureTarget.Texture2D, 0,
+                internalFormat,
+                width, height, 0,
+                format, PixelType.Float,
+                IntPtr.Zero);
+            GL.TexParameter(TextureTarget.Texture2D, TextureParameterName.TextureMinFilter, (int)TextureMinFilter.Nearest);
+            GL.TexParameter(TextureTarget.Texture2D, TextureParameterName.TextureMagFilter, (int)TextureMagFilter.Nearest);
+            GL.BindTexture(TextureTarget.Texture2D, 0);
+        }
+
+        /// <summary>
+        /// March, shadow and AO passes into the offscreen targets, before the frame's own framebuffer is bound
+        /// </summary>
+        internal void OnFrame(FrameState frame, bool tileBinning, bool tileCulling, bool rasterElements)
+        {
+            // the scale is picked by the input thread
+            if (allocatedScale != OcclusionScale)
+                AllocateOcclusion();
+
+            GL.BindFramebuffer(FramebufferTarget.Framebuffer, fbo_gbuffer);
+            gbufferTimer.Begin();
+            DrawPass(h_gbuffer, gbufferUniforms, -1, frame, tileBinning, tileCulling, rasterElements);
+            gbufferTimer.End();
+
+            BindTargets();
+            GL.Viewport(0, 0, occlusionWidth, occlusionHeight);
+
+            GL.BindFramebuffer(FramebufferTarget.Framebuffer, fbo_shadow);
+            shadowTimer.Begin();
+            DrawPass(h_shadow, shadowUniforms, uf_ShadowScale, frame, tileBinning, false);
+            shadowTimer.End();
+
+            GL.BindFramebuffer(FramebufferTarget.Framebuffer, fbo_ao);
+            aoTimer.Begin();
+            DrawPass(h_ao, aoUniforms, uf_AoScale, frame, tileBinning, false);
+            aoTimer.End();
+
+            GL.Viewport(0, 0, width, height);
+            GL.BindFramebuffer(FramebufferTarget.Framebuffer, 0);
+        }
+
+        /// <summary>
+        /// Lights the G-buffer into the bound framebuffer, color and ray distance like the other backends
+        /// </summary>
+        internal void Resolve(FrameState frame)
+        {
+            BindTargets();
+
+            lightTimer.Begin();
+            DrawPass(h_light, lightUniforms, uf_LightScale, frame, false, false);
+            lightTimer.End();
+
+            UnbindTargets();
+        }
+
+        void DrawPass(int h_program, SceneUniforms uniforms, int uf_scale, FrameState frame, bool tileBinning, bool tileCulling, bool rasterElements = false)
+        {
+            GL.UseProgram(h_program);
+            uniforms.Set(frame, tileBinning, tileCulling, rasterElements);
+            GL.Uniform1(uf_scale, allocatedScale);
+            GL.DrawArrays(PrimitiveType.Triangles, 0, 3);
+            GL.UseProgram(0);
+        }
+
+        void BindTargets()
+        {
+            GL.ActiveTexture(TextureUnit.Texture0 + Const.GBUFFER_SURFACE_TEXTURE_UNIT);
+            GL.BindTexture(TextureTarget.Texture2D, tex_surface);
+            GL.ActiveTexture(TextureUnit.Texture0 + Const.GBUFFER_NORMAL_TEXTURE_UNIT);
+            GL.BindTexture(TextureTarget.Texture2D, tex_normal);
+            GL.ActiveTexture(TextureUnit.Texture0 + Const.GBUFFER_SHADOW_TEXTURE_UNIT);
+            GL.BindTexture(TextureTarget.Texture2D, tex_shadow);
+            GL.ActiveTexture(TextureUnit.Texture0 + Const.GBUFFER_OCCLUSION_TEXTURE_UNIT);
+            GL.BindTexture(TextureTarget.Texture2D, tex_occlusion);
+            GL.ActiveTexture(TextureUnit.Texture0);
+        }
+
+        void UnbindTargets()
+        {
+            for (int unit = Const.GBUFFER_SURFACE_TEXTURE_UNIT; unit <= Const.GBUFFER_OCCLUSION_TEXTURE_UNIT; unit++)
+            {
+                GL.ActiveTexture(TextureUnit.Texture0 + unit);
+                GL.BindTexture(TextureTarget.Texture2D, 0);
+            }
+            GL.ActiveTexture(TextureUnit.Texture0);
+        }
+
+        /// <summary>
+        /// Average GPU milliseconds of every pass since the last call
+        /// </summary>
+        internal string TakeTimes()
+        {
+            return $" occlusion 1/{allocatedScale} {gbufferTimer.Name} {gbufferTimer.TakeMilliseconds().ToString("0.0")}"
+                + $" {shadowTimer.Name} {shadowTimer.TakeMilliseconds().ToString("0.0")}"
+                + $" {aoTimer.Name} {aoTimer.TakeMilliseconds().ToString("0.0")}"
+                + $" {lightTimer.Name} {lightTimer.TakeMilliseconds().ToString("0.0")}ms";
+        }
+
+        internal void Stop()
+        {
+            if (!IsStarted)
+                return;
+
+            gbufferTimer.Stop();
+            shadowTimer.Stop();
+            aoTimer.Stop();
+            lightTimer.Stop();
+
+            GL.DeleteTexture(tex_surface);
+            GL.DeleteTexture(tex_normal);
+            GL.DeleteTexture(tex_shadow);
+            GL.DeleteTexture(tex_occlusion);
+            GL.DeleteFramebuffer(fbo_gbuffer);
+            GL.DeleteFramebuffer(fbo_shadow);
+            GL.DeleteFramebuffer(fbo_ao);
+            GL.DeleteProgram(h_gbuffer);
+            GL.DeleteProgram(h_shadow);
+            GL.DeleteProgram(h_ao);
+            GL.DeleteProgram(h_light);
+            h_gbuffer = 0;
+        }
+    }
+}
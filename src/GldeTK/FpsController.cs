@@ -1,5 +1,6 @@
 ﻿using OpenTK;
 using OpenTK.Input;
+using System.Diagnostics;
 
 namespace GldeTK
 {
@@ -24,6 +25,8 @@ namespace GldeTK
         float motion_Speed = 5f;
         float motion_jumpImpulse = 3f;
 
+        // mouse look, shared by Update on the input thread and Latch on the render thread
+        readonly object sync = new object();
         MouseState lastMouse = new MouseState();
         KeyboardState lastKeyboard = new KeyboardState();
         float yaw = 0.0f;
@@ -36,15 +39,39 @@ namespace GldeTK
 
             Ray motionStep = rayOrigin;
 
-            UpdateMouse(mouse, delta, motionStep);
+            lock (sync)
+            {
+                UpdateMouse(mouse, delta, motionStep);
+                lastMouse = mouse;
+            }
             UpdateKeyboard(keyboard, delta, motionStep);
 
             lastKeyboard = keyboard;
-            lastMouse = mouse;
 
             return motionStep;
         }
 
+        /// <summary>
+        /// Camera of the snapshot turned by the mouse motion the next Update would apply. The render
+        /// thread takes it right before a frame, so the view does not wait for the input tick.
+        /// </summary>
+        /// <param name="timestamp">Stopwatch timestamp of the mouse state the view shows</param>
+        public Camera Latch(FrameSnapshot snapshot, out long timestamp)
+        {
+            var mouse = Mouse.GetState();
+            timestamp = Stopwatch.GetTimestamp();
+
+            Camera view = snapshot.ToCamera();
+
+            lock (sync)
+            {
+                if (Look(mouse, Const.INPUT_UPDATE_INTERVAL / 1000f, out float latchedYaw, out float latchedPitch))
+                    view.SetTarget(latchedYaw + MathHelper.Pi, latchedPitch);
+            }
+
+            return view;
+        }
+
         protected void UpdateKeyboard(KeyboardState keyboard, float delta, Ray nextStep)
         {
             nextStep.Origin = Vector3.Zero;
@@ -73,25 +100,36 @@ namespace GldeTK
         }
 
         protected void UpdateMouse(MouseState mouse, float delta, Ray nextStep)
+        {
+            if (!Look(mouse, delta, out yaw, out pitch))
+                return;
+
+            /// Sets new Front of the Camera. Angles must be in radians.
+            nextStep.SetTarget(yaw + MathHelper.Pi, pitch);
+        }
+
+        /// <summary>
+        /// Angles after the mouse motion since lastMouse, false when the mouse did not move
+        /// </summary>
+        bool Look(MouseState mouse, float delta, out float nextYaw, out float nextPitch)
         {
             int deltaX = mouse.X - lastMouse.X;
             int deltaY = lastMouse.Y - mouse.Y;
 
-            if ((deltaX == 0) && (deltaY == 0))
-                return;
+            nextYaw = yaw + deltaX * mouse_sensitivity * delta;
+            nextPitch = pitch + deltaY * mouse_sensitivity * delta;
 
-            yaw += deltaX * mouse_sensitivity * delta;
-            pitch += deltaY * mouse_sensitivity * delta;
+            if ((deltaX == 0) && (deltaY == 0))
+                return false;
 
             const float EPS = 0.001f;
-            if (pitch >= MathHelper.PiOver2 - EPS)
-                pitch = MathHelper.PiOver2 - EPS;
+            if (nextPitch >= MathHelper.PiOver2 - EPS)
+                nextPitch = MathHelper.PiOver2 - EPS;
             else
-                if (pitch <= -MathHelper.PiOver2 + EPS)
-                pitch = -MathHelper.PiOver2 + EPS;
+                if (nextPitch <= -MathHelper.PiOver2 + EPS)
+                nextPitch = -MathHelper.PiOver2 + EPS;
 
-            /// Sets new Front of the Camera. Angles must be in radians.
-            nextStep.SetTarget(yaw + MathHelper.Pi, pitch);
+            return true;
         }
     }
 }
@@ -0,0 +1,174 @@
+﻿using OpenTK;
+using OpenTK.Graphics.OpenGL4;
+using System;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Offscreen copy of the last frame. It is presented again while the view does not change,
+    /// and meanwhile jittered samples can be blended into it for progressive supersampling.
+    /// The depth of a sample is kept only while it is drawn, MeshPass and the marchers share it.
+    /// </summary>
+    public class FrameCache
+    {
+        int fbo,
+            tex_color,
+            tex_distance,
+            tex_depth;
+
+        int width,
+            height;
+
+        /// <summary>
+        /// Samples averaged in the cached image, 0 - nothing to present
+        /// </summary>
+        public int Samples { get; private set; }
+
+        /// <summary>
+        /// Ray distance of every pixel (second target of the marchers), the nearest of the samples
+        /// </summary>
+        internal int DistanceTexture => tex_distance;
+
+        public void Start()
+        {
+            fbo = GL.GenFramebuffer();
+            tex_color = GL.GenTexture();
+            tex_distance = GL.GenTexture();
+            tex_depth = GL.GenTexture();
+        }
+
+        internal void OnResize(int width, int height)
+        {
+            this.width = width;
+            this.height = height;
+
+            // half floats keep the running average of many samples free of banding
+            GL.BindTexture(TextureTarget.Texture2D, tex_color);
+            GL.TexImage2D(
+                TextureTarget.Texture2D, 0,
+                PixelInternalFormat.Rgba16f,
+                width, height, 0,
+                PixelFormat.Rgba, PixelType.HalfFloat,
+                IntPtr.Zero);
+            GL.TexParameter(TextureTarget.Texture2D, TextureParameterName.TextureMinFilter, (int)TextureMinFilter.Nearest);
+            GL.TexParameter(TextureTarget.Texture2D, TextureParameterName.TextureMagFilter, (int)TextureMagFilter.Nearest);
+
+            GL.BindTexture(TextureTarget.Texture2D, tex_distance);
+            GL.TexImage2D(
+                TextureTarget.Texture2D, 0,
+                PixelInternalFormat.R32f,
+                width, height, 0,
+                PixelFormat.Red, PixelType.Float,
+                IntPtr.Zero);
+            GL.TexParameter(TextureTarget.Texture2D, TextureParameterName.TextureMinFilter, (int)TextureMinFilter.Nearest);
+            GL.TexParameter(TextureTarget.Texture2D, TextureParameterName.TextureMagFilter, (int)TextureMagFilter.Nearest);
+
+            // window depth of rayDepth() and cameraClip() in scene.c
+            GL.BindTexture(TextureTarget.Texture2D, tex_depth);
+            GL.TexImage2D(
+                TextureTarget.Texture2D, 0,
+                PixelInternalFormat.DepthComponent32f,
+                width, height, 0,
+                PixelFormat.DepthComponent, PixelType.Float,
+                IntPtr.Zero);
+            GL.TexParameter(TextureTarget.Texture2D, TextureParameterName.TextureMinFilter, (int)TextureMinFilter.Nearest);
+            GL.TexParameter(TextureTarget.Texture2D, TextureParameterName.TextureMagFilter, (int)TextureMagFilter.Nearest);
+            GL.BindTexture(TextureTarget.Texture2D, 0);
+
+            GL.BindFramebuffer(FramebufferTarget.Framebuffer, fbo);
+            GL.FramebufferTexture2D(FramebufferTarget.Framebuffer, FramebufferAttachment.ColorAttachment0, TextureTarget.Texture2D, tex_color, 0);
+            GL.FramebufferTexture2D(FramebufferTarget.Framebuffer, FramebufferAttachment.ColorAttachment1, TextureTarget.Texture2D, tex_distance, 0);
+            GL.FramebufferTexture2D(FramebufferTarget.Framebuffer, FramebufferAttachment.DepthAttachment, TextureTarget.Texture2D, tex_depth, 0);
+            GL.DrawBuffers(2, new[] { DrawBuffersEnum.ColorAttachment0, DrawBuffersEnum.ColorAttachment1 });
+            GL.BindFramebuffer(FramebufferTarget.Framebuffer, 0);
+
+            Samples = 0;
+        }
+
+        /// <summary>
+        /// Drops the cached image, the next frame is rendered from scratch
+        /// </summary>
+        public void Invalidate() => Samples = 0;
+
+        /// <summary>
+        /// Redirects drawing into the cache, the first sample replaces the image
+        /// and every next one is blended in with weight 1 / (Samples + 1). The distance keeps
+        /// its minimum, an average of a silhouette lies between the surfaces.
+        /// The depth starts cleared, a sample draws the nearest of meshes and march.
+        /// </summary>
+        internal void BeginSample()
+        {
+            GL.BindFramebuffer(FramebufferTarget.Framebuffer, fbo);
+
+            GL.Enable(EnableCap.DepthTest);
+            GL.DepthFunc(DepthFunction.Lequal);
+            GL.Clear(ClearBufferMask.DepthBufferBit);
+
+            if (Samples > 0)
+            {
+                GL.Enable(EnableCap.Blend);
+                GL.BlendColor(0f, 0f, 0f, 1f / (Samples + 1));
+                GL.BlendFunc(BlendingFactor.ConstantAlpha, BlendingFactor.OneMinusConstantAlpha);
+                GL.BlendEquation(1, BlendEquationMode.Min);
+            }
+        }
+
+        internal void EndSample()
+        {
+            GL.Disable(EnableCap.Blend);
+            GL.BlendEquation(BlendEquationMode.FuncAdd);
+            GL.Disable(EnableCap.DepthTest);
+            GL.BindFramebuffer(FramebufferTarget.Framebuffer, 0);
+
+            Samples++;
+        }
+
+        /// <summary>
+        /// Copies the cached image to the window
+        /// </summary>
+        internal void Present()
+        {
+            GL.BindFramebuffer(FramebufferTarget.ReadFramebuffer, fbo);
+            GL.BindFramebuffer(FramebufferTarget.DrawFramebuffer, 0);
+            GL.BlitFramebuffer(
+                0, 0, width, height,
+                0, 0, width, height,
+                ClearBufferMask.ColorBufferBit,
+                BlitFramebufferFilter.Nearest);
+            GL.BindFramebuffer(FramebufferTarget.Framebuffer, 0);
+        }
+
+        /// <summary>
+        /// Halton (2, 3) subpixel offset in [-0.5, 0.5), the first sample is centered
+        /// </summary>
+        public static Vector2 GetJitter(int sample)
+        {
+            if (sample == 0)
+                return Vector2.Zero;
+
+            return new Vector2(Halton(sample, 2) - 0.5f, Halton(sample, 3) - 0.5f);
+        }
+
+        static float Halton(int index, int radix)
+        {
+            float result = 0f,
+                f = 1f;
+
+            for (int i = index; i > 0; i /= radix)
+            {
+                f /= radix;
+                result += f * (i % radix);
+            }
+
+            return result;
+        }
+
+        internal void Stop()
+        {
+            GL.DeleteTexture(tex_color);
+            GL.DeleteTexture(tex_distance);
+            GL.DeleteTexture(tex_depth);
+            GL.DeleteFramebuffer(fbo);
+        }
+    }
+}
@@ -0,0 +1,211 @@
+﻿using OpenTK.Graphics.OpenGL4;
+using System;
+using System.Collections.Concurrent;
+using System.Diagnostics;
+using System.IO;
+using System.Runtime.InteropServices;
+using System.Threading;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Records the presented frames to a Y4M file without stalling the render thread. The back
+    /// buffer is read into a ring of pixel buffers, each mapped only once its fence has passed,
+    /// and the pixels go to a worker thread that converts and writes them. A frame is dropped
+    /// when every pixel buffer is still in flight or the worker queue is full.
+    /// </summary>
+    public class FrameCapture
+    {
+        const int RING = 3;     // frames a readback may stay in flight
+
+        class Slot
+        {
+            public int Pbo;
+            public IntPtr Fence;
+        }
+
+        Slot[] ring;
+        int next,
+            width,
+            height;
+        long nextCapture;
+
+        BlockingCollection<byte[]> queue;
+        ConcurrentBag<byte[]> pool;
+        Thread worker;
+
+        public bool IsRecording => ring != null;
+
+        /// <summary>
+        /// File of the current or last recording
+        /// </summary>
+        public string FileName { get; private set; }
+
+        /// <summary>
+        /// Opens a new file named by the time, the size is fixed for the whole recording
+        /// </summary>
+        /// <returns>False when the file can not be created, nothing is recorded</returns>
+        internal bool Begin(int width, int height)
+        {
+            FileName = Path.GetFullPath(string.Format(Const.CAPTURE_FILENAME, DateTime.Now));
+
+            Y4mWriter writer;
+            try
+            {
+                writer = new Y4mWriter(FileName, width, height, Const.CAPTURE_FPS);
+            }
+            catch (IOException)
+            {
+                return false;
+            }
+            catch (UnauthorizedAccessException)
+            {
+                return false;
+            }
+
+            this.width = width;
+            this.height = height;
+            int size = width * height * 4;
+
+            ring = new Slot[RING];
+            for (int k = 0; k < RING; k++)
+            {
+                ring[k] = new Slot { Pbo = GL.GenBuffer() };
+                GL.BindBuffer(BufferTarget.PixelPackBuffer, ring[k].Pbo);
+                GL.BufferData(BufferTarget.PixelPackBuffer, size, IntPtr.Zero, BufferUsageHint.StreamRead);
+            }
+            GL.BindBuffer(BufferTarget.PixelPackBuffer, 0);
+
+            queue = new BlockingCollection<byte[]>(Const.CAPTURE_QUEUE);
+            pool = new ConcurrentBag<byte[]>();
+            worker = new Thread(() => Write(writer, queue, pool, width)) { Name = "Capture", IsBackground = true };
+            worker.Start();
+
+            nextCapture = Stopwatch.GetTimestamp();
+            return true;
+        }
+
+        /// <summary>
+        /// Hands the finished readbacks to the worker and reads the back buffer at Const.CAPTURE_FPS.
+        /// Call after the frame is complete in the default framebuffer.
+        /// </summary>
+        internal void OnFrame()
+        {
+            long start = Stopwatch.GetTimestamp();
+
+            foreach (Slot slot in ring)
+                if (slot.Fence != IntPtr.Zero)
+                    Collect(slot, 0);
+
+            if (start >= nextCapture)
+            {
+                // a slow frame does not make up for the captures it missed
+                nextCapture = Math.Max(nextCapture + Stopwatch.Frequency / Const.CAPTURE_FPS, start);
+
+                Slot slot = ring[next];
+                if (slot.Fence == IntPtr.Zero)
+                {
+                    GL.BindFramebuffer(FramebufferTarget.ReadFramebuffer, 0);
+                    GL.BindBuffer(BufferTarget.PixelPackBuffer, slot.Pbo);
+                    GL.ReadPixels(0, 0, width, height, PixelFormat.Rgba, PixelType.UnsignedByte, IntPtr.Zero);
+                    GL.BindBuffer(BufferTarget.PixelPackBuffer, 0);
+
+                    slot.Fence = GL.FenceSync(SyncCondition.SyncGpuCommandsComplete, WaitSyncFlags.None);
+                    next = (next + 1) % RING;
+                }
+                else
+                    Profiler.Count(Const.PROFILER_CAPTURE_DROPPED);    // the GPU is behind
+            }
+
+            Profiler.Count(Const.PROFILER_CAPTURE_US, (Stopwatch.GetTimestamp() - start) * 1000000 / Stopwatch.Frequency);
+        }
+
+        /// <summary>
+        /// Copies the pixels of the slot out if its fence passes within the timeout
+        /// </summary>
+        void Collect(Slot slot, long timeout)
+        {
+            WaitSyncStatus status = GL.ClientWaitSync(slot.Fence, ClientWaitSyncFlags.SyncFlushCommandsBit, timeout);
+            if (status != WaitSyncStatus.AlreadySignaled && status != WaitSyncStatus.ConditionSatisfied)
+                return;
+
+            GL.DeleteSync(slot.Fence);
+            slot.Fence = IntPtr.Zero;
+
+            int size = width * height * 4;
+            if (!pool.TryTake(out byte[] pixels))
+                pixels = new byte[size];
+
+            GL.BindBuffer(BufferTarget.PixelPackBuffer, slot.Pbo);
+            IntPtr mapped = GL.MapBufferRange(BufferTarget.PixelPackBuffer, IntPtr.Zero, size, BufferAccessMask.MapReadBit);
+            Marshal.Copy(mapped, pixels, 0, size);
+            GL.UnmapBuffer(BufferTarget.PixelPackBuffer);
+            GL.BindBuffer(BufferTarget.PixelPackBuffer, 0);
+
+            if (queue.TryAdd(pixels))
+                Profiler.Count(Const.PROFILER_CAPTURE_FRAMES);
+            else
+            {
+                pool.Add(pixels);
+                Profiler.Count(Const.PROFILER_CAPTURE_DROPPED);    // the disk is behind
+            }
+        }
+
+        /// <summary>
+        /// Worker thread, owns the writer and closes it after the last queued frame
+        /// </summary>
+        static void Write(Y4mWriter writer, BlockingCollection<byte[]> queue, ConcurrentBag<byte[]> pool, int stride)
+        {
+            using (writer)
+            {
+                bool failed = false;
+
+                foreach (byte[] pixels in queue.GetConsumingEnumerable())
+                {
+                    try
+                    {
+                        if (!failed)
+                            writer.Write(pixels, stride);
+                    }
+                    catch (IOException)
+                    {
+                        failed = true;  // the rest of the recording is dropped
+                    }
+
+                    if (failed)
+                        Profiler.Count(Const.PROFILER_CAPTURE_DROPPED);
+
+                    pool.Add(pixels);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Queues the readbacks still in flight and waits up to Const.CAPTURE_JOIN_TIMEOUT
+        /// for the worker to finish the file, a slower disk finishes it in the background
+        /// </summary>
+        internal void End()
+        {
+            if (!IsRecording)
+                return;
+
+            foreach (Slot slot in ring)
+            {
+                if (slot.Fence != IntPtr.Zero)
+                    Collect(slot, Const.CAPTURE_END_TIMEOUT);
+
+                if (slot.Fence != IntPtr.Zero)
+                    GL.DeleteSync(slot.Fence);
+
+                GL.DeleteBuffers(1, ref slot.Pbo);
+            }
+
+            queue.CompleteAdding();
+            worker.Join(Const.CAPTURE_JOIN_TIMEOUT);
+
+            ring = null;
+            queue = null;
+            worker = null;
+        }
+    }
+}
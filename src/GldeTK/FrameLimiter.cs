@@ -0,0 +1,90 @@
+﻿using OpenTK.Graphics.OpenGL4;
+using System;
+using System.Diagnostics;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Keeps at most Depth frames queued on the GPU with a fence after every SwapBuffers,
+    /// so the driver cannot buffer frames that show an old camera. The fences also time
+    /// every frame from the input it was latched from to the completion of its swap,
+    /// summed in the Profiler as microseconds.
+    /// </summary>
+    public class FrameLimiter
+    {
+        const int RING = 4;                         // fences kept, also the limit of Depth 0
+        const long WAIT_TIMEOUT = 100 * 1000000;    // ns, the frame is abandoned after it
+
+        IntPtr[] fences = new IntPtr[RING];
+        long[] inputTimestamps = new long[RING];
+        int oldest,
+            count;
+
+        /// <summary>
+        /// Frames allowed in flight, one of Const.FRAME_LIMITER_DEPTHS, 0 leaves it to the driver.
+        /// Set by the input thread.
+        /// </summary>
+        public int Depth { get; set; } = Const.FRAME_LIMITER_DEPTHS[0];
+
+        /// <summary>
+        /// Returns once fewer than Depth frames are in flight, right before the input is latched
+        /// </summary>
+        internal void Wait()
+        {
+            // finished frames first, they never block
+            while (count > 0 && Collect(0))
+            { }
+
+            int depth = Depth == 0 ? RING : Depth;
+            while (count >= depth)
+                if (!Collect(WAIT_TIMEOUT))
+                    Drop();
+        }
+
+        /// <summary>
+        /// Fences the frame just swapped
+        /// </summary>
+        /// <param name="inputTimestamp">Stopwatch timestamp of the input the frame shows</param>
+        internal void Submit(long inputTimestamp)
+        {
+            if (count == RING)
+                Drop();
+
+            int slot = (oldest + count) % RING;
+            fences[slot] = GL.FenceSync(SyncCondition.SyncGpuCommandsComplete, WaitSyncFlags.None);
+            inputTimestamps[slot] = inputTimestamp;
+            count++;
+        }
+
+        /// <summary>
+        /// Retires the oldest frame if its fence passes within the timeout
+        /// </summary>
+        bool Collect(long timeout)
+        {
+            WaitSyncStatus status = GL.ClientWaitSync(fences[oldest], ClientWaitSyncFlags.SyncFlushCommandsBit, timeout);
+            if (status != WaitSyncStatus.AlreadySignaled && status != WaitSyncStatus.ConditionSatisfied)
+                return false;
+
+            long elapsed = Stopwatch.GetTimestamp() - inputTimestamps[oldest];
+            Profiler.Count(Const.PROFILER_LATENCY, elapsed * 1000000 / Stopwatch.Frequency);
+            Profiler.Count(Const.PROFILER_LATENCY_FRAMES);
+
+            Drop();
+            return true;
+        }
+
+        void Drop()
+        {
+            GL.DeleteSync(fences[oldest]);
+            fences[oldest] = IntPtr.Zero;
+            oldest = (oldest + 1) % RING;
+            count--;
+        }
+
+        internal void Stop()
+        {
+            while (count > 0)
+                Drop();
+        }
+    }
+}
@@ -0,0 +1,64 @@
+﻿using OpenTK;
+using System;
+using System.Runtime.InteropServices;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// std140 image of the FrameParams block of scene.c. Values every pixel used to derive
+    /// on its own, computed once per frame and shared by all programs through one buffer.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct FrameParams
+    {
+        public const int SIZE = 192;
+
+        // mat3 camProj, std140 pads every column to a vec4
+        public Vector4 Projection0;
+        public Vector4 Projection1;
+        public Vector4 Projection2;
+        public Vector3 Origin;
+        public float GlobalTime;
+        public Vector4 Light;
+        public Vector4 BodyGrid;
+        public Vector2 Jitter;
+        public int BodyCount;
+        int padding;
+        public Vector4 ShadowLight;
+        public Vector4 ShadowCenter;
+        public Vector4 AoCache;
+        public Vector4 SculptLo;
+        public Vector4 SculptHi;
+
+        public FrameParams(FrameState frame)
+        {
+            // OpenTK rows are the columns GL reads
+            Projection0 = new Vector4(frame.Projection.Row0, 0f);
+            Projection1 = new Vector4(frame.Projection.Row1, 0f);
+            Projection2 = new Vector4(frame.Projection.Row2, 0f);
+            Origin = frame.Origin;
+            GlobalTime = frame.GlobalTime;
+            Light = new Vector4(GetLightDirection(frame.GlobalTime), 0f);
+            BodyGrid = frame.BodyGrid;
+            Jitter = frame.Jitter;
+            BodyCount = frame.BodyCount;
+            padding = 0;
+            ShadowLight = frame.ShadowLight;
+            ShadowCenter = frame.ShadowCenter;
+            AoCache = frame.AoCache;
+            SculptLo = frame.SculptLo;
+            SculptHi = frame.SculptHi;
+        }
+
+        /// <summary>
+        /// Unit direction towards the sun at the time, circles the sky every 20π seconds
+        /// </summary>
+        public static Vector3 GetLightDirection(float time)
+        {
+            float c = (float)Math.Cos(time * 0.1),
+                s = (float)Math.Sin(time * 0.1);
+
+            return Vector3.Normalize(new Vector3(c, Math.Abs(s), c * s));
+        }
+    }
+}
@@ -0,0 +1,28 @@
+﻿using OpenTK;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// State of the world one frame is drawn from. The input thread posts one per tick
+    /// and never changes it again, the render thread never reads the live camera.
+    /// </summary>
+    public sealed class FrameSnapshot
+    {
+        public readonly float GlobalTime;
+        public readonly Vector3 Origin;
+        public readonly Vector3 Target;
+        public readonly Vector3 Up;
+        public readonly int SceneVersion;
+
+        public FrameSnapshot(float globalTime, Ray camera, int sceneVersion)
+        {
+            GlobalTime = globalTime;
+            Origin = camera.Origin;
+            Target = camera.Target;
+            Up = camera.Up;
+            SceneVersion = sceneVersion;
+        }
+
+        public Camera ToCamera() => new Camera(Origin, Target, Up);
+    }
+}
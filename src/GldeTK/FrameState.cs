@@ -0,0 +1,117 @@
+﻿using OpenTK;
+using System;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Inputs of one rendered frame. The camera is copied, so every pass of the
+    /// frame sees the same view while the input thread keeps moving it.
+    /// </summary>
+    public struct FrameState
+    {
+        public float GlobalTime;
+
+        /// <summary>
+        /// GlobalTime in Const.FRAME_TIME_QUANTUM steps, a still view is refined
+        /// again only when time-driven shading moves on by a step
+        /// </summary>
+        public float ViewTime;
+
+        public int Width;
+        public int Height;
+        public Vector3 Origin;
+        public Matrix3 Projection;
+        public int SceneVersion;
+        public int BodyVersion;
+
+        /// <summary>
+        /// Render settings of the frame, read once from the toggles of the input thread.
+        /// The version counts the toggles.
+        /// </summary>
+        public RenderBackend Backend;
+        public bool TileBinning;
+        public bool TileCulling;
+        public bool RasterElements;
+        public int SettingsVersion;
+
+        /// <summary>
+        /// RigidBodies listed by BodyGrid and the grid corner and cell size
+        /// </summary>
+        public int BodyCount;
+        public Vector4 BodyGrid;
+
+        /// <summary>
+        /// Subpixel offset of the camera rays, samples of one view differ only here
+        /// </summary>
+        public Vector2 Jitter;
+
+        /// <summary>
+        /// Light direction and center of the ShadowMap the frame reads, w - valid and half extent.
+        /// The version counts its renders.
+        /// </summary>
+        public Vector4 ShadowLight;
+        public Vector4 ShadowCenter;
+        public int ShadowVersion;
+
+        /// <summary>
+        /// First cell of the AoCache window and its generation, 0 - off
+        /// </summary>
+        public Vector4 AoCache;
+
+        /// <summary>
+        /// Bounds of the Sculpt bricks on the GPU, w of the lower corner - 1 when there are any
+        /// </summary>
+        public Vector4 SculptLo;
+        public Vector4 SculptHi;
+
+        /// <summary>
+        /// Sculpt.Version of the uploaded bricks, the edits complete on the GPU
+        /// </summary>
+        public int SculptVersion;
+
+        public FrameState(float globalTime, int width, int height, Camera camera, int sceneVersion, int bodyVersion)
+        {
+            GlobalTime = globalTime;
+            ViewTime = (float)Math.Floor(globalTime / Const.FRAME_TIME_QUANTUM) * Const.FRAME_TIME_QUANTUM;
+            Width = width;
+            Height = height;
+            Origin = camera.Origin;
+            Projection = camera.Projection;
+            SceneVersion = sceneVersion;
+            BodyVersion = bodyVersion;
+            Backend = RenderBackend.Fragment;
+            TileBinning = false;
+            TileCulling = false;
+            RasterElements = false;
+            SettingsVersion = 0;
+            BodyCount = 0;
+            BodyGrid = Vector4.Zero;
+            Jitter = Vector2.Zero;
+            ShadowLight = Vector4.Zero;
+            ShadowCenter = Vector4.Zero;
+            ShadowVersion = 0;
+            AoCache = Vector4.Zero;
+            SculptLo = Vector4.Zero;
+            SculptHi = Vector4.Zero;
+            SculptVersion = 0;
+        }
+
+        /// <summary>
+        /// Both frames produce the same image, jitter aside
+        /// </summary>
+        public bool SameView(ref FrameState other)
+        {
+            return
+                ViewTime == other.ViewTime
+                && Width == other.Width
+                && Height == other.Height
+                && Origin == other.Origin
+                && Projection == other.Projection
+                && SceneVersion == other.SceneVersion
+                && BodyVersion == other.BodyVersion
+                && SculptVersion == other.SculptVersion
+                && SettingsVersion == other.SettingsVersion
+                && ShadowVersion == other.ShadowVersion;
+        }
+    }
+}
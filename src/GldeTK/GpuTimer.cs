@@ -0,0 +1,89 @@
+﻿using OpenTK.Graphics.OpenGL4;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// GPU time of one pass from TimeElapsed queries. Results are read a few frames later,
+    /// only once available, and summed in the Profiler as microseconds under the timer's name.
+    /// </summary>
+    public class GpuTimer
+    {
+        const int RING = 4;     // frames a query may stay in flight
+
+        public readonly string Name;
+
+        int[] queries = new int[RING];
+        bool[] pending = new bool[RING];
+        int next;
+        bool running;
+
+        public GpuTimer(string name)
+        {
+            Name = name;
+        }
+
+        public void Start()
+        {
+            GL.GenQueries(RING, queries);
+        }
+
+        /// <summary>
+        /// Starts timing unless every query is still in flight, timers must not nest
+        /// </summary>
+        public void Begin()
+        {
+            Collect();
+
+            if (pending[next])
+                return;
+
+            GL.BeginQuery(QueryTarget.TimeElapsed, queries[next]);
+            running = true;
+        }
+
+        public void End()
+        {
+            if (!running)
+                return;
+
+            GL.EndQuery(QueryTarget.TimeElapsed);
+            running = false;
+            pending[next] = true;
+            next = (next + 1) % RING;
+        }
+
+        void Collect()
+        {
+            for (int k = 0; k < RING; k++)
+            {
+                if (!pending[k])
+                    continue;
+
+                GL.GetQueryObject(queries[k], GetQueryObjectParam.QueryResultAvailable, out int available);
+                if (available == 0)
+                    continue;
+
+                GL.GetQueryObject(queries[k], GetQueryObjectParam.QueryResult, out long nanoseconds);
+                Profiler.Count(Const.PROFILER_GPU_PREFIX + Name, nanoseconds / 1000);
+                Profiler.Count(Const.PROFILER_GPU_PREFIX + Name + Const.PROFILER_GPU_SAMPLES);
+                pending[k] = false;
+            }
+        }
+
+        /// <summary>
+        /// Average milliseconds of the pass since the last call, 0 when it did not run
+        /// </summary>
+        public double TakeMilliseconds()
+        {
+            long samples = Profiler.Take(Const.PROFILER_GPU_PREFIX + Name + Const.PROFILER_GPU_SAMPLES);
+            long microseconds = Profiler.Take(Const.PROFILER_GPU_PREFIX + Name);
+
+            return samples == 0 ? 0.0 : microseconds / 1000.0 / samples;
+        }
+
+        public void Stop()
+        {
+            GL.DeleteQueries(RING, queries);
+        }
+    }
+}
@@ -0,0 +1,344 @@
+﻿using OpenTK.Graphics.OpenGL4;
+using System;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+using System.Text;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Overlay of the stats text and a frame time graph (vertex_hud.c, fragment_hud.c), drawn
+    /// over the presented frame in a single instanced draw: every glyph and every graph bar is
+    /// one instance of four ints. The instances are laid out each frame into a reused array and
+    /// copied into one of the regions of a persistently mapped buffer, a region is written again
+    /// only after the fence of its last draw has passed, the last written region is drawn again
+    /// while it has not. Nothing is allocated per frame.
+    /// </summary>
+    public class Hud
+    {
+        const int INSTANCE_INTS = 4;    // x | y << 16, width | height << 16, glyph, rgba8
+        const int INSTANCE_SIZE = INSTANCE_INTS * sizeof(int);
+        const int REGIONS = 3;
+        const long REGION_TIMEOUT = 10 * 1000000;   // ns, the update of the frame is skipped after it
+        const int SOLID = -1;
+        const int MAX_TEXT = 1024;      // chars
+
+        int h_program,
+            uf_Resolution,
+            uf_Atlas;
+
+        int tex_atlas,
+            vao,
+            vbo_instances;
+
+        // persistent mapping needs OpenGL 4.4, BufferSubData otherwise
+        IntPtr mapped;
+        IntPtr[] fences = new IntPtr[REGIONS];
+        int region,
+            lastRegion = -1,
+            lastCount;
+
+        int[] instances = new int[Const.HUD_MAX_INSTANCES * INSTANCE_INTS];
+        int count;
+
+        readonly object sync = new object();
+        char[] postedText = new char[MAX_TEXT];
+        int postedLength;
+        char[] text = new char[MAX_TEXT];
+        int textLength;
+
+        float[] frameTimes = new float[Const.HUD_GRAPH_SAMPLES];
+        int frameIndex;
+        long lastTimestamp;
+
+        public bool IsStarted => h_program != 0;
+
+        /// <summary>
+        /// Set by the input thread
+        /// </summary>
+        public bool Enabled { get; set; } = true;
+
+        static bool IsPersistentMappingSupported
+        {
+            get
+            {
+                GL.GetInteger(GetPName.MajorVersion, out int major);
+                GL.GetInteger(GetPName.MinorVersion, out int minor);
+
+                return major > 4 || (major == 4 && minor >= 4);
+            }
+        }
+
+        public void Start()
+        {
+            h_program = ShaderLoader.Link(
+                ShaderLoader.Compile(ShaderType.VertexShader, Const.VERTEX_HUD_FILENAME),
+                ShaderLoader.Compile(ShaderType.FragmentShader, Const.FRAGMENT_HUD_FILENAME));
+
+            uf_Resolution = GL.GetUniformLocation(h_program, "uResolution");
+            uf_Atlas = GL.GetUniformLocation(h_program, "uAtlas");
+
+            // row 0 of the texture is the top row of the atlas, texelFetch does not care
+            tex_atlas = GL.GenTexture();
+            GL.BindTexture(TextureTarget.Texture2D, tex_atlas);
+            GL.PixelStore(PixelStoreParameter.UnpackAlignment, 1);
+            GL.TexImage2D(
+                TextureTarget.Texture2D, 0,
+                PixelInternalFormat.R8,
+                HudFont.ATLAS_COLUMNS * HudFont.CELL_WIDTH, HudFont.ATLAS_ROWS * HudFont.CELL_HEIGHT, 0,
+                PixelFormat.Red, PixelType.UnsignedByte,
+                HudFont.BakeAtlas());
+            GL.PixelStore(PixelStoreParameter.UnpackAlignment, 4);
+            GL.TexParameter(TextureTarget.Texture2D, TextureParameterName.TextureMinFilter, (int)TextureMinFilter.Nearest);
+            GL.TexParameter(TextureTarget.Texture2D, TextureParameterName.TextureMagFilter, (int)TextureMagFilter.Nearest);
+            GL.BindTexture(TextureTarget.Texture2D, 0);
+
+            int size = REGIONS * instances.Length * sizeof(int);
+            vbo_instances = GL.GenBuffer();
+            GL.BindBuffer(BufferTarget.ArrayBuffer, vbo_instances);
+
+            if (IsPersistentMappingSupported)
+            {
+                var flags = BufferStorageFlags.MapWriteBit | BufferStorageFlags.MapPersistentBit | BufferStorageFlags.MapCoherentBit;
+                GL.BufferStorage(BufferTarget.ArrayBuffer, size, IntPtr.Zero, flags);
+                mapped = GL.MapBufferRange(BufferTarget.ArrayBuffer, IntPtr.Zero, size,
+                    BufferAccessMask.MapWriteBit | BufferAccessMask.MapPersistentBit | BufferAccessMask.MapCoherentBit);
+            }
+            else
+                GL.BufferData(BufferTarget.ArrayBuffer, size, IntPtr.Zero, BufferUsageHint.StreamDraw);
+
+            vao = GL.GenVertexArray();
+            GL.BindVertexArray(vao);
+            GL.EnableVertexAttribArray(0);
+            GL.VertexAttribIPointer(0, INSTANCE_INTS, VertexAttribIntegerType.Int, INSTANCE_SIZE, IntPtr.Zero);
+            GL.VertexAttribDivisor(0, 1);
+            GL.BindVertexArray(0);
+            GL.BindBuffer(BufferTarget.ArrayBuffer, 0);
+
+            lastTimestamp = Stopwatch.GetTimestamp();
+        }
+
+        /// <summary>
+        /// Replaces the stats text, lines end with '\n'. Called by the window thread.
+        /// </summary>
+        public void Post(StringBuilder stats)
+        {
+            lock (sync)
+            {
+                postedLength = Math.Min(stats.Length, MAX_TEXT);
+                stats.CopyTo(0, postedText, 0, postedLength);
+            }
+        }
+
+        /// <summary>
+        /// Records the time since the last call and draws over the bound framebuffer
+        /// </summary>
+        internal void Draw(int width, int height)
+        {
+            long start = Stopwatch.GetTimestamp();
+            frameTimes[frameIndex] = (float)(start - lastTimestamp) / Stopwatch.Frequency;
+            frameIndex = (frameIndex + 1) % frameTimes.Length;
+            lastTimestamp = start;
+
+            if (!IsStarted || !Enabled)
+                return;
+
+            lock (sync)
+            {
+                Array.Copy(postedText, text, postedLength);
+                textLength = postedLength;
+            }
+
+            count = 0;
+            int bottom = LayoutText(Const.HUD_MARGIN, Const.HUD_MARGIN);
+            LayoutGraph(Const.HUD_MARGIN, bottom + Const.HUD_MARGIN);
+
+            Submit(width, height);
+
+            Profiler.Count(Const.PROFILER_HUD_US, (Stopwatch.GetTimestamp() - start) * 1000000 / Stopwatch.Frequency);
+        }
+
+        void Add(int x, int y, int width, int height, int glyph, uint rgba)
+        {
+            if (count == Const.HUD_MAX_INSTANCES)
+                return;
+
+            int i = count++ * INSTANCE_INTS;
+            instances[i] = x | y << 16;
+            instances[i + 1] = width | height << 16;
+            instances[i + 2] = glyph;
+            instances[i + 3] = (int)rgba;
+        }
+
+        /// <returns>Bottom of the text block in pixels</returns>
+        int LayoutText(int left, int top)
+        {
+            int scale = Const.HUD_TEXT_SCALE;
+            int cellWidth = HudFont.CELL_WIDTH * scale,
+                cellHeight = HudFont.CELL_HEIGHT * scale;
+
+            int lines = 0,
+                column = 0,
+                columns = 0;
+
+            // backdrop first, its size is known once the text is laid out
+            int backdrop = count;
+            Add(0, 0, 0, 0, SOLID, Const.HUD_BACKDROP_COLOR);
+
+            for (int k = 0; k < textLength; k++)
+            {
+                char c = text[k];
+                if (c == '\n')
+                {
+                    lines++;
+                    column = 0;
+                    continue;
+                }
+
+                if (c > HudFont.FIRST && c <= HudFont.LAST)
+                    Add(left + column * cellWidth, top + lines * cellHeight, cellWidth, cellHeight, c - HudFont.FIRST, Const.HUD_TEXT_COLOR);
+
+                column++;
+                columns = Math.Max(columns, column);
+            }
+
+            if (column > 0)
+                lines++;
+
+            int bottom = top + lines * cellHeight;
+            int i = backdrop * INSTANCE_INTS;
+            instances[i] = (left - scale) | (top - scale) << 16;
+            instances[i + 1] = (columns * cellWidth + scale) | (lines * cellHeight + scale) << 16;
+
+            return bottom;
+        }
+
+        /// <summary>
+        /// A bar per recorded frame, the newest on the right, and lines at 60 and 30 fps
+        /// </summary>
+        void LayoutGraph(int left, int top)
+        {
+            int samples = frameTimes.Length,
+                height = Const.HUD_GRAPH_HEIGHT;
+            float pixelsPerSecond = height / Const.HUD_GRAPH_MAX_TIME;
+
+            Add(left, top, samples, height, SOLID, Const.HUD_BACKDROP_COLOR);
+
+            for (int k = 0; k < samples; k++)
+            {
+                float time = frameTimes[(frameIndex + k) % samples];
+                int bar = Math.Min((int)(time * pixelsPerSecond + 0.5f), height);
+                if (bar == 0)
+                    continue;
+
+                uint color = time <= 1f / 60f ? Const.HUD_GRAPH_GOOD_COLOR
+                    : time <= 1f / 30f ? Const.HUD_GRAPH_SLOW_COLOR
+                    : Const.HUD_GRAPH_BAD_COLOR;
+
+                Add(left + k, top + height - bar, 1, bar, SOLID, color);
+            }
+
+            Add(left, top + height - (int)(pixelsPerSecond / 60f), samples, 1, SOLID, Const.HUD_GRAPH_LINE_COLOR);
+            Add(left, top + height - (int)(pixelsPerSecond / 30f), samples, 1, SOLID, Const.HUD_GRAPH_LINE_COLOR);
+        }
+
+        void Submit(int width, int height)
+        {
+            int offset = region * instances.Length * sizeof(int);
+            int size = count * INSTANCE_SIZE;
+            int drawRegion = region,
+                drawCount = count;
+
+            GL.BindBuffer(BufferTarget.ArrayBuffer, vbo_instances);
+
+            if (mapped != IntPtr.Zero)
+            {
+                // the GPU is never more than a few frames behind, a region is normally free
+                if (fences[region] != IntPtr.Zero)
+                {
+                    WaitSyncStatus status = GL.ClientWaitSync(fences[region], ClientWaitSyncFlags.SyncFlushCommandsBit, REGION_TIMEOUT);
+                    if (status == WaitSyncStatus.AlreadySignaled || status == WaitSyncStatus.ConditionSatisfied)
+                    {
+                        GL.DeleteSync(fences[region]);
+                        fences[region] = IntPtr.Zero;
+                    }
+                    else
+                    {
+                        // still read by the GPU, this frame shows the last written one
+                        drawRegion = lastRegion;
+                        drawCount = lastCount;
+                    }
+                }
+
+                if (drawRegion == region)
+                    Marshal.Copy(instances, 0, mapped + offset, count * INSTANCE_INTS);
+            }
+            else
+                GL.BufferSubData(BufferTarget.ArrayBuffer, (IntPtr)offset, size, instances);
+
+            if (drawRegion < 0)
+            {
+                GL.BindBuffer(BufferTarget.ArrayBuffer, 0);
+                return;
+            }
+
+            GL.BindVertexArray(vao);
+            GL.VertexAttribIPointer(0, INSTANCE_INTS, VertexAttribIntegerType.Int, INSTANCE_SIZE, (IntPtr)(drawRegion * instances.Length * sizeof(int)));
+            GL.BindBuffer(BufferTarget.ArrayBuffer, 0);
+
+            GL.UseProgram(h_program);
+            GL.Uniform2(uf_Resolution, (float)width, (float)height);
+            GL.ActiveTexture(TextureUnit.Texture0);
+            GL.BindTexture(TextureTarget.Texture2D, tex_atlas);
+            GL.Uniform1(uf_Atlas, 0);
+
+            GL.Enable(EnableCap.Blend);
+            GL.BlendFunc(BlendingFactor.SrcAlpha, BlendingFactor.OneMinusSrcAlpha);
+            GL.DrawArraysInstanced(PrimitiveType.TriangleStrip, 0, 4, drawCount);
+            GL.Disable(EnableCap.Blend);
+
+            GL.BindTexture(TextureTarget.Texture2D, 0);
+            GL.UseProgram(0);
+            GL.BindVertexArray(0);
+
+            if (mapped != IntPtr.Zero)
+            {
+                if (fences[drawRegion] != IntPtr.Zero)
+                    GL.DeleteSync(fences[drawRegion]);
+                fences[drawRegion] = GL.FenceSync(SyncCondition.SyncGpuCommandsComplete, WaitSyncFlags.None);
+            }
+
+            // a skipped region is tried again next frame
+            if (drawRegion == region)
+            {
+                lastRegion = region;
+                lastCount = count;
+                region = (region + 1) % REGIONS;
+            }
+        }
+
+        internal void Stop()
+        {
+            if (!IsStarted)
+                return;
+
+            foreach (IntPtr fence in fences)
+                if (fence != IntPtr.Zero)
+                    GL.DeleteSync(fence);
+
+            if (mapped != IntPtr.Zero)
+            {
+                GL.BindBuffer(BufferTarget.ArrayBuffer, vbo_instances);
+                GL.UnmapBuffer(BufferTarget.ArrayBuffer);
+                GL.BindBuffer(BufferTarget.ArrayBuffer, 0);
+                mapped = IntPtr.Zero;
+            }
+
+            GL.DeleteBuffers(1, ref vbo_instances);
+            GL.DeleteVertexArray(vao);
+            GL.DeleteTexture(tex_atlas);
+            GL.DeleteProgram(h_program);
+            h_program = 0;
+        }
+    }
+}
@@ -0,0 +1,57 @@
+﻿namespace GldeTK
+{
+    /// <summary>
+    /// 5x7 bitmap font of printable ASCII for the Hud, baked into an atlas of 6x8 cells
+    /// (a column and a row of spacing) at startup
+    /// </summary>
+    public static class HudFont
+    {
+        public const char FIRST = ' ';
+        public const char LAST = '~';
+        public const int GLYPH_WIDTH = 5;
+        public const int GLYPH_HEIGHT = 7;
+        public const int CELL_WIDTH = 6;        // as in vertex_hud.c
+        public const int CELL_HEIGHT = 8;
+        public const int ATLAS_COLUMNS = 16;    // as in fragment_hud.c
+        public const int ATLAS_ROWS = (LAST - FIRST + ATLAS_COLUMNS) / ATLAS_COLUMNS;
+
+        // bit (x + 5 * y) of a glyph is set when its pixel at column x, row y from the top is lit
+        static readonly ulong[] GLYPHS =
+        {
+            0x000000000, 0x100421084, 0x00000294A, 0x295F57D4A, 0x11F4717C4, 0x632222263, 0x593511526, 0x000000884,
+            0x208210888, 0x088842082, 0x009575480, 0x0084F9080, 0x088600000, 0x0000F8000, 0x18C000000, 0x002222200,
+            0x3A33AE62E, 0x3884210C4, 0x7C444422E, 0x3A304111F, 0x211F4A988, 0x3A3083C3F, 0x3A317844C, 0x08422221F,
+            0x3A317462E, 0x1910F462E, 0x00C6018C0, 0x0886018C0, 0x208208888, 0x001F07C00, 0x088882082, 0x10044422E,
+            0x3AB5B422E, 0x4631FC62E, 0x3E317C62F, 0x3A210862E, 0x1D318C527, 0x7C217843F, 0x04217843F, 0x7A31E862E,
+            0x4631FC631, 0x38842108E, 0x19284211C, 0x452519531, 0x7C2108421, 0x4631AD771, 0x4639ACE31, 0x3A318C62E,
+            0x04217C62F, 0x59358C62E, 0x45257C62F, 0x3E107043E, 0x10842109F, 0x3A318C631, 0x11518C631, 0x2AB5AC631,
+            0x462A22A31, 0x108422A31, 0x7C222221F, 0x38421084E, 0x020820820, 0x39084210E, 0x000004544, 0x7C0000000,
+            0x000002082, 0x7A3E83800, 0x3E319B421, 0x3A210B800, 0x7A31CDA10, 0x383F8B800, 0x084238A4C, 0x3A1E8C7C0,
+            0x46319B421, 0x388421804, 0x192843008, 0x24A32A421, 0x388421086, 0x4635AAC00, 0x46319B400, 0x3A318B800,
+            0x042F8BC00, 0x421ECD800, 0x04219B400, 0x3E0E0B800, 0x324211C42, 0x5B318C400, 0x11518C400, 0x2AB58C400,
+            0x454454400, 0x3A1E8C400, 0x7C4447C00, 0x208411088, 0x108421084, 0x088441082, 0x0008A8800,
+        };
+
+        /// <summary>
+        /// R8 texels of the atlas, row by row from the top, the glyph of code c in cell c - FIRST
+        /// </summary>
+        public static byte[] BakeAtlas()
+        {
+            int width = ATLAS_COLUMNS * CELL_WIDTH;
+            var atlas = new byte[width * ATLAS_ROWS * CELL_HEIGHT];
+
+            for (int g = 0; g < GLYPHS.Length; g++)
+            {
+                int x0 = (g % ATLAS_COLUMNS) * CELL_WIDTH,
+                    y0 = (g / ATLAS_COLUMNS) * CELL_HEIGHT;
+
+                for (int y = 0; y < GLYPH_HEIGHT; y++)
+                    for (int x = 0; x < GLYPH_WIDTH; x++)
+                        if ((GLYPHS[g] >> (x + GLYPH_WIDTH * y) & 1) != 0)
+                            atlas[(y0 + y) * width + x0 + x] = 255;
+            }
+
+            return atlas;
+        }
+    }
+}
@@ -0,0 +1,215 @@
+﻿using OpenTK;
+using System;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// CPU reference of the empty space culling in compute_cull.c: interval bound of the
+    /// scene map over a tile frustum slab, per tile ray start and end depths, and
+    /// the relaxed sphere tracing of castRay() to count the march steps
+    /// </summary>
+    public static class IntervalCulling
+    {
+        public const int SEGMENTS = 64;             // CULL_SEGMENTS of scene.c
+        public const float MAX_DIST = 100f;         // MARCH_MAX_DIST of scene.c
+        public const float MIN_DIST = 0.0002f;
+        public const int MAX_STEPS = 100;
+
+        static readonly Vector3 SPHERE_REP = new Vector3(10f, 10f, 10f);
+        static readonly Vector3 BOX_REP = new Vector3(7f, 0f, 9f);
+        static readonly Vector3 CYLINDER_REP = new Vector3(12f, 0f, 13f);
+
+        public static float SegmentDepth(int i)
+        {
+            float s = (float)i / SEGMENTS;
+            return MAX_DIST * s * s;
+        }
+
+        /// <summary>
+        /// Smallest |opRep(x, c)| over x in [lo, hi], c == 0 leaves the axis unrepeated
+        /// </summary>
+        public static float MinAbsRep(float lo, float hi, float c)
+        {
+            if (c == 0f)
+                return lo > 0f ? lo : (hi < 0f ? -hi : 0f);
+
+            if (hi - lo >= c)
+                return 0f;
+
+            float a = Mod(lo, c) - 0.5f * c;
+            float b = Mod(hi, c) - 0.5f * c;
+
+            if (a <= b)
+                return a > 0f ? a : (b < 0f ? -b : 0f);
+
+            return Math.Min(Math.Max(a, 0f), Math.Max(-b, 0f));
+        }
+
+        public static Vector3 MinAbsRep(Vector3 lo, Vector3 hi, Vector3 c)
+        {
+            return
+                new Vector3(
+                    MinAbsRep(lo.X, hi.X, c.X),
+                    MinAbsRep(lo.Y, hi.Y, c.Y),
+                    MinAbsRep(lo.Z, hi.Z, c.Z));
+        }
+
+        /// <summary>
+        /// Distance between the boxes [lo, hi] and [boxLo, boxHi], 0 when they overlap
+        /// </summary>
+        static float BoxGap(Vector3 lo, Vector3 hi, Vector3 boxLo, Vector3 boxHi)
+        {
+            return Physics.MaxV3(Physics.MaxV3(lo - boxHi, boxLo - hi), 0f).Length;
+        }
+
+        /// <summary>
+        /// Lower bound of Map() over the box [lo, hi], positive means the box is empty.
+        /// mapLower() of scene.c, the Sculpt bricks and the bodies are taken from the frame.
+        /// </summary>
+        public static float MapLower(SdScene scene, ref FrameState frame, Vector3 lo, Vector3 hi)
+        {
+            Vector4 sp = scene.Parameters;
+            float d = lo.Y;
+
+            // the edited ground may rise anywhere in its bricks
+            if (frame.SculptLo.W != 0f)
+                d = Math.Min(d, BoxGap(lo, hi, frame.SculptLo.Xyz, frame.SculptHi.Xyz));
+
+            d = Math.Min(d, MinAbsRep(lo, hi, SPHERE_REP).Length - sp.X);
+            d = Math.Min(d, Physics.SdBox(MinAbsRep(lo, hi, BOX_REP), new Vector3(sp.Y, sp.Z, sp.W)));
+            d = Math.Min(d, Physics.SdCylinder(MinAbsRep(lo, hi, CYLINDER_REP), 1f, 30f));
+
+            foreach (var e in scene.Elements)
+                d = Math.Min(d, BoxGap(lo, hi, e.Position, e.Position) - e.BoundRadius);
+
+            // bodies stay the margin inside their grid
+            if (frame.BodyCount > 0)
+            {
+                Vector3 cell = new Vector3(frame.BodyGrid.W);
+                Vector3 cells = new Vector3(Const.BODY_GRID_X, Const.BODY_GRID_Y, Const.BODY_GRID_Z);
+                d = Math.Min(d, BoxGap(lo, hi, frame.BodyGrid.Xyz + 0.5f * cell, frame.BodyGrid.Xyz + (cells - new Vector3(0.5f)) * cell));
+            }
+
+            return d;
+        }
+
+        /// <summary>
+        /// Distance of map() in scene.c, a zero repeat period leaves the axis unrepeated
+        /// </summary>
+        public static float Map(SdScene scene, Vector3 p)
+        {
+            Vector4 sp = scene.Parameters;
+            float d = p.Y;
+
+            d = Math.Min(d, OpRep(p, SPHERE_REP).Length - sp.X);
+            d = Math.Min(d, Physics.SdBox(OpRep(p, BOX_REP), new Vector3(sp.Y, sp.Z, sp.W)));
+            d = Math.Min(d, Physics.SdCylinder(OpRep(p, CYLINDER_REP), 1f, 30f));
+
+            return Math.Min(d, scene.Distance(p));
+        }
+
+        /// <summary>
+        /// Depth range along the view axis that may hold a surface,
+        /// (MAX_DIST, MAX_DIST) for an empty tile
+        /// </summary>
+        public static Vector2 TileRange(SdScene scene, ref FrameState frame, Camera camera, int tileX, int tileY, int width, int height)
+        {
+            float x0 = tileX * Const.BIN_TILE_SIZE,
+                y0 = tileY * Const.BIN_TILE_SIZE,
+                x1 = x0 + Const.BIN_TILE_SIZE,
+                y1 = y0 + Const.BIN_TILE_SIZE;
+
+            var corners = new[] {
+                camera.GetRayDirection(x0, y0, width, height),
+                camera.GetRayDirection(x1, y0, width, height),
+                camera.GetRayDirection(x1, y1, width, height),
+                camera.GetRayDirection(x0, y1, width, height)
+            };
+
+            Vector3 forward = camera.Projection.Row2;
+            for (int i = 0; i < corners.Length; i++)
+                corners[i] /= Vector3.Dot(corners[i], forward);
+
+            int first = SEGMENTS,
+                last = -1;
+
+            for (int s = 0; s < SEGMENTS; s++)
+            {
+                float z0 = SegmentDepth(s),
+                    z1 = SegmentDepth(s + 1);
+
+                Vector3 lo = new Vector3(float.MaxValue),
+                    hi = new Vector3(float.MinValue);
+
+                foreach (var dz in corners)
+                {
+                    Vector3 p0 = camera.Origin + dz * z0,
+                        p1 = camera.Origin + dz * z1;
+
+                    lo = Vector3.ComponentMin(lo, Vector3.ComponentMin(p0, p1));
+                    hi = Vector3.ComponentMax(hi, Vector3.ComponentMax(p0, p1));
+                }
+
+                if (MapLower(scene, ref frame, lo, hi) <= MIN_DIST)
+                {
+                    first = Math.Min(first, s);
+                    last = s;
+                }
+            }
+
+            if (first > last)
+                return new Vector2(MAX_DIST, MAX_DIST);
+
+            return new Vector2(SegmentDepth(first), SegmentDepth(Math.Min(last + 2, SEGMENTS)));
+        }
+
+        /// <summary>
+        /// castRay() of scene.c over [start, end]
+        /// </summary>
+        /// <returns>Number of march steps</returns>
+        public static int March(SdScene scene, Vector3 ro, Vector3 rd, float start, float end, out float t)
+        {
+            float overstep = 0f,
+                phx = MAX_DIST,
+                h = 1f;
+            int i = 0;
+
+            t = start;
+            while (i < MAX_STEPS && t < end && h >= MIN_DIST)
+            {
+                h = Map(scene, ro + rd * t);
+
+                if (h > overstep)
+                {
+                    overstep = h * Math.Min(1f, 0.5f * h / phx);
+                    t += h * 0.5f + overstep;
+                    phx = h;
+                    i++;
+                }
+                else
+                {
+                    t -= overstep;
+                    phx = MAX_DIST;
+                    h = 1f;
+                    overstep = 0f;
+                }
+            }
+
+            if (t >= end && h >= MIN_DIST)
+                t = Math.Max(t, MAX_DIST);
+
+            return i;
+        }
+
+        static float Mod(float x, float c) => x - c * (float)Math.Floor(x / c);
+
+        static Vector3 OpRep(Vector3 p, Vector3 c)
+        {
+            return
+                new Vector3(
+                    c.X != 0f ? Mod(p.X, c.X) - 0.5f * c.X : p.X,
+                    c.Y != 0f ? Mod(p.Y, c.Y) - 0.5f * c.Y : p.Y,
+                    c.Z != 0f ? Mod(p.Z, c.Z) - 0.5f * c.Z : p.Z);
+        }
+    }
+}
@@ -0,0 +1,167 @@
+﻿using OpenTK;
+using System;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// CPU side of lipschitz.c: the non-metric fields, their Lipschitz bounds and
+    /// a check that flags overshoot, a field crossing its surface within the step
+    /// its distance bound allows
+    /// </summary>
+    public static class Lipschitz
+    {
+        public const float SCHERK_AXIS = 2f;        // LIP_SCHERK_AXIS of lipschitz.c
+        public const float SCHERK = 3.4641f;
+        public const float KTOWER = 4.6904f;
+        public const float PLANE_SIN = 1.0440f;
+        public const float SCHERK_FOLD = 2f;        // fragment_scherk.c
+
+        const float GRADIENT_EPS = 0.001f;
+        const float GRADIENT_MARGIN = 1.25f;
+
+        public struct Report
+        {
+            public int Samples;
+            public int Overshoots;
+
+            /// <summary>
+            /// Steepest slope seen between a sample and its probes
+            /// </summary>
+            public float MaxSlope;
+
+            /// <summary>
+            /// Mean step of the bound relative to the raw field value
+            /// </summary>
+            public float MeanStepRatio;
+        }
+
+        public static float ScherkDe(Vector3 p)
+        {
+            double ex = Math.Exp(p.X),
+                ey = Math.Exp(p.Y),
+                zz = ex * ey,
+                n = ex * ex + ey * ey,
+                d = 1.0 + zz * zz;
+
+            zz = 4.0 * Math.Sin(p.Z) * zz;
+            if (zz > 0.0) n += zz; else d -= zz;
+
+            return (float)Math.Abs(Math.Log(n / d)) - 0.05f;
+        }
+
+        public static float KTower(Vector3 p)
+        {
+            double t = 1.5 * Math.Atan2(p.Y, p.X),
+                u = Math.Sqrt(p.X * p.X + p.Y * p.Y);
+
+            return ScherkDe(new Vector3((float)(Math.Sin(t) * u), (float)(Math.Cos(t) * u), p.Z));
+        }
+
+        public static float SdPlaneSin(Vector3 p, float globalTime)
+        {
+            return p.Y + (float)(Math.Cos(p.X - globalTime * 0.1) * Math.Sin(p.Z - globalTime * 0.1)) * 0.3f;
+        }
+
+        /// <summary>
+        /// scherkSin() of fragment_scherk.c
+        /// </summary>
+        public static float ScherkSin(Vector3 p)
+        {
+            return ScherkDe(
+                new Vector3(
+                    SCHERK_FOLD * (float)Math.Sin(p.X),
+                    SCHERK_FOLD * (float)Math.Sin(p.Y),
+                    p.Z)) / SCHERK_FOLD;
+        }
+
+        /// <summary>
+        /// Slope bound of ScherkSin within distance r of p
+        /// </summary>
+        public static float ScherkSinLipschitz(Vector3 p, float r)
+        {
+            float cx = Math.Min(Math.Abs((float)Math.Cos(p.X)) + r, 1f),
+                cy = Math.Min(Math.Abs((float)Math.Cos(p.Y)) + r, 1f);
+
+            return SCHERK_AXIS * new Vector3(cx, cy, 1f / SCHERK_FOLD).Length;
+        }
+
+        /// <summary>
+        /// scherkSinBound() of fragment_scherk.c in the LIPSCHITZ_LOCAL mode
+        /// </summary>
+        public static float ScherkSinLocalBound(Vector3 p)
+        {
+            float d = ScherkSin(p);
+            return d / ScherkSinLipschitz(p, Math.Abs(d) / ScherkSinLipschitz(p, 0f));
+        }
+
+        /// <summary>
+        /// Distance bound of LIPSCHITZ_GRADIENT: slope measured at p, not guaranteed
+        /// </summary>
+        public static float GradientBound(Func<Vector3, float> field, Vector3 p, float lipschitz)
+        {
+            var slope = new Vector3(
+                field(p + new Vector3(GRADIENT_EPS, 0, 0)) - field(p - new Vector3(GRADIENT_EPS, 0, 0)),
+                field(p + new Vector3(0, GRADIENT_EPS, 0)) - field(p - new Vector3(0, GRADIENT_EPS, 0)),
+                field(p + new Vector3(0, 0, GRADIENT_EPS)) - field(p - new Vector3(0, 0, GRADIENT_EPS))
+                ).Length / (2f * GRADIENT_EPS);
+
+            return field(p) / Math.Max(1f, Math.Min(slope * GRADIENT_MARGIN, lipschitz));
+        }
+
+        /// <summary>
+        /// Steps from random points outside the surface by their bound along random directions,
+        /// any probe inside the surface is an overshoot
+        /// </summary>
+        public static Report Validate(Func<Vector3, float> field, Func<Vector3, float> bound, Vector3 center, float extent, int samples, int seed = 1)
+        {
+            const int DIRECTIONS = 8;
+            const int PROBES = 8;
+
+            var rnd = new Random(seed);
+            var report = new Report();
+            double stepRatio = 0;
+
+            while (report.Samples < samples)
+            {
+                Vector3 p = center + extent * RandomVector(rnd);
+                float d = field(p);
+                if (d <= 0f)
+                    continue;
+
+                float step = bound(p);
+                report.Samples++;
+                stepRatio += step / d;
+
+                bool overshoot = false;
+                for (int i = 0; i < DIRECTIONS; i++)
+                {
+                    Vector3 dir = Vector3.Normalize(RandomVector(rnd));
+
+                    for (int j = 1; j <= PROBES; j++)
+                    {
+                        float r = step * j / PROBES;
+                        float dq = field(p + dir * r);
+
+                        report.MaxSlope = Math.Max(report.MaxSlope, Math.Abs(dq - d) / r);
+                        overshoot |= dq < 0f;
+                    }
+                }
+
+                if (overshoot)
+                    report.Overshoots++;
+            }
+
+            report.MeanStepRatio = (float)(stepRatio / Math.Max(report.Samples, 1));
+            return report;
+        }
+
+        static Vector3 RandomVector(Random rnd)
+        {
+            return
+                new Vector3(
+                    (float)rnd.NextDouble() * 2f - 1f,
+                    (float)rnd.NextDouble() * 2f - 1f,
+                    (float)rnd.NextDouble() * 2f - 1f);
+        }
+    }
+}
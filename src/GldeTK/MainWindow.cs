@@ -1,6 +1,7 @@
 ﻿using OpenTK;
 using OpenTK.Input;
 using System;
+using System.Text;
 using System.Timers;
 
 namespace GldeTK
@@ -8,20 +9,34 @@ namespace GldeTK
     public class MainWindow : GameWindow
     {
         Camera camera;
+        SdScene scene;
         FpsController motionCtrl;
         Physics physics;
+        RigidBodies bodies;
         Render render;
+        RenderThread renderThread;
+        WorldStreamer streamer;
+        Sculpt sculpt;
 
         Timer inputUpdateTimer;
 
-        public MainWindow()
+        /// <param name="pack">Scene to start with instead of the empty one, kept open by the caller</param>
+        public MainWindow(ScenePack pack = null)
         {
-            Title = Const.APP_NAME;
+            Title = $"{Const.APP_NAME}, {Const.RELEASE_DATE}";
             VSync = VSyncMode.Adaptive;
             Width = Const.DISPLAY_XGA_W;
             Height = Const.DISPLAY_XGA_H;
 
-            render = new Render();
+            scene = new SdScene();
+            if (pack != null)
+                scene.SetElements(pack);
+
+            sculpt = new Sculpt();
+            physics = new Physics(scene, sculpt);
+            streamer = new WorldStreamer(scene);
+            bodies = new RigidBodies(physics);
+            render = new Render(scene, sculpt, bodies, physics.Queries);
 
             camera = new Camera(
                     new Vector3(3, 1, 0),
@@ -29,8 +44,8 @@ namespace GldeTK
                     new Vector3(0, 1, 0)
                     );
 
-            physics = new Physics();
             motionCtrl = new FpsController();
+            renderThread = new RenderThread(this, render, motionCtrl);
 
             inputUpdateTimer = new Timer(Const.INPUT_UPDATE_INTERVAL);
             inputUpdateTimer.Elapsed += UpdateInput;
@@ -44,6 +59,7 @@ namespace GldeTK
             float delta = (e.SignalTime.Ticks - lastTicks) / 10000000.0f;
             lastTicks = e.SignalTime.Ticks;
             physics.GlobalTime += delta;
+            physics.BeginTick();
 
             // update player input (keyboard_wasd+space+shift + mouse-look)
             Ray motionStep = motionCtrl.Update(delta, camera.RayCopy);
@@ -59,7 +75,8 @@ namespace GldeTK
             motionStep.Origin += freeFallVector;
 
             // wall collide
-            float sd = physics.CastRay(
+            float sd = physics.QueryRay(
+                Const.QUERY_SLOT_WALL,
                 camera.Origin,
                 Vector3.NormalizeFast(motionStep.Origin)
                 );
@@ -70,7 +87,7 @@ namespace GldeTK
                 camera.Target = motionStep.Target;    // view only
                 // smooth wall sliding
                 Vector3 hitPoint = camera.Origin + motionStep.Origin * Const.PLAYER_HIT_RADIUS;
-                Vector3 norm = physics.GetSurfaceNormal(hitPoint);
+                Vector3 norm = physics.QueryNormal(Const.QUERY_SLOT_WALL_NORMAL, hitPoint);
                 Vector3 invNorm = -norm;
                 invNorm *= (motionStep.Origin * norm).LengthFast;
 
@@ -78,6 +95,13 @@ namespace GldeTK
             }
 
             camera.Translate(motionStep);
+            physics.EndTick();
+
+            // the residency of this tick is what the bodies and the frame see
+            streamer.Update(camera.Origin, delta);
+
+            bodies.Step(delta);
+            renderThread.Post(new FrameSnapshot(physics.GlobalTime, camera, scene.Version));
 
             var keyboard = Keyboard.GetState();
             UpdateWindowKeys(keyboard);
@@ -86,12 +110,12 @@ namespace GldeTK
 
         protected override void OnLoad(EventArgs e)
         {
-            render.Start();
+            renderThread.Start();
         }
 
         protected override void OnResize(EventArgs e)
         {
-            render.OnResize(Width, Height);
+            renderThread.PostResize(Width, Height);
         }
 
         KeyboardState lastKeyboard = new KeyboardState();
@@ -121,28 +145,164 @@ namespace GldeTK
                             Const.DISPLAY_REFRESH_RATE);
                 }
             } // if state F11
+
+            if (keyboard[Const.INPUT_KEY_BACKEND] && (lastKeyboard[Const.INPUT_KEY_BACKEND] != keyboard[Const.INPUT_KEY_BACKEND]))
+                render.ToggleBackend();
+
+            if (keyboard[Const.INPUT_KEY_TILE_BINNING] && (lastKeyboard[Const.INPUT_KEY_TILE_BINNING] != keyboard[Const.INPUT_KEY_TILE_BINNING]))
+                render.ToggleTileBinning();
+
+            if (keyboard[Const.INPUT_KEY_TILE_CULLING] && (lastKeyboard[Const.INPUT_KEY_TILE_CULLING] != keyboard[Const.INPUT_KEY_TILE_CULLING]))
+                render.ToggleTileCulling();
+
+            if (keyboard[Const.INPUT_KEY_REFINEMENT] && (lastKeyboard[Const.INPUT_KEY_REFINEMENT] != keyboard[Const.INPUT_KEY_REFINEMENT]))
+                render.ToggleProgressiveRefinement();
+
+            if (keyboard[Const.INPUT_KEY_PARTICLES] && (lastKeyboard[Const.INPUT_KEY_PARTICLES] != keyboard[Const.INPUT_KEY_PARTICLES]))
+                render.CycleParticles();
+
+            if (keyboard[Const.INPUT_KEY_OCCLUSION_SCALE] && (lastKeyboard[Const.INPUT_KEY_OCCLUSION_SCALE] != keyboard[Const.INPUT_KEY_OCCLUSION_SCALE]))
+                render.CycleOcclusionScale();
+
+            if (keyboard[Const.INPUT_KEY_SHADOW_MAP] && (lastKeyboard[Const.INPUT_KEY_SHADOW_MAP] != keyboard[Const.INPUT_KEY_SHADOW_MAP]))
+                render.ToggleShadowMap();
+
+            if (keyboard[Const.INPUT_KEY_AO_CACHE] && (lastKeyboard[Const.INPUT_KEY_AO_CACHE] != keyboard[Const.INPUT_KEY_AO_CACHE]))
+                render.ToggleAoCache();
+
+            if (keyboard[Const.INPUT_KEY_CAPTURE] && (lastKeyboard[Const.INPUT_KEY_CAPTURE] != keyboard[Const.INPUT_KEY_CAPTURE]))
+                render.ToggleCapture();
+
+            if (keyboard[Const.INPUT_KEY_HUD] && (lastKeyboard[Const.INPUT_KEY_HUD] != keyboard[Const.INPUT_KEY_HUD]))
+                render.ToggleHud();
+
+            if (keyboard[Const.INPUT_KEY_RASTER] && (lastKeyboard[Const.INPUT_KEY_RASTER] != keyboard[Const.INPUT_KEY_RASTER]))
+                render.ToggleRasterElements();
+
+            if (keyboard[Const.INPUT_KEY_FRAME_LIMITER] && (lastKeyboard[Const.INPUT_KEY_FRAME_LIMITER] != keyboard[Const.INPUT_KEY_FRAME_LIMITER]))
+            {
+                FrameLimiter frameLimiter = renderThread.FrameLimiter;
+                int depth = Array.IndexOf(Const.FRAME_LIMITER_DEPTHS, frameLimiter.Depth);
+                frameLimiter.Depth = Const.FRAME_LIMITER_DEPTHS[(depth + 1) % Const.FRAME_LIMITER_DEPTHS.Length];
+            }
+
+            // burst of debris thrown from the player, starts over when full
+            if (keyboard[Const.INPUT_KEY_BODIES] && (lastKeyboard[Const.INPUT_KEY_BODIES] != keyboard[Const.INPUT_KEY_BODIES]))
+                SpawnBodies();
+
+            if (keyboard[Const.INPUT_KEY_STREAMING] && (lastKeyboard[Const.INPUT_KEY_STREAMING] != keyboard[Const.INPUT_KEY_STREAMING]))
+                streamer.Toggle();
+
+            // blob on or hole in the ground where the view ray hits
+            if (keyboard[Const.INPUT_KEY_SCULPT_ADD] && (lastKeyboard[Const.INPUT_KEY_SCULPT_ADD] != keyboard[Const.INPUT_KEY_SCULPT_ADD]))
+                SculptAtAim(SculptOp.SmoothUnion, Const.SCULPT_BLOB_RADIUS);
+
+            if (keyboard[Const.INPUT_KEY_SCULPT_CARVE] && (lastKeyboard[Const.INPUT_KEY_SCULPT_CARVE] != keyboard[Const.INPUT_KEY_SCULPT_CARVE]))
+                SculptAtAim(SculptOp.SmoothSubtract, Const.SCULPT_HOLE_RADIUS);
+
+            // next size of the random element field around the player
+            if (keyboard[Const.INPUT_KEY_SCENE_FIELD] && (lastKeyboard[Const.INPUT_KEY_SCENE_FIELD] != keyboard[Const.INPUT_KEY_SCENE_FIELD]))
+            {
+                if (streamer.Enabled)
+                    streamer.Toggle();
+
+                int size = Array.IndexOf(Const.SCENE_FIELD_SIZES, scene.Count);
+                size = Const.SCENE_FIELD_SIZES[(size + 1) % Const.SCENE_FIELD_SIZES.Length];
+
+                scene.SetElements(
+                    SdScene.Scatter(size, camera.Origin, Const.SCENE_FIELD_EXTENT));
+            }
         } // UpdateWindowKeys()
 
+        Random spawnRandom = new Random();
+        private void SpawnBodies()
+        {
+            if (bodies.Count + Const.BODIES_SPAWN_COUNT > bodies.Capacity)
+                bodies.Clear();
+
+            Vector3 forward = Vector3.Normalize(camera.Target);
+
+            for (int i = 0; i < Const.BODIES_SPAWN_COUNT; i++)
+            {
+                var spread = new Vector3(
+                    (float)spawnRandom.NextDouble() - 0.5f,
+                    (float)spawnRandom.NextDouble() - 0.5f,
+                    (float)spawnRandom.NextDouble() - 0.5f);
+                float r = 0.1f + (float)spawnRandom.NextDouble() * (Const.BODIES_MAX_RADIUS - 0.1f);
+
+                bodies.Add(
+                    camera.Origin + forward * (Const.PLAYER_HIT_RADIUS + 1f) + spread,
+                    (forward + spread * 0.5f + Vector3.UnitY * 0.3f) * Const.BODIES_SPAWN_SPEED,
+                    r);
+            }
+        }
+
+        private void SculptAtAim(SculptOp op, float radius)
+        {
+            Vector3 forward = Vector3.Normalize(camera.Target);
+            float t = Math.Min(physics.CastRay(camera.Origin, forward), Const.SCULPT_REACH);
+
+            sculpt.Add(new SculptEdit(
+                op,
+                new SdElement(SdElementType.Sphere, camera.Origin + forward * t, new Vector3(radius)),
+                Const.SCULPT_SMOOTHING));
+        }
+
         double s1_timer = 0;    // smooth fps printing
+        StringBuilder stats = new StringBuilder();
 
-        protected override void OnRenderFrame(FrameEventArgs e)
+        /// <summary>
+        /// Window thread, drawing runs on the RenderThread
+        /// </summary>
+        protected override void OnUpdateFrame(FrameEventArgs e)
         {
-            float delta = (float)e.Time;
+            float delta = Math.Max(renderThread.FrameTime, 0.001f);
 
             if (physics.GlobalTime - s1_timer > 1)
             {
-                Title = $"{Const.APP_NAME}, {Const.RELEASE_DATE} — {(delta * 1000).ToString("0.")}ms, {(1.0 / delta).ToString("0")}fps // {camera.Origin.X.ToString("0.0")} : {camera.Origin.Y.ToString("0.0")} : {camera.Origin.Z.ToString("0.0")} ";
+                long frames = Math.Max(Profiler.Take(Const.PROFILER_FRAMES), 1);
+                long skipped = Profiler.Take(Const.PROFILER_FRAMES_SKIPPED);
+                long gpuQueries = Profiler.Take(Const.PROFILER_QUERIES_GPU);
+                long queries = Math.Max(gpuQueries + Profiler.Take(Const.PROFILER_QUERIES_CPU), 1);
+                long ticks = Math.Max(Profiler.Take(Const.PROFILER_TICKS), 1);
+                double mapSaved = (double)Profiler.Take(Const.PROFILER_MAP_SAVED) / ticks;
+                long shadowMaps = Profiler.Take(Const.PROFILER_SHADOW_MAPS);
+                double latency = Profiler.Take(Const.PROFILER_LATENCY) / 1000.0 / Math.Max(Profiler.Take(Const.PROFILER_LATENCY_FRAMES), 1);
+                long captured = Profiler.Take(Const.PROFILER_CAPTURE_FRAMES);
+                long dropped = Profiler.Take(Const.PROFILER_CAPTURE_DROPPED);
+                double captureCost = Profiler.Take(Const.PROFILER_CAPTURE_US) / 1000.0 / frames;
+                double hudCost = Profiler.Take(Const.PROFILER_HUD_US) / 1000.0 / frames;
+                long misses = Profiler.Take(Const.PROFILER_STREAM_MISSES);
+                long loads = Profiler.Take(Const.PROFILER_STREAM_LOADS);
+                long evictions = Profiler.Take(Const.PROFILER_STREAM_EVICTIONS);
+                long prefetched = Profiler.Take(Const.PROFILER_STREAM_PREFETCH_HITS);
+                long sculptVisible = Profiler.Take(Const.PROFILER_SCULPT_VISIBLE);
+                double sculptLatency = Profiler.Take(Const.PROFILER_SCULPT_LATENCY_US) / 1000.0 / Math.Max(sculptVisible, 1);
+                double sculptUpload = Profiler.Take(Const.PROFILER_SCULPT_UPLOAD_BYTES) / 1024.0 / Math.Max(sculptVisible, 1);
+                long sculptBakes = Profiler.Take(Const.PROFILER_SCULPT_BAKES);
+                long sculptDropped = Profiler.Take(Const.PROFILER_SCULPT_DROPPED);
+
+                stats.Clear();
+                stats.Append($"{(delta * 1000).ToString("0.")}ms, {(1.0 / delta).ToString("0")}fps, {latency.ToString("0.0")}ms latency ({(renderThread.FrameLimiter.Depth == 0 ? "driver" : renderThread.FrameLimiter.Depth.ToString())} in flight), hud {hudCost.ToString("0.00")}ms\n");
+                stats.Append($"{render.Backend}{render.TakeGpuTimes()}{(render.TileBinning ? " binned" : "")}{(render.TileCulling ? " culled" : "")}{(render.RasterElements ? " raster" : "")}{(render.ProgressiveRefinement ? " refined" : "")}{(render.Particles ? $" particles {render.ParticleCount}" : "")}{(render.ShadowMaps ? $" shadowmap {shadowMaps}x" : "")}{(render.AoCaching ? " aocache" : "")}\n");
+                stats.Append($"{(100 * skipped / frames).ToString("0")}% skipped, {(100 * gpuQueries / queries).ToString("0")}% gpu queries, {mapSaved.ToString("0.0")} map saved/tick\n");
+                stats.Append($"{scene.Count}el {bodies.Count}bodies // {camera.Origin.X.ToString("0.0")} : {camera.Origin.Y.ToString("0.0")} : {camera.Origin.Z.ToString("0.0")}\n");
+                if (streamer.Enabled)
+                    stats.Append($"stream {streamer.ResidentChunks}/{Const.STREAM_POOL_CHUNKS} chunks, {streamer.LoadedChunks} loaded, {streamer.Loading} loading, {misses} misses {loads} loads {evictions} evicted {prefetched} prefetched/s\n");
+                if (sculpt.EditCount > 0)
+                    stats.Append($"sculpt {sculpt.EditCount} edits {sculpt.BrickCount}/{Const.SCULPT_POOL_BRICKS} bricks, {sculptLatency.ToString("0.0")}ms {sculptUpload.ToString("0.0")}KB per edit, {sculptBakes} bakes {sculptDropped} dropped/s\n");
+                if (render.Recording)
+                    stats.Append($"rec {captured}f {dropped} dropped {captureCost.ToString("0.00")}ms\n");
+
+                render.PostStats(stats);
                 s1_timer = physics.GlobalTime;
             }
-
-            render.OnFrame(physics.GlobalTime, Width, Height, camera);
-            SwapBuffers();
         }
 
         protected override void OnUnload(EventArgs e)
         {
             inputUpdateTimer.Enabled = false;
-            render.Stop();
+            renderThread.Stop();
 
             base.OnClosed(e);
         }
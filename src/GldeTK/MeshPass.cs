@@ -0,0 +1,336 @@
+﻿using OpenTK;
+using OpenTK.Graphics.OpenGL4;
+using System;
+using System.Collections.Generic;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Raster pass of the hybrid pipeline (vertex_mesh.c, fragment_mesh.c). The SdElements are
+    /// drawn as instanced unit meshes into the depth buffer of FrameCache and the primary marches
+    /// leave them out. The marchers write gl_FragDepth in the same camera projection, rayDepth()
+    /// and cameraClip() of scene.c, so triangles and marched surfaces meet in the depth test.
+    /// Shadows and AO on both are still marched in the distance field, elements included.
+    /// </summary>
+    public class MeshPass
+    {
+        const int SEGMENTS = 32;        // around the sphere and the cylinder
+        const int RINGS = 16;           // pole to pole of the sphere
+        const int TYPES = 3;            // SdElementType
+        const int VERTEX_FLOATS = 6;    // position, normal
+        const int VERTEX_SIZE = VERTEX_FLOATS * sizeof(float);
+
+        int h_program,
+            h_depth;
+
+        SceneUniforms uniforms,
+            depthUniforms;
+
+        int vao,
+            vbo_vertices,
+            ibo_indices,
+            vbo_instances;
+
+        // index range of the unit mesh of every SdElementType
+        int[] firstIndex = new int[TYPES],
+            indexCount = new int[TYPES];
+
+        // element indices grouped by type
+        int[] instances = new int[SdScene.MAX_ELEMENTS];
+        int[] firstInstance = new int[TYPES],
+            instanceCount = new int[TYPES];
+
+        GpuTimer timer = new GpuTimer(Const.PROFILER_GPU_MESH);
+
+        public bool IsStarted => h_program != 0;
+
+        public void Start()
+        {
+            h_program = ShaderLoader.Link(
+                ShaderLoader.Compile(ShaderType.VertexShader, Const.VERTEX_MESH_FILENAME),
+                ShaderLoader.Compile(ShaderType.FragmentShader, Const.FRAGMENT_MESH_FILENAME));
+
+            // Link deletes the shaders, the prepass compiles its own copy of the vertex stage
+            h_depth = ShaderLoader.Link(
+                ShaderLoader.Compile(ShaderType.VertexShader, Const.VERTEX_MESH_FILENAME),
+                ShaderLoader.Compile(ShaderType.FragmentShader, Const.FRAGMENT_DEPTH_FILENAME));
+
+            ShaderLoader.BindMapBlock(h_program);
+            ShaderLoader.BindMapBlock(h_depth);
+            uniforms = new SceneUniforms(h_program);
+            depthUniforms = new SceneUniforms(h_depth);
+
+            // in SdElementType order, one buffer for all of them
+            var meshes = new[] { UnitSphere(), UnitBox(), UnitCylinder() };
+            var vertices = new List<float>();
+            var indices = new List<int>();
+
+            for (int type = 0; type < TYPES; type++)
+            {
+                TriangleMesh mesh = meshes[type];
+                int baseVertex = vertices.Count / VERTEX_FLOATS;
+
+                for (int i = 0; i < mesh.Positions.Length; i++)
+                {
+                    vertices.Add(mesh.Positions[i].X);
+                    vertices.Add(mesh.Positions[i].Y);
+                    vertices.Add(mesh.Positions[i].Z);
+                    vertices.Add(mesh.Normals[i].X);
+                    vertices.Add(mesh.Normals[i].Y);
+                    vertices.Add(mesh.Normals[i].Z);
+                }
+
+                firstIndex[type] = indices.Count;
+                indexCount[type] = mesh.Indices.Length;
+                foreach (int index in mesh.Indices)
+                    indices.Add(baseVertex + index);
+            }
+
+            vao = GL.GenVertexArray();
+            GL.BindVertexArray(vao);
+
+            vbo_vertices = GL.GenBuffer();
+            GL.BindBuffer(BufferTarget.ArrayBuffer, vbo_vertices);
+            GL.BufferData(BufferTarget.ArrayBuffer, vertices.Count * sizeof(float), vertices.ToArray(), BufferUsageHint.StaticDraw);
+            GL.EnableVertexAttribArray(0);
+            GL.VertexAttribPointer(0, 3, VertexAttribPointerType.Float, false, VERTEX_SIZE, 0);
+            GL.EnableVertexAttribArray(1);
+            GL.VertexAttribPointer(1, 3, VertexAttribPointerType.Float, false, VERTEX_SIZE, 3 * sizeof(float));
+
+            ibo_indices = GL.GenBuffer();
+            GL.BindBuffer(BufferTarget.ElementArrayBuffer, ibo_indices);
+            GL.BufferData(BufferTarget.ElementArrayBuffer, indices.Count * sizeof(int), indices.ToArray(), BufferUsageHint.StaticDraw);
+
+            vbo_instances = GL.GenBuffer();
+            GL.BindBuffer(BufferTarget.ArrayBuffer, vbo_instances);
+            GL.BufferData(BufferTarget.ArrayBuffer, instances.Length * sizeof(int), IntPtr.Zero, BufferUsageHint.DynamicDraw);
+            GL.EnableVertexAttribArray(2);
+            GL.VertexAttribIPointer(2, 1, VertexAttribIntegerType.Int, sizeof(int), IntPtr.Zero);
+            GL.VertexAttribDivisor(2, 1);
+
+            GL.BindVertexArray(0);
+            GL.BindBuffer(BufferTarget.ArrayBuffer, 0);
+            GL.BindBuffer(BufferTarget.ElementArrayBuffer, 0);
+
+            timer.Start();
+        }
+
+        /// <summary>
+        /// Groups the elements of a newly uploaded SdElements block by type
+        /// </summary>
+        internal void OnElements(SdElement[] elements)
+        {
+            if (!IsStarted)
+                return;
+
+            int next = 0;
+
+            for (int type = 0; type < TYPES; type++)
+            {
+                firstInstance[type] = next;
+                for (int i = 0; i < elements.Length; i++)
+                    if ((int)elements[i].Type == type)
+                        instances[next++] = i;
+
+                instanceCount[type] = next - firstInstance[type];
+            }
+
+            GL.BindBuffer(BufferTarget.ArrayBuffer, vbo_instances);
+            GL.BufferSubData(BufferTarget.ArrayBuffer, IntPtr.Zero, next * sizeof(int), instances);
+            GL.BindBuffer(BufferTarget.ArrayBuffer, 0);
+        }
+
+        /// <summary>
+        /// Depth of the meshes first, then the lighting of the fragments left in front, so every
+        /// pixel is blended into the cache once. Runs inside FrameCache.BeginSample, before the march.
+        /// </summary>
+        internal void Draw(FrameState frame)
+        {
+            timer.Begin();
+
+            GL.BindVertexArray(vao);
+            GL.Enable(EnableCap.CullFace);
+
+            GL.UseProgram(h_depth);
+            depthUniforms.Set(frame);
+            GL.ColorMask(false, false, false, false);
+            GL.DepthFunc(DepthFunction.Less);
+            DrawInstances();
+
+            GL.UseProgram(h_program);
+            uniforms.Set(frame);
+            GL.ColorMask(true, true, true, true);
+            GL.DepthFunc(DepthFunction.Lequal);
+            DrawInstances();
+
+            GL.Disable(EnableCap.CullFace);
+            GL.BindVertexArray(0);
+            GL.UseProgram(0);
+
+            timer.End();
+        }
+
+        void DrawInstances()
+        {
+            GL.BindBuffer(BufferTarget.ArrayBuffer, vbo_instances);
+
+            for (int type = 0; type < TYPES; type++)
+            {
+                if (instanceCount[type] == 0)
+                    continue;
+
+                GL.VertexAttribIPointer(2, 1, VertexAttribIntegerType.Int, sizeof(int), (IntPtr)(firstInstance[type] * sizeof(int)));
+                GL.DrawElementsInstanced(PrimitiveType.Triangles, indexCount[type], DrawElementsType.UnsignedInt,
+                    (IntPtr)(firstIndex[type] * sizeof(int)), instanceCount[type]);
+            }
+
+            GL.BindBuffer(BufferTarget.ArrayBuffer, 0);
+        }
+
+        /// <summary>
+        /// GPU time of both passes since the last call
+        /// </summary>
+        internal string TakeTimes()
+        {
+            return $" {timer.Name} {timer.TakeMilliseconds().ToString("0.0")}ms";
+        }
+
+        // Unit meshes, scaled by the element size in vertex_mesh.c ----------------------------------------------------------------------
+
+        /// <summary>
+        /// Radius 1, rings from the top pole down
+        /// </summary>
+        static TriangleMesh UnitSphere()
+        {
+            var positions = new List<Vector3>();
+            var indices = new List<int>();
+
+            for (int r = 0; r <= RINGS; r++)
+                for (int s = 0; s <= SEGMENTS; s++)
+                {
+                    double theta = Math.PI * r / RINGS,
+                        phi = 2.0 * Math.PI * s / SEGMENTS;
+
+                    positions.Add(new Vector3(
+                        (float)(Math.Sin(theta) * Math.Cos(phi)),
+                        (float)Math.Cos(theta),
+                        (float)(Math.Sin(theta) * Math.Sin(phi))));
+                }
+
+            for (int r = 0; r < RINGS; r++)
+                for (int s = 0; s < SEGMENTS; s++)
+                {
+                    int a = r * (SEGMENTS + 1) + s,
+                        b = a + SEGMENTS + 1;
+
+                    indices.AddRange(new[] { a, a + 1, b, a + 1, b + 1, b });
+                }
+
+            Vector3[] vertices = positions.ToArray();
+            return new TriangleMesh(vertices, vertices, indices.ToArray());
+        }
+
+        /// <summary>
+        /// Half size 1, four vertices per face for flat normals
+        /// </summary>
+        static TriangleMesh UnitBox()
+        {
+            var axes = new[] { Vector3.UnitX, Vector3.UnitY, Vector3.UnitZ };
+            var positions = new List<Vector3>();
+            var normals = new List<Vector3>();
+            var indices = new List<int>();
+
+            for (int face = 0; face < 6; face++)
+            {
+                int axis = face >> 1;
+                float sign = (face & 1) == 0 ? 1f : -1f;
+
+                // u x v faces out
+                Vector3 n = axes[axis] * sign,
+                    u = axes[(axis + 1) % 3],
+                    v = axes[(axis + 2) % 3];
+                if (sign < 0f)
+                {
+                    Vector3 swap = u;
+                    u = v;
+                    v = swap;
+                }
+
+                int first = positions.Count;
+                positions.AddRange(new[] { n - u - v, n + u - v, n + u + v, n - u + v });
+                normals.AddRange(new[] { n, n, n, n });
+                indices.AddRange(new[] { first, first + 1, first + 2, first, first + 2, first + 3 });
+            }
+
+            return new TriangleMesh(positions.ToArray(), normals.ToArray(), indices.ToArray());
+        }
+
+        /// <summary>
+        /// Radius 1, half height 1 along y, capped
+        /// </summary>
+        static TriangleMesh UnitCylinder()
+        {
+            var positions = new List<Vector3>();
+            var normals = new List<Vector3>();
+            var indices = new List<int>();
+
+            // side, a bottom and a top vertex per segment
+            for (int s = 0; s <= SEGMENTS; s++)
+            {
+                double phi = 2.0 * Math.PI * s / SEGMENTS;
+                var n = new Vector3((float)Math.Cos(phi), 0f, (float)Math.Sin(phi));
+
+                positions.Add(n - Vector3.UnitY);
+                positions.Add(n + Vector3.UnitY);
+                normals.Add(n);
+                normals.Add(n);
+            }
+
+            for (int s = 0; s < SEGMENTS; s++)
+            {
+                int a = 2 * s;
+                indices.AddRange(new[] { a, a + 1, a + 3, a, a + 3, a + 2 });
+            }
+
+            foreach (float y in new[] { -1f, 1f })
+            {
+                var n = new Vector3(0f, y, 0f);
+                int center = positions.Count;
+                positions.Add(n);
+                normals.Add(n);
+
+                for (int s = 0; s <= SEGMENTS; s++)
+                {
+                    double phi = 2.0 * Math.PI * s / SEGMENTS;
+                    positions.Add(new Vector3((float)Math.Cos(phi), y, (float)Math.Sin(phi)));
+                    normals.Add(n);
+                }
+
+                for (int s = 0; s < SEGMENTS; s++)
+                {
+                    if (y > 0f)
+                        indices.AddRange(new[] { center, center + s + 2, center + s + 1 });
+                    else
+                        indices.AddRange(new[] { center, center + s + 1, center + s + 2 });
+                }
+            }
+
+            return new TriangleMesh(positions.ToArray(), normals.ToArray(), indices.ToArray());
+        }
+
+        internal void Stop()
+        {
+            if (!IsStarted)
+                return;
+
+            timer.Stop();
+            GL.DeleteBuffers(1, ref vbo_vertices);
+            GL.DeleteBuffers(1, ref ibo_indices);
+            GL.DeleteBuffers(1, ref vbo_instances);
+            GL.DeleteVertexArray(vao);
+            GL.DeleteProgram(h_program);
+            GL.DeleteProgram(h_depth);
+            h_program = 0;
+        }
+    }
+}
@@ -0,0 +1,149 @@
+﻿using OpenTK;
+using OpenTK.Graphics.OpenGL4;
+using System;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// GPU particles (compute_particles.c) colliding with the map() of the marchers.
+    /// The state ping-pongs between two storage buffers, the draw pass reads the
+    /// newest one as points and hides them behind the marched distance of FrameCache.
+    /// </summary>
+    public class ParticleSystem
+    {
+        const int PARTICLE_SIZE = 32;   // two vec4, std430
+        const int PARTICLES_IN_BINDING = 6;
+        const int PARTICLES_OUT_BINDING = 7;
+        const int GROUP_SIZE = 256;     // local_size_x of compute_particles.c
+
+        int h_step,
+            h_draw;
+
+        int uf_ParticleCount,
+            uf_Delta,
+            uf_Emitter,
+            uf_Frame,
+            uf_ResetClearance,
+            uf_SceneDistance;
+
+        SceneUniforms stepUniforms,
+            drawUniforms;
+
+        int[] ssbo_particles = new int[2];
+        int current;    // buffer holding the newest state
+        uint steps;
+
+        // the cached clearances hold for this scene and sculpt only
+        int sceneVersion = -1,
+            sculptVersion = -1;
+
+        public int Count { get; private set; }
+
+        public bool IsStarted => h_step != 0;
+
+        public void Start(int count)
+        {
+            h_step = ShaderLoader.Link(
+                ShaderLoader.Compile(ShaderType.ComputeShader, Const.COMPUTE_PARTICLES_FILENAME));
+
+            h_draw = ShaderLoader.Link(
+                ShaderLoader.Compile(ShaderType.VertexShader, Const.VERTEX_PARTICLES_FILENAME),
+                ShaderLoader.Compile(ShaderType.FragmentShader, Const.FRAGMENT_PARTICLES_FILENAME));
+
+            ShaderLoader.BindMapBlock(h_step);
+            ShaderLoader.BindMapBlock(h_draw);
+
+            stepUniforms = new SceneUniforms(h_step);
+            drawUniforms = new SceneUniforms(h_draw);
+
+            uf_ParticleCount = GL.GetUniformLocation(h_step, "uParticleCount");
+            uf_Delta = GL.GetUniformLocation(h_step, "uDelta");
+            uf_Emitter = GL.GetUniformLocation(h_step, "uEmitter");
+            uf_Frame = GL.GetUniformLocation(h_step, "uFrame");
+            uf_ResetClearance = GL.GetUniformLocation(h_step, "uResetClearance");
+            uf_SceneDistance = GL.GetUniformLocation(h_draw, "sceneDistance");
+
+            GL.GenBuffers(2, ssbo_particles);
+            Resize(count);
+        }
+
+        /// <summary>
+        /// Reallocates the state for count particles, the rain starts over
+        /// </summary>
+        internal void Resize(int count)
+        {
+            // zeroed state has no life left, every particle spawns on the first step
+            var zero = new byte[count * PARTICLE_SIZE];
+
+            foreach (int ssbo in ssbo_particles)
+            {
+                GL.BindBuffer(BufferTarget.ShaderStorageBuffer, ssbo);
+                GL.BufferData(BufferTarget.ShaderStorageBuffer, zero.Length, zero, BufferUsageHint.DynamicCopy);
+            }
+            GL.BindBuffer(BufferTarget.ShaderStorageBuffer, 0);
+
+            Count = count;
+        }
+
+        /// <summary>
+        /// Steps the particles by delta, the rain follows the camera
+        /// </summary>
+        internal void Step(FrameState frame, float delta)
+        {
+            GL.UseProgram(h_step);
+            stepUniforms.Set(frame);
+            GL.Uniform1(uf_ParticleCount, Count);
+            GL.Uniform1(uf_Delta, Math.Min(delta, Const.PARTICLES_MAX_DELTA));
+            GL.Uniform4(uf_Emitter, new Vector4(frame.Origin, Const.PARTICLES_EMITTER_RADIUS));
+            GL.Uniform1(uf_Frame, steps++);
+
+            bool changed = frame.SceneVersion != sceneVersion || frame.SculptVersion != sculptVersion;
+            sceneVersion = frame.SceneVersion;
+            sculptVersion = frame.SculptVersion;
+            GL.Uniform1(uf_ResetClearance, changed ? 1 : 0);
+
+            GL.BindBufferBase(BufferRangeTarget.ShaderStorageBuffer, PARTICLES_IN_BINDING, ssbo_particles[current]);
+            GL.BindBufferBase(BufferRangeTarget.ShaderStorageBuffer, PARTICLES_OUT_BINDING, ssbo_particles[1 - current]);
+
+            GL.DispatchCompute((Count + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+            GL.MemoryBarrier(MemoryBarrierFlags.ShaderStorageBarrierBit);
+
+            current = 1 - current;
+            GL.UseProgram(0);
+        }
+
+        /// <summary>
+        /// Draws the newest state over the bound framebuffer
+        /// </summary>
+        /// <param name="sceneDistance">Ray distance of the frame, FrameCache.DistanceTexture</param>
+        internal void Draw(FrameState frame, int sceneDistance)
+        {
+            GL.UseProgram(h_draw);
+            drawUniforms.Set(frame);
+
+            GL.ActiveTexture(TextureUnit.Texture0);
+            GL.BindTexture(TextureTarget.Texture2D, sceneDistance);
+            GL.Uniform1(uf_SceneDistance, 0);
+
+            GL.BindBufferBase(BufferRangeTarget.ShaderStorageBuffer, PARTICLES_IN_BINDING, ssbo_particles[current]);
+
+            GL.Enable(EnableCap.ProgramPointSize);
+            GL.DrawArrays(PrimitiveType.Points, 0, Count);
+            GL.Disable(EnableCap.ProgramPointSize);
+
+            GL.BindTexture(TextureTarget.Texture2D, 0);
+            GL.UseProgram(0);
+        }
+
+        internal void Stop()
+        {
+            if (!IsStarted)
+                return;
+
+            GL.DeleteBuffers(2, ssbo_particles);
+            GL.DeleteProgram(h_step);
+            GL.DeleteProgram(h_draw);
+            h_step = 0;
+        }
+    }
+}
@@ -1,5 +1,8 @@
 ﻿using OpenTK;
 using System;
+using System.Threading;
+using Lanes = System.Numerics.Vector<float>;
+using SimdVector = System.Numerics.Vector;
 
 namespace GldeTK
 {
@@ -7,14 +10,61 @@ namespace GldeTK
     {
         public float GlobalTime = 0;
 
+        SdScene scene;
+        Sculpt sculpt;
+
+        /// <summary>
+        /// GPU answers to the ray and normal queries, Map is the fallback while none is ready
+        /// </summary>
+        public readonly PhysicsQueries Queries = new PhysicsQueries();
+
+        // memo of the tick running on this thread, other threads evaluate Map directly
+        [ThreadStatic]
+        static PhysicsTick activeTick;
+
+        // one memo per ticking thread, overlapping timer ticks do not share one
+        readonly ThreadLocal<PhysicsTick> ticks;
+
+        /// <param name="sculpt">Edits of the ground plane, the plain plane when null</param>
+        public Physics(SdScene scene, Sculpt sculpt = null)
+        {
+            this.scene = scene;
+            this.sculpt = sculpt;
+            ticks = new ThreadLocal<PhysicsTick>(() => new PhysicsTick(this));
+        }
+
+        /// <summary>
+        /// Queries of the calling thread share its memo until EndTick
+        /// </summary>
+        public void BeginTick()
+        {
+            PhysicsTick tick = ticks.Value;
+            tick.Begin();
+            activeTick = tick;
+        }
+
+        public void EndTick()
+        {
+            PhysicsTick tick = ActiveTick;
+            if (tick == null)
+                return;
+
+            activeTick = null;
+
+            Profiler.Count(Const.PROFILER_TICKS);
+            Profiler.Count(Const.PROFILER_MAP_SAVED, tick.Saved);
+        }
+
+        PhysicsTick ActiveTick => activeTick != null && activeTick.Owner == this ? activeTick : null;
+
         // Utils ----------------------------------------------------------------------
-        Vector3 AbsV3(Vector3 v)
+        internal static Vector3 AbsV3(Vector3 v)
         {
             return
                 new Vector3(Math.Abs(v.X), Math.Abs(v.Y), Math.Abs(v.Z));
         }
 
-        Vector3 MaxV3(Vector3 v1, Vector3 v2)
+        internal static Vector3 MaxV3(Vector3 v1, Vector3 v2)
         {
             return
                 new Vector3(
@@ -23,7 +73,7 @@ namespace GldeTK
                     Math.Max(v1.Z, v2.Z) );
         }
 
-        Vector3 MaxV3(Vector3 v1, float s)
+        internal static Vector3 MaxV3(Vector3 v1, float s)
         {
             return
                 new Vector3(
@@ -32,7 +82,7 @@ namespace GldeTK
                     Math.Max(v1.Z, s));
         }
 
-        Vector3 Mod3(Vector3 v1, Vector3 v2)
+        internal static Vector3 Mod3(Vector3 v1, Vector3 v2)
         {
             return
                 new Vector3(
@@ -43,46 +93,46 @@ namespace GldeTK
 
         // Signed Distance Functions ----------------------------------------------------------------------
 
-        float SdPlaneY(Vector3 p)
+        internal static float SdPlaneY(Vector3 p)
         {
             return p.Y;
         }
 
-        float SdSphere(Vector3 p, float s)
+        internal static float SdSphere(Vector3 p, float s)
         {
-            return p.LengthFast - s;
+            return p.Length - s;
         }
 
-        float SdCylinderInf(Vector3 p, float r)
+        internal static float SdCylinderInf(Vector3 p, float r)
         {
             p.Y = 0f;
-            return p.LengthFast - r;
+            return p.Length - r;
         }
 
-        float SdCylinder(Vector3 p, float r, float h)
+        internal static float SdCylinder(Vector3 p, float r, float h)
         {
             return 
                 Math.Max(
-                p.Xz.LengthFast - r,
+                p.Xz.Length - r,
                 Math.Abs(p.Y) - h);
         }
 
-        float SdBox(Vector3 p, Vector3 b)
+        internal static float SdBox(Vector3 p, Vector3 b)
         {
             Vector3 d = AbsV3(p) - b;
             return
                 Math.Min( Math.Max( d.X, Math.Max(d.Y, d.Z)), 0.0f) +
-                MaxV3(d, 0.0f).LengthFast;
+                MaxV3(d, 0.0f).Length;
         }
 
         // Domain operations ----------------------------------------------------------------------
 
-        float OpA(float d1, float d2)
+        internal static float OpA(float d1, float d2)
         {
             return Math.Min(d2, d1);
         }
 
-        Vector3 OpRep(Vector3 p, Vector3 c)
+        internal static Vector3 OpRep(Vector3 p, Vector3 c)
         {
             return
                 Mod3(p, c) - 0.5f * c;
@@ -92,9 +142,26 @@ namespace GldeTK
 
         // Map projection and raycaster systems ----------------------------------------------------------------------
 
-        float Map(Vector3 pos)
+        internal float Map(Vector3 pos)
+        {
+            PhysicsTick memo = ActiveTick;
+            if (memo == null)
+                return MapScene(pos);
+
+            if (memo.TryGetMap(pos, out float d))
+                return d;
+
+            d = MapScene(pos);
+            memo.StoreMap(pos, d);
+            return d;
+        }
+
+        /// <summary>
+        /// CPU port of map() in scene.c without the rigid bodies, keep in sync
+        /// </summary>
+        internal float MapScene(Vector3 pos)
         {
-            float d = SdPlaneY(pos);
+            float d = sculpt?.Distance(pos) ?? SdPlaneY(pos);
 
             //d = OpA(
             //        d,
@@ -102,17 +169,17 @@ namespace GldeTK
             //            new Vector3(pos.X, pos.Y - 1.0f, pos.Z),
             //            new Vector3(1.0f)));
 
-            Vector3 posRepeat = OpRep(pos, new Vector3(10f, 10f + (float)Math.Sin(GlobalTime), 10f));
+            Vector3 posRepeat = OpRep(pos, new Vector3(10f));
 
             d = OpA(
                     d,
-                    SdSphere(posRepeat, 1.0f));
+                    SdSphere(posRepeat, scene.Parameters.X));
 
             posRepeat = OpRep(pos, new Vector3(7f, 0f, 9f));
 
             d = OpA(
                     d,
-                    SdBox(posRepeat, new Vector3(1.0f, 2.0f, 1.0f)));
+                    SdBox(posRepeat, new Vector3(scene.Parameters.Y, scene.Parameters.Z, scene.Parameters.W)));
 
             posRepeat = OpRep(pos, new Vector3(12f, 0f, 13f));
 
@@ -120,6 +187,110 @@ namespace GldeTK
                     d,
                     SdCylinder(posRepeat, 1.0f, 30.0f));
 
+            d = OpA(
+                    d,
+                    scene.Distance(pos));
+
+            return d;
+        }
+
+        /// <summary>
+        /// MapScene of the points start to end - 1 into d, Lanes.Count points at a time,
+        /// the leftover points and the sculpted ground one by one
+        /// </summary>
+        internal void MapScene(float[] x, float[] y, float[] z, float[] d, int start, int end)
+        {
+            int width = Lanes.Count;
+            int i = start;
+
+            for (; i + width <= end; i += width)
+            {
+                var px = new Lanes(x, i);
+                var py = new Lanes(y, i);
+                var pz = new Lanes(z, i);
+
+                Lanes dist = MapLanes(px, py, pz);
+
+                if (sculpt == null)
+                    SimdVector.Min(dist, py).CopyTo(d, i);
+                else
+                {
+                    dist.CopyTo(d, i);
+                    for (int k = i; k < i + width; k++)
+                        d[k] = Math.Min(d[k], sculpt.Distance(new Vector3(x[k], y[k], z[k])));
+                }
+            }
+
+            for (; i < end; i++)
+                d[i] = MapScene(new Vector3(x[i], y[i], z[i]));
+        }
+
+        /// <summary>
+        /// Mod3 and OpRep of a single axis, |v % c| - c / 2, v itself for c = 0
+        /// </summary>
+        static Lanes RepLanes(Lanes v, float c)
+        {
+            if (c == 0f)
+                return SimdVector.Abs(v);
+
+            Lanes turns = SimdVector.ConvertToSingle(SimdVector.ConvertToInt32(v / new Lanes(c)));
+            return SimdVector.Abs(v - turns * c) - new Lanes(0.5f * c);
+        }
+
+        static Lanes LengthLanes(Lanes x, Lanes y, Lanes z) => SimdVector.SquareRoot(x * x + y * y + z * z);
+
+        static Lanes BoxLanes(Lanes qx, Lanes qy, Lanes qz, Vector3 b)
+        {
+            Lanes dx = SimdVector.Abs(qx) - new Lanes(b.X),
+                dy = SimdVector.Abs(qy) - new Lanes(b.Y),
+                dz = SimdVector.Abs(qz) - new Lanes(b.Z);
+
+            return
+                SimdVector.Min(SimdVector.Max(dx, SimdVector.Max(dy, dz)), Lanes.Zero) +
+                LengthLanes(SimdVector.Max(dx, Lanes.Zero), SimdVector.Max(dy, Lanes.Zero), SimdVector.Max(dz, Lanes.Zero));
+        }
+
+        static Lanes CylinderLanes(Lanes qx, Lanes qy, Lanes qz, float r, float h)
+        {
+            return SimdVector.Max(
+                SimdVector.SquareRoot(qx * qx + qz * qz) - new Lanes(r),
+                SimdVector.Abs(qy) - new Lanes(h));
+        }
+
+        /// <summary>
+        /// MapScene without the ground, one point per lane
+        /// </summary>
+        Lanes MapLanes(Lanes px, Lanes py, Lanes pz)
+        {
+            Vector4 parameters = scene.Parameters;
+
+            Lanes d = LengthLanes(RepLanes(px, 10f), RepLanes(py, 10f), RepLanes(pz, 10f)) - new Lanes(parameters.X);
+
+            d = SimdVector.Min(d, BoxLanes(RepLanes(px, 7f), RepLanes(py, 0f), RepLanes(pz, 9f), new Vector3(parameters.Y, parameters.Z, parameters.W)));
+
+            d = SimdVector.Min(d, CylinderLanes(RepLanes(px, 12f), RepLanes(py, 0f), RepLanes(pz, 13f), 1.0f, 30.0f));
+
+            foreach (SdElement element in scene.Elements)
+            {
+                Vector3 c = element.Position;
+                Lanes qx = px - new Lanes(c.X),
+                    qy = py - new Lanes(c.Y),
+                    qz = pz - new Lanes(c.Z);
+
+                switch (element.Type)
+                {
+                    case SdElementType.Sphere:
+                        d = SimdVector.Min(d, LengthLanes(qx, qy, qz) - new Lanes(element.SizeBound.X));
+                        break;
+                    case SdElementType.Box:
+                        d = SimdVector.Min(d, BoxLanes(qx, qy, qz, element.Size));
+                        break;
+                    default:
+                        d = SimdVector.Min(d, CylinderLanes(qx, qy, qz, element.SizeBound.X, element.SizeBound.Y));
+                        break;
+                }
+            }
+
             return d;
         }
 
@@ -149,45 +320,180 @@ namespace GldeTK
         /// <returns></returns>
         public float CastRay(Vector3 ro, Vector3 rd)
         {
-            //TODO move to external constants w/ uniq names
-            const int MAX_RAY_STEPS = 16;
-            const float MIN_DIST = 0.1f;
-            float MAX_DIST = 100;
+            PhysicsTick memo = ActiveTick;
+            if (memo != null && memo.TryGetRay(ro, rd, out float cached))
+                return cached;
 
-            float t = 0.0f;
+            // space already proven empty by this tick is not marched again
+            float t = memo != null ? memo.StartDistance(ro, rd) : 0.0f;
             float h = 1.0f;
+            int i;
 
-            for (int i = 0; i < MAX_RAY_STEPS; i++)
+            for (i = 0; i < Const.PHYS_RAY_MAX_STEPS; i++)
             {
 
                 h = Map(ro + rd * t);
                 t += h;
 
-                if (h < MIN_DIST || t > MAX_DIST)
+                if (h < Const.PHYS_RAY_MIN_DIST || t > Const.PHYS_RAY_MAX_DIST)
                     break;
             }
 
+            memo?.StoreRay(ro, rd, t, i);
             return t;
         }
 
+        // GPU queries ----------------------------------------------------------------------
+
+        /// <summary>
+        /// CastRay answered by the shader scene. The result comes a frame late, so it is
+        /// used only while the new ray strays from the answered one by less than
+        /// Const.QUERY_REUSE_MARGIN up to the hit, and is shortened by the offset along the ray.
+        /// </summary>
+        /// <param name="slot">Const.QUERY_SLOT_*, one ray kept up to date per slot</param>
+        public float QueryRay(int slot, Vector3 ro, Vector3 rd)
+        {
+            Queries.Submit(slot, PhysicsQuery.Ray(ro, rd));
+
+            if (Queries.TryGetResult(slot, out PhysicsQuery query, out Vector4 result)
+                && query.Type == PhysicsQuery.RAY)
+            {
+                Vector3 dir = query.Direction.Xyz;
+                Vector3 offset = ro - query.Origin.Xyz;
+                float along = Vector3.Dot(offset, dir);
+                float cos = Vector3.Dot(rd, dir);
+                float sin = (float)Math.Sqrt(Math.Max(1f - cos * cos, 0f));
+
+                // widest gap between the two rays up to the hit
+                float stray = (offset - dir * along).Length + result.X * sin;
+
+                if (cos > 0f && offset.Length <= Const.QUERY_REUSE_DISTANCE && stray <= Const.QUERY_REUSE_MARGIN)
+                {
+                    Profiler.Count(Const.PROFILER_QUERIES_GPU);
+                    return Math.Max(result.X - along, 0f);
+                }
+            }
+
+            Profiler.Count(Const.PROFILER_QUERIES_CPU);
+            return CastRay(ro, rd);
+        }
+
+        /// <summary>
+        /// GetSurfaceNormal answered by the shader scene, see QueryRay
+        /// </summary>
+        public Vector3 QueryNormal(int slot, Vector3 pos)
+        {
+            Queries.Submit(slot, PhysicsQuery.Point(pos));
+
+            if (Queries.TryGetResult(slot, out PhysicsQuery query, out Vector4 result)
+                && query.Type == PhysicsQuery.POINT
+                && (pos - query.Origin.Xyz).Length <= Const.QUERY_REUSE_DISTANCE)
+            {
+                Profiler.Count(Const.PROFILER_QUERIES_GPU);
+                return new Vector3(result.Y, result.Z, result.W);
+            }
+
+            Profiler.Count(Const.PROFILER_QUERIES_CPU);
+            return GetSurfaceNormal(pos);
+        }
+
+        // Continuous collision ----------------------------------------------------------------------
+
+        /// <summary>
+        /// Conservative advancement of a sphere along motion: every step moves by the distance
+        /// the Map bound proves empty, so thin geometry can not be skipped at any speed. A contact
+        /// the motion leaves or slides along is not a hit, the sweep goes on in contact steps.
+        /// </summary>
+        /// <param name="lipschitz">Slope bound of Map, 1 for true distances</param>
+        public SweepHit SweepSphere(Vector3 center, float radius, Vector3 motion, float lipschitz = 1f)
+        {
+            return Sweep(center, center, radius, motion, lipschitz);
+        }
+
+        /// <summary>
+        /// Conservative advancement of a capsule (segment a-b grown by radius), translation only
+        /// </summary>
+        public SweepHit SweepCapsule(Vector3 a, Vector3 b, float radius, Vector3 motion, float lipschitz = 1f)
+        {
+            return Sweep(a, b, radius, motion, lipschitz);
+        }
+
+        SweepHit Sweep(Vector3 a, Vector3 b, float radius, Vector3 motion, float lipschitz)
+        {
+            var hit = new SweepHit();
+            float length = motion.Length;
+
+            // the segment is sampled no sparser than the radius,
+            // between two samples Map may drop by lipschitz * spacing / 2;
+            // a zero radius gives no spacing, only the endpoints are tested then
+            float span = (b - a).Length;
+            radius = Math.Max(radius, 0f);
+            int samples = radius > 0f ? (int)Math.Ceiling(span / radius) + 1 : (span > 0f ? 2 : 1);
+            float margin = radius > 0f ? lipschitz * 0.5f * span / Math.Max(samples - 1, 1) : 0f;
+
+            while (hit.Steps < Const.PHYS_SWEEP_MAX_STEPS)
+            {
+                Vector3 offset = motion * hit.Time;
+                Vector3 closest = a + offset;
+                float d = float.MaxValue;
+
+                for (int i = 0; i < samples; i++)
+                {
+                    Vector3 p = Vector3.Lerp(a, b, samples > 1 ? (float)i / (samples - 1) : 0f) + offset;
+                    float dp = Map(p);
+
+                    if (dp < d)
+                    {
+                        d = dp;
+                        closest = p;
+                    }
+                }
+
+                hit.Steps++;
+
+                d -= radius + margin;
+                float advance = d - Const.PHYS_SWEEP_CONTACT_DIST * 0.5f;
+
+                if (d <= Const.PHYS_SWEEP_CONTACT_DIST)
+                {
+                    Vector3 normal = GetSurfaceNormal(closest);
+                    if (length == 0f || Vector3.Dot(normal, motion) < 0f)
+                    {
+                        hit.Hit = true;
+                        hit.Normal = normal;
+                        break;
+                    }
+
+                    // leaving or sliding, a surface turning into the motion is met within a contact step
+                    advance = Const.PHYS_SWEEP_CONTACT_DIST;
+                }
+
+                if (length == 0f || hit.Time >= 1f)
+                    break;
+
+                // the contact distance is kept free, so resting bodies stop at once
+                hit.Time = Math.Min(1f, hit.Time + advance / (lipschitz * length));
+            }
+
+            return hit;
+        }
+
         float motion_fallSpeed = .0f;
-        float phys_freeFallAccel = 9.8f;
+        float phys_freeFallAccel = Const.PHYS_GRAVITY;
         public Vector3 Gravity(float delta, Ray rayOrigin, float player_hitRadius, bool stopFallTrick = false)
         {
             if (stopFallTrick)
                 motion_fallSpeed = 0f;  // stop fall
             else
-                motion_fallSpeed += phys_freeFallAccel * delta; // free fall
+                motion_fallSpeed = Math.Min(motion_fallSpeed + phys_freeFallAccel * delta, Const.PHYS_TERMINAL_FALL_SPEED); // free fall
 
             Vector3 fallVector = new Vector3(-rayOrigin.Up * motion_fallSpeed * delta);
-            float sd = CastRay(rayOrigin.Origin, Vector3.NormalizeFast(fallVector));
-            
-            // when hit bottom surface
-            if (sd <= player_hitRadius)
-            {
+            SweepHit hit = SweepSphere(rayOrigin.Origin, player_hitRadius, fallVector);
+
+            // the sweep stops at the bottom surface however fast the fall is
+            fallVector *= hit.Time;
+            if (hit.Hit)
                 motion_fallSpeed = 0f;
-                fallVector = Vector3.Zero;
-            }
 
             return fallVector;
         }
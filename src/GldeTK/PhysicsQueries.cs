@@ -0,0 +1,216 @@
+﻿using OpenTK;
+using OpenTK.Graphics.OpenGL4;
+using System;
+using System.Diagnostics;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Ray and point queries answered by compute_query.c against the exact shader scene.
+    /// The physics thread keeps one query per slot up to date, the render thread dispatches
+    /// the batch every frame and reads the results back behind a fence a frame later,
+    /// so neither thread ever waits for the other or for the GPU.
+    /// </summary>
+    public class PhysicsQueries
+    {
+        const int QUERY_SIZE = 32;      // two vec4, std430
+        const int RESULT_SIZE = 16;
+        const int QUERIES_BINDING = 8;
+        const int RESULTS_BINDING = 9;
+        const int GROUP_SIZE = 64;      // local_size_x of compute_query.c
+        const int RING = 2;             // batches in flight
+
+        /// <summary>
+        /// Batch on the GPU: the queries it answers, its buffers and the fence after its dispatch
+        /// </summary>
+        class Batch
+        {
+            public PhysicsQuery[] Queries = new PhysicsQuery[Const.QUERY_SLOTS];
+            public bool[] Used = new bool[Const.QUERY_SLOTS];
+            public int Count;
+            public int SsboQueries,
+                SsboResults;
+            public IntPtr Fence;
+        }
+
+        readonly object sync = new object();
+
+        // physics thread side, guarded by sync
+        PhysicsQuery[] pending = new PhysicsQuery[Const.QUERY_SLOTS];
+        bool[] pendingUsed = new bool[Const.QUERY_SLOTS];
+        PhysicsQuery[] answered = new PhysicsQuery[Const.QUERY_SLOTS];
+        Vector4[] results = new Vector4[Const.QUERY_SLOTS];
+        long[] resultTicks = new long[Const.QUERY_SLOTS];
+
+        // render thread side
+        int h_query;
+        int uf_QueryCount;
+        SceneUniforms queryUniforms;
+        Batch[] ring = new Batch[RING];
+        Vector4[] readback = new Vector4[Const.QUERY_SLOTS];
+        int next;
+
+        Stopwatch clock = Stopwatch.StartNew();
+
+        public bool IsStarted => h_query != 0;
+
+        public void Start()
+        {
+            h_query = ShaderLoader.Link(
+                ShaderLoader.Compile(ShaderType.ComputeShader, Const.COMPUTE_QUERY_FILENAME));
+
+            ShaderLoader.BindMapBlock(h_query);
+            queryUniforms = new SceneUniforms(h_query);
+            uf_QueryCount = GL.GetUniformLocation(h_query, "uQueryCount");
+
+            for (int k = 0; k < RING; k++)
+            {
+                var batch = new Batch
+                {
+                    SsboQueries = GL.GenBuffer(),
+                    SsboResults = GL.GenBuffer()
+                };
+
+                GL.BindBuffer(BufferTarget.ShaderStorageBuffer, batch.SsboQueries);
+                GL.BufferData(BufferTarget.ShaderStorageBuffer, Const.QUERY_SLOTS * QUERY_SIZE, IntPtr.Zero, BufferUsageHint.StreamDraw);
+
+                // read by the host, the driver keeps it where the readback is cheap
+                GL.BindBuffer(BufferTarget.ShaderStorageBuffer, batch.SsboResults);
+                GL.BufferData(BufferTarget.ShaderStorageBuffer, Const.QUERY_SLOTS * RESULT_SIZE, IntPtr.Zero, BufferUsageHint.StreamRead);
+
+                ring[k] = batch;
+            }
+            GL.BindBuffer(BufferTarget.ShaderStorageBuffer, 0);
+        }
+
+        // Physics thread ----------------------------------------------------------------------
+
+        /// <summary>
+        /// Replaces the query of the slot, it goes to the GPU with the next frame
+        /// </summary>
+        public void Submit(int slot, PhysicsQuery query)
+        {
+            lock (sync)
+            {
+                pending[slot] = query;
+                pendingUsed[slot] = true;
+            }
+        }
+
+        /// <summary>
+        /// Latest result of the slot and the query it answers,
+        /// false when nothing newer than Const.QUERY_MAX_AGE is ready
+        /// </summary>
+        public bool TryGetResult(int slot, out PhysicsQuery query, out Vector4 result)
+        {
+            lock (sync)
+            {
+                query = answered[slot];
+                result = results[slot];
+
+                return resultTicks[slot] != 0
+                    && clock.ElapsedMilliseconds - resultTicks[slot] <= Const.QUERY_MAX_AGE;
+            }
+        }
+
+        // Render thread ----------------------------------------------------------------------
+
+        /// <summary>
+        /// Collects the finished batches and dispatches the pending queries
+        /// </summary>
+        internal void OnFrame(FrameState frame)
+        {
+            foreach (Batch batch in ring)
+                if (batch.Fence != IntPtr.Zero)
+                    Collect(batch);
+
+            Batch free = ring[next];
+            if (free.Fence != IntPtr.Zero)
+                return; // the GPU is behind, queries wait for the next frame
+
+            int count = 0;
+            lock (sync)
+            {
+                for (int slot = 0; slot < Const.QUERY_SLOTS; slot++)
+                {
+                    free.Used[slot] = pendingUsed[slot];
+                    if (pendingUsed[slot])
+                        count = slot + 1;
+
+                    free.Queries[slot] = pending[slot];
+                    pendingUsed[slot] = false;
+                }
+            }
+
+            if (count == 0)
+                return;
+
+            free.Count = count;
+
+            GL.UseProgram(h_query);
+            queryUniforms.Set(frame);
+            GL.Uniform1(uf_QueryCount, count);
+
+            GL.BindBuffer(BufferTarget.ShaderStorageBuffer, free.SsboQueries);
+            GL.BufferSubData(BufferTarget.ShaderStorageBuffer, IntPtr.Zero, count * QUERY_SIZE, free.Queries);
+            GL.BindBuffer(BufferTarget.ShaderStorageBuffer, 0);
+
+            GL.BindBufferBase(BufferRangeTarget.ShaderStorageBuffer, QUERIES_BINDING, free.SsboQueries);
+            GL.BindBufferBase(BufferRangeTarget.ShaderStorageBuffer, RESULTS_BINDING, free.SsboResults);
+            GL.DispatchCompute((count + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+            GL.MemoryBarrier(MemoryBarrierFlags.BufferUpdateBarrierBit);
+
+            free.Fence = GL.FenceSync(SyncCondition.SyncGpuCommandsComplete, WaitSyncFlags.None);
+            GL.UseProgram(0);
+
+            next = (next + 1) % RING;
+        }
+
+        /// <summary>
+        /// Reads the results of a batch if its fence has passed, never blocks
+        /// </summary>
+        void Collect(Batch batch)
+        {
+            WaitSyncStatus status = GL.ClientWaitSync(batch.Fence, ClientWaitSyncFlags.SyncFlushCommandsBit, 0);
+            if (status != WaitSyncStatus.AlreadySignaled && status != WaitSyncStatus.ConditionSatisfied)
+                return;
+
+            GL.DeleteSync(batch.Fence);
+            batch.Fence = IntPtr.Zero;
+
+            GL.BindBuffer(BufferTarget.ShaderStorageBuffer, batch.SsboResults);
+            GL.GetBufferSubData(BufferTarget.ShaderStorageBuffer, IntPtr.Zero, batch.Count * RESULT_SIZE, readback);
+            GL.BindBuffer(BufferTarget.ShaderStorageBuffer, 0);
+
+            long now = clock.ElapsedMilliseconds;
+            lock (sync)
+            {
+                for (int slot = 0; slot < batch.Count; slot++)
+                    if (batch.Used[slot])
+                    {
+                        answered[slot] = batch.Queries[slot];
+                        results[slot] = readback[slot];
+                        resultTicks[slot] = Math.Max(now, 1);
+                    }
+            }
+        }
+
+        internal void Stop()
+        {
+            if (!IsStarted)
+                return;
+
+            foreach (Batch batch in ring)
+            {
+                if (batch.Fence != IntPtr.Zero)
+                    GL.DeleteSync(batch.Fence);
+
+                GL.DeleteBuffers(1, ref batch.SsboQueries);
+                GL.DeleteBuffers(1, ref batch.SsboResults);
+            }
+
+            GL.DeleteProgram(h_query);
+            h_query = 0;
+        }
+    }
+}
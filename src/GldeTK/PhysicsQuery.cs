@@ -0,0 +1,43 @@
+﻿using OpenTK;
+using System.Runtime.InteropServices;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// One query of compute_query.c, std430 layout of its Query struct
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct PhysicsQuery
+    {
+        public const int RAY = 0;
+        public const int POINT = 1;
+
+        /// <summary>
+        /// Ray origin or point, w - type
+        /// </summary>
+        public Vector4 Origin;
+
+        /// <summary>
+        /// Ray direction, unused for a point
+        /// </summary>
+        public Vector4 Direction;
+
+        public int Type => (int)Origin.W;
+
+        /// <summary>
+        /// Result x - distance along the ray, yzw - normal at the hit
+        /// </summary>
+        public static PhysicsQuery Ray(Vector3 ro, Vector3 rd)
+        {
+            return new PhysicsQuery { Origin = new Vector4(ro, RAY), Direction = new Vector4(rd, 0f) };
+        }
+
+        /// <summary>
+        /// Result x - distance to the surface, yzw - normal
+        /// </summary>
+        public static PhysicsQuery Point(Vector3 pos)
+        {
+            return new PhysicsQuery { Origin = new Vector4(pos, POINT) };
+        }
+    }
+}
@@ -0,0 +1,160 @@
+﻿using OpenTK;
+using System;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Memo of one physics tick: Map values of exactly equal positions, results of identical
+    /// rays, and the empty balls the Map values prove, which let a ray skip the part of its
+    /// march another query of the tick has already covered. Everything expires with the tick.
+    /// Used by one thread at a time, Physics keeps one per ticking thread.
+    /// </summary>
+    public class PhysicsTick
+    {
+        const int MAP_SLOTS = 256;              // power of two
+        const int MAP_MAX_STORED = MAP_SLOTS / 2;   // keeps the probe chains short
+        const int MAX_RAYS = 16;
+        const int MAX_HOPS = 8;
+
+        internal readonly Physics Owner;
+
+        // open addressing with linear probing, slots of older ticks are free by their stamp
+        Vector3[] keys = new Vector3[MAP_SLOTS];
+        float[] values = new float[MAP_SLOTS];
+        int[] stamps = new int[MAP_SLOTS];
+        int[] storedSlots = new int[MAP_MAX_STORED];
+        int stored;
+        int generation;
+
+        Vector3[] rayOrigins = new Vector3[MAX_RAYS];
+        Vector3[] rayDirections = new Vector3[MAX_RAYS];
+        float[] rayResults = new float[MAX_RAYS];
+        int[] raySteps = new int[MAX_RAYS];
+        int rays;
+
+        /// <summary>
+        /// Map calls of the tick answered without evaluating the scene
+        /// </summary>
+        public int Saved { get; private set; }
+
+        public PhysicsTick(Physics owner)
+        {
+            Owner = owner;
+        }
+
+        internal void Begin()
+        {
+            generation++;
+            stored = 0;
+            rays = 0;
+            Saved = 0;
+        }
+
+        // Map memo ----------------------------------------------------------------------
+
+        int Probe(Vector3 pos)
+        {
+            int slot = pos.GetHashCode() & (MAP_SLOTS - 1);
+
+            while (stamps[slot] == generation && keys[slot] != pos)
+                slot = (slot + 1) & (MAP_SLOTS - 1);
+
+            return slot;
+        }
+
+        internal bool TryGetMap(Vector3 pos, out float d)
+        {
+            int slot = Probe(pos);
+            d = values[slot];
+
+            if (stamps[slot] != generation)
+                return false;
+
+            Saved++;
+            return true;
+        }
+
+        internal void StoreMap(Vector3 pos, float d)
+        {
+            if (stored == MAP_MAX_STORED)
+                return;
+
+            int slot = Probe(pos);
+            if (stamps[slot] == generation)
+                return;
+
+            keys[slot] = pos;
+            values[slot] = d;
+            stamps[slot] = generation;
+            storedSlots[stored++] = slot;
+        }
+
+        // Rays ----------------------------------------------------------------------
+
+        internal bool TryGetRay(Vector3 ro, Vector3 rd, out float t)
+        {
+            for (int i = 0; i < rays; i++)
+                if (rayOrigins[i] == ro && rayDirections[i] == rd)
+                {
+                    t = rayResults[i];
+                    Saved += raySteps[i];
+                    return true;
+                }
+
+            t = 0f;
+            return false;
+        }
+
+        internal void StoreRay(Vector3 ro, Vector3 rd, float t, int steps)
+        {
+            if (rays == MAX_RAYS)
+                return;
+
+            rayOrigins[rays] = ro;
+            rayDirections[rays] = rd;
+            rayResults[rays] = t;
+            raySteps[rays] = steps;
+            rays++;
+        }
+
+        /// <summary>
+        /// Distance along the ray free of surfaces by the balls of the memoized Map values,
+        /// the march of the ray may start there. Every ball passed saves at least one step.
+        /// The balls hold only while Map is a true distance bound, its primitives use exact lengths.
+        /// </summary>
+        /// <param name="rd">Unit direction</param>
+        internal float StartDistance(Vector3 ro, Vector3 rd)
+        {
+            float t = 0f;
+
+            for (int hop = 0; hop < MAX_HOPS; hop++)
+            {
+                Vector3 p = ro + rd * t;
+                float exit = 0f;
+
+                for (int i = 0; i < stored; i++)
+                {
+                    int slot = storedSlots[i];
+                    float r = values[slot];
+                    Vector3 v = p - keys[slot];
+                    float c = v.LengthSquared - r * r;
+
+                    if (r <= 0f || c >= 0f)
+                        continue;
+
+                    // farther root of |v + rd * s| = r
+                    float b = Vector3.Dot(v, rd);
+                    exit = Math.Max(exit, -b + (float)Math.Sqrt(b * b - c));
+                }
+
+                if (exit <= Const.PHYS_SWEEP_CONTACT_DIST)
+                    break;
+
+                t += exit;
+                Saved++;
+            }
+
+            return t;
+        }
+    }
+}
@@ -0,0 +1,350 @@
+﻿using OpenTK;
+using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Threading.Tasks;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Triangle mesh of the surface of a distance field (Physics.Map, SdScene.Distance) by dual
+    /// contouring over a sparse octree. A node is split only while its center is closer to the
+    /// surface than its half diagonal, so with a 1-Lipschitz field no leaf crossed by the surface
+    /// is missed and empty space costs one sample per node. Every crossed leaf gets one vertex at
+    /// the mass point of its edge crossings, pulled onto the surface along the gradient, and every
+    /// crossed edge a quad of the four leaves around it. All leaves have the finest size, the mesh
+    /// has no cracks. Subtrees run in parallel, each worker fills an arena of its own, and the
+    /// arenas are welded by the cell of the vertex at the end.
+    /// </summary>
+    public class Polygonizer
+    {
+        const int SPLIT_LEVEL = 3;          // subtrees of this level are the parallel work items
+        const int PROJECT_STEPS = 2;        // Newton steps pulling a vertex onto the surface
+        const float GRADIENT_EPS = 0.01f;   // of the cell size
+        const int KEY_BITS = 21;            // per axis of a cell or corner key
+        const long ENTRY_BYTES = 24;        // Dictionary<long, int or float> entry with its bucket
+
+        /// <summary>
+        /// Distance bound of the field, the nodes are pruned by it
+        /// </summary>
+        public float Lipschitz = 1f;
+
+        /// <summary>
+        /// Worker threads, 1 runs the whole octree on the calling thread
+        /// </summary>
+        public int MaxDegreeOfParallelism = Environment.ProcessorCount;
+
+        /// <summary>
+        /// Octree nodes sampled by the last Run
+        /// </summary>
+        public long Nodes { get; private set; }
+
+        /// <summary>
+        /// Leaf cells reached by the last Run
+        /// </summary>
+        public long Leaves { get; private set; }
+
+        /// <summary>
+        /// Peak size of the worker arenas of the last Run, estimated from their capacities
+        /// </summary>
+        public long ArenaBytes { get; private set; }
+
+        readonly Func<Vector3, float> field;
+        readonly Vector3 min;
+        readonly float cellSize;
+        readonly int depth,
+            resolution;
+
+        /// <summary>
+        /// Vertices and triangles of one worker, indices are local until the merge
+        /// </summary>
+        class Arena
+        {
+            public readonly List<Vector3> Positions = new List<Vector3>();
+            public readonly List<Vector3> Normals = new List<Vector3>();
+            public readonly List<long> Cells = new List<long>();
+            public readonly List<int> Indices = new List<int>();
+            public readonly Dictionary<long, int> Vertices = new Dictionary<long, int>();
+            public readonly Dictionary<long, float> Corners = new Dictionary<long, float>();
+            public readonly float[] CellCorners = new float[8];
+            public long Nodes,
+                Leaves;
+
+            public long Bytes =>
+                (Positions.Capacity + Normals.Capacity) * 12L + Cells.Capacity * 8L + Indices.Capacity * 4L
+                + (Vertices.Count + Corners.Count) * ENTRY_BYTES;
+        }
+
+        /// <param name="min">Lowest corner of the cube polygonized</param>
+        /// <param name="size">Side of the cube</param>
+        /// <param name="depth">Octree levels, the leaves are size / 2^depth</param>
+        public Polygonizer(Func<Vector3, float> field, Vector3 min, float size, int depth)
+        {
+            this.field = field;
+            this.min = min;
+            this.depth = Math.Min(depth, KEY_BITS - 1);
+            resolution = 1 << this.depth;
+            cellSize = size / resolution;
+        }
+
+        public TriangleMesh Run()
+        {
+            var roots = new List<int[]>();
+            var arenas = new ConcurrentBag<Arena>();
+            var top = new Arena();
+
+            Collect(top, roots, 0, 0, 0, resolution, Math.Min(SPLIT_LEVEL, depth));
+            arenas.Add(top);
+
+            var options = new ParallelOptions { MaxDegreeOfParallelism = MaxDegreeOfParallelism };
+            Parallel.ForEach(roots, options,
+                () => new Arena(),
+                (node, state, arena) =>
+                {
+                    Descend(arena, node[0], node[1], node[2], node[3]);
+                    return arena;
+                },
+                arena => arenas.Add(arena));
+
+            return Merge(arenas);
+        }
+
+        // Octree ----------------------------------------------------------------------
+
+        Vector3 Corner(int x, int y, int z) => min + new Vector3(x, y, z) * cellSize;
+
+        /// <summary>
+        /// The node may hold a part of the surface
+        /// </summary>
+        bool Crossed(Arena arena, int x, int y, int z, int cells)
+        {
+            arena.Nodes++;
+
+            float half = cells * cellSize * 0.5f;
+            float d = field(Corner(x, y, z) + new Vector3(half));
+
+            // half diagonal of the node
+            return Math.Abs(d) <= half * 1.7320508f * Lipschitz;
+        }
+
+        /// <summary>
+        /// Crossed nodes of the split level, sampled on the calling thread
+        /// </summary>
+        void Collect(Arena arena, List<int[]> roots, int x, int y, int z, int cells, int levels)
+        {
+            if (!Crossed(arena, x, y, z, cells))
+                return;
+
+            if (levels == 0)
+            {
+                roots.Add(new[] { x, y, z, cells });
+                return;
+            }
+
+            int half = cells / 2;
+            for (int child = 0; child < 8; child++)
+                Collect(arena, roots, x + (child & 1) * half, y + (child >> 1 & 1) * half, z + (child >> 2) * half, half, levels - 1);
+        }
+
+        void Descend(Arena arena, int x, int y, int z, int cells)
+        {
+            if (cells == 1)
+            {
+                Leaf(arena, x, y, z);
+                return;
+            }
+
+            int half = cells / 2;
+            for (int child = 0; child < 8; child++)
+            {
+                int cx = x + (child & 1) * half,
+                    cy = y + (child >> 1 & 1) * half,
+                    cz = z + (child >> 2) * half;
+
+                if (Crossed(arena, cx, cy, cz, half))
+                    Descend(arena, cx, cy, cz, half);
+            }
+        }
+
+        // Contouring ----------------------------------------------------------------------
+
+        static long Key(int x, int y, int z) => (long)x | (long)y << KEY_BITS | (long)z << 2 * KEY_BITS;
+
+        float Sample(Arena arena, int x, int y, int z)
+        {
+            long key = Key(x, y, z);
+            if (!arena.Corners.TryGetValue(key, out float d))
+            {
+                d = field(Corner(x, y, z));
+                arena.Corners.Add(key, d);
+            }
+
+            return d;
+        }
+
+        /// <summary>
+        /// Emits the quads of the three edges leaving the lowest corner of the leaf,
+        /// every edge of the grid belongs to exactly one leaf
+        /// </summary>
+        void Leaf(Arena arena, int x, int y, int z)
+        {
+            arena.Leaves++;
+
+            bool inside = Sample(arena, x, y, z) < 0f;
+
+            for (int axis = 0; axis < 3; axis++)
+            {
+                int ex = axis == 0 ? 1 : 0,
+                    ey = axis == 1 ? 1 : 0,
+                    ez = axis == 2 ? 1 : 0;
+
+                if ((Sample(arena, x + ex, y + ey, z + ez) < 0f) == inside)
+                    continue;
+
+                // the other two axes in cyclic order, b x c = axis
+                int bx = ez, by = ex, bz = ey;
+                int cx = ey, cy = ez, cz = ex;
+
+                if (x - bx - cx < 0 || y - by - cy < 0 || z - bz - cz < 0)
+                    continue;
+
+                // counter-clockwise around the axis, the quad faces +axis
+                int v0 = Vertex(arena, x, y, z),
+                    v1 = Vertex(arena, x - bx, y - by, z - bz),
+                    v2 = Vertex(arena, x - bx - cx, y - by - cy, z - bz - cz),
+                    v3 = Vertex(arena, x - cx, y - cy, z - cz);
+
+                // the surface faces the outside end of the edge
+                if (!inside)
+                {
+                    int swap = v1;
+                    v1 = v3;
+                    v3 = swap;
+                }
+
+                arena.Indices.Add(v0); arena.Indices.Add(v1); arena.Indices.Add(v2);
+                arena.Indices.Add(v0); arena.Indices.Add(v2); arena.Indices.Add(v3);
+            }
+        }
+
+        Vector3 Gradient(Vector3 p)
+        {
+            float e = cellSize * GRADIENT_EPS;
+            return new Vector3(
+                field(p + new Vector3(e, 0f, 0f)) - field(p - new Vector3(e, 0f, 0f)),
+                field(p + new Vector3(0f, e, 0f)) - field(p - new Vector3(0f, e, 0f)),
+                field(p + new Vector3(0f, 0f, e)) - field(p - new Vector3(0f, 0f, e))) / (2f * e);
+        }
+
+        /// <summary>
+        /// Vertex of a leaf crossed by the surface, placed once per arena
+        /// </summary>
+        int Vertex(Arena arena, int x, int y, int z)
+        {
+            long key = Key(x, y, z);
+            if (arena.Vertices.TryGetValue(key, out int index))
+                return index;
+
+            float[] d = arena.CellCorners;
+            for (int i = 0; i < 8; i++)
+                d[i] = Sample(arena, x + (i & 1), y + (i >> 1 & 1), z + (i >> 2));
+
+            // mass point of the crossings of the 12 edges
+            Vector3 sum = Vector3.Zero;
+            int crossings = 0;
+
+            for (int i = 0; i < 8; i++)
+                for (int bit = 1; bit < 8; bit <<= 1)
+                {
+                    int j = i | bit;
+                    if ((i & bit) != 0 || (d[i] < 0f) == (d[j] < 0f))
+                        continue;
+
+                    float t = d[i] / (d[i] - d[j]);
+                    var a = new Vector3(i & 1, i >> 1 & 1, i >> 2);
+                    var b = new Vector3(j & 1, j >> 1 & 1, j >> 2);
+                    sum += a + (b - a) * t;
+                    crossings++;
+                }
+
+            Vector3 low = Corner(x, y, z);
+            Vector3 p = low + sum * (cellSize / Math.Max(crossings, 1));
+
+            // Newton steps onto the surface, kept in the cell so the quads do not fold
+            for (int step = 0; step < PROJECT_STEPS; step++)
+            {
+                Vector3 g = Gradient(p);
+                float g2 = Vector3.Dot(g, g);
+                if (g2 < 1e-8f)
+                    break;
+
+                p -= g * (field(p) / g2);
+                p = new Vector3(
+                    Math.Max(low.X, Math.Min(low.X + cellSize, p.X)),
+                    Math.Max(low.Y, Math.Min(low.Y + cellSize, p.Y)),
+                    Math.Max(low.Z, Math.Min(low.Z + cellSize, p.Z)));
+            }
+
+            Vector3 normal = Gradient(p);
+            float length = normal.Length;
+
+            index = arena.Positions.Count;
+            arena.Positions.Add(p);
+            arena.Normals.Add(length > 0f ? normal / length : Vector3.UnitY);
+            arena.Cells.Add(key);
+            arena.Vertices.Add(key, index);
+            return index;
+        }
+
+        /// <summary>
+        /// Vertices of the same cell placed by several workers become one
+        /// </summary>
+        TriangleMesh Merge(IEnumerable<Arena> arenas)
+        {
+            int vertexBound = 0,
+                indexCount = 0;
+            long nodes = 0,
+                leaves = 0,
+                bytes = 0;
+
+            foreach (Arena arena in arenas)
+            {
+                vertexBound += arena.Positions.Count;
+                indexCount += arena.Indices.Count;
+                nodes += arena.Nodes;
+                leaves += arena.Leaves;
+                bytes += arena.Bytes;
+            }
+
+            var welded = new Dictionary<long, int>(vertexBound);
+            var positions = new List<Vector3>(vertexBound);
+            var normals = new List<Vector3>(vertexBound);
+            var indices = new int[indexCount];
+            int next = 0;
+
+            foreach (Arena arena in arenas)
+            {
+                var remap = new int[arena.Positions.Count];
+                for (int i = 0; i < remap.Length; i++)
+                {
+                    if (!welded.TryGetValue(arena.Cells[i], out remap[i]))
+                    {
+                        remap[i] = positions.Count;
+                        welded.Add(arena.Cells[i], remap[i]);
+                        positions.Add(arena.Positions[i]);
+                        normals.Add(arena.Normals[i]);
+                    }
+                }
+
+                foreach (int local in arena.Indices)
+                    indices[next++] = remap[local];
+            }
+
+            Nodes = nodes;
+            Leaves = leaves;
+            ArenaBytes = bytes;
+
+            return new TriangleMesh(positions.ToArray(), normals.ToArray(), indices);
+        }
+    }
+}
@@ -0,0 +1,24 @@
+﻿using System.Collections.Concurrent;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Named event counters shared by the render and input threads,
+    /// readers take a counter and it starts again from zero
+    /// </summary>
+    public static class Profiler
+    {
+        static readonly ConcurrentDictionary<string, long> counters = new ConcurrentDictionary<string, long>();
+
+        public static void Count(string name, long n = 1)
+        {
+            counters.AddOrUpdate(name, n, (key, value) => value + n);
+        }
+
+        public static long Take(string name)
+        {
+            counters.TryRemove(name, out long value);
+            return value;
+        }
+    }
+}
@@ -1,16 +1,79 @@
-﻿using System;
+﻿using OpenTK;
+using System;
 
 namespace GldeTK
 {
     static class Program
     {
         [STAThread]
-        static void Main()
+        static void Main(string[] args)
         {
-            using (MainWindow mainWindow = new MainWindow())
+            if (args.Length > 0 && args[0] == Const.ARG_BENCHMARK)
             {
-                mainWindow.Run();
+                Benchmark.Run(args);
+                return;
             }
+
+            if (args.Length > 1 && args[0] == Const.ARG_MESH)
+            {
+                ExportMesh(args[1], args.Length > 2 ? int.Parse(args[2]) : 0);
+                return;
+            }
+
+            if (args.Length > 2 && args[0] == Const.ARG_PACK)
+            {
+                ConvertPack(args[1], args[2]);
+                return;
+            }
+
+            ScenePack pack = null;
+            if (args.Length > 1 && args[0] == Const.ARG_SCENE)
+            {
+                pack = ScenePack.Open(args[1]);
+                if (pack == null)
+                {
+                    Console.WriteLine($"{args[1]}: missing or not a scene pack of version {ScenePack.VERSION}");
+                    return;
+                }
+            }
+
+            ShaderLoader.Pack = pack;
+
+            using (MainWindow mainWindow = new MainWindow(pack))
+            {
+                // events and the title only, frames are paced by the RenderThread
+                mainWindow.Run(Const.WINDOW_EVENT_RATE, Const.WINDOW_EVENT_RATE);
+            }
+
+            pack?.Dispose();
+        }
+
+        /// <summary>
+        /// Writes the scene pack of a text description, see ScenePackBuilder
+        /// </summary>
+        static void ConvertPack(string source, string path)
+        {
+            ScenePackBuilder builder = ScenePackBuilder.FromText(source, Console.Out);
+            if (builder == null)
+                return;
+
+            long bytes = builder.Save(path);
+            Console.WriteLine($"{path}: {bytes} bytes");
+        }
+
+        /// <summary>
+        /// Polygonizes Physics.Map with a field of elements around the origin, as F3 scatters them
+        /// </summary>
+        static void ExportMesh(string path, int elements)
+        {
+            var scene = new SdScene();
+            scene.SetElements(SdScene.Scatter(elements, Vector3.Zero, Const.SCENE_FIELD_EXTENT));
+            var physics = new Physics(scene);
+
+            TriangleMesh mesh = new Polygonizer(physics.Map, Const.MESH_ORIGIN, Const.MESH_SIZE, Const.MESH_DEPTH).Run();
+            mesh.Save(path);
+
+            Console.WriteLine($"{path}: {mesh.Positions.Length} vertices, {mesh.TriangleCount} triangles");
         }
     }
 }
@@ -1,88 +1,244 @@
 ﻿using OpenTK;
 using OpenTK.Graphics.OpenGL4;
 using System;
-using System.IO;
-using System.Reflection;
+using System.Text;
+using System.Threading;
 
 
 namespace GldeTK
 {
+    public enum RenderBackend
+    {
+        Fragment,
+        Compute,
+        Deferred
+    }
+
     public class Render
     {
-        int h_vertex,
-            h_fragment,
-            h_shaderProgram;
+        int h_shaderProgram;
+
+        int ubo_GlobalMap,
+            ubo_FrameParams;
+
+        SdScene scene;
+        RigidBodies bodies;
+        PhysicsQueries queries;
+        Vector4[] mapBlock = new Vector4[Const.UBO_SDELEMENTSMAP_BLOCKCOUNT];
+        int mapBlockVersion = -1;
+
+        SceneUniforms sceneUniforms;
+        ComputeMarcher computeMarcher = new ComputeMarcher();
+        DeferredShading deferredShading = new DeferredShading();
+        TileBinner tileBinner = new TileBinner();
+        TileCuller tileCuller = new TileCuller();
+        FrameCache frameCache = new FrameCache();
+        BodyGrid bodyGrid = new BodyGrid();
+        ShadowMap shadowMap = new ShadowMap();
+        AoCache aoCache = new AoCache();
+        SculptBricks sculptBricks;
+        ParticleSystem particles = new ParticleSystem();
+        FrameCapture capture = new FrameCapture();
+        Hud hud = new Hud();
+        MeshPass meshPass = new MeshPass();
+        GpuTimer marchTimer = new GpuTimer(Const.PROFILER_GPU_MARCH);
+        FrameState lastFrame;
+        float lastGlobalTime;
+
+        // bumped by every toggle of the input thread after the flag, the render thread reads
+        // the flags once per frame and drops the cached image when it differs
+        int settingsVersion;
+
+        public RenderBackend Backend { get; private set; } = RenderBackend.Fragment;
+
+        /// <summary>
+        /// Marchers evaluate only the SdElements binned into the pixel's screen tile
+        /// </summary>
+        public bool TileBinning { get; private set; }
+
+        /// <summary>
+        /// Primary rays skip the depth ranges proven empty for their screen tile
+        /// </summary>
+        public bool TileCulling { get; private set; }
+
+        /// <summary>
+        /// A still view is supersampled over the next frames instead of just presented again
+        /// </summary>
+        public bool ProgressiveRefinement { get; private set; }
+
+        /// <summary>
+        /// The elements are rasterized by MeshPass and depth tested against the march, which skips them
+        /// </summary>
+        public bool RasterElements { get; private set; }
 
-        int uf_iGlobalTime,
-            uf_iResolution,
-            uf_CamRo,
-            um3_CamProj,
-            ubo_GlobalMap;
+        /// <summary>
+        /// GPU particle rain over the marched image
+        /// </summary>
+        public bool Particles => ParticleCount > 0;
+
+        /// <summary>
+        /// Particles of the rain, 0 - off
+        /// </summary>
+        public int ParticleCount { get; private set; }
+
+        /// <summary>
+        /// Shadows come from the cached ShadowMap instead of a march towards the light per pixel
+        /// </summary>
+        public bool ShadowMaps => shadowMap.Enabled && shadowMap.IsStarted;
+
+        /// <summary>
+        /// AO of the static scene comes from the world-space AoCache instead of calcAO() per pixel
+        /// </summary>
+        public bool AoCaching => aoCache.Enabled && aoCache.IsStarted;
 
-        private int GetUniformLocation(string uniformName)
+        /// <summary>
+        /// The presented frames are recorded to a Y4M file. Set by the input thread,
+        /// the render thread starts and stops the FrameCapture and clears it when the file can not be created.
+        /// </summary>
+        public bool Recording { get; private set; }
+
+        /// <summary>
+        /// File of the current or last recording
+        /// </summary>
+        public string CaptureFileName => capture.FileName;
+
+        public Render(SdScene scene, Sculpt sculpt, RigidBodies bodies, PhysicsQueries queries)
         {
-            return GL.GetUniformLocation(h_shaderProgram, uniformName);
+            this.scene = scene;
+            sculptBricks = new SculptBricks(sculpt);
+            this.bodies = bodies;
+            this.queries = queries;
         }
 
         /// <summary>
-        /// Detach than delete shader
+        /// Cycles the fullscreen fragment marcher, the compute marcher and the deferred passes
         /// </summary>
-        /// <param name="h_program">Shader program name index</param>
-        /// <param name="h_index">Shader name index</param>
-        private void RemoveShader(int h_program, int h_index)
+        public void ToggleBackend()
         {
-            GL.DetachShader(h_program, h_index);
-            GL.DeleteShader(h_index);
-            h_index = -1;
+            if (Backend == RenderBackend.Fragment && computeMarcher.IsStarted)
+                Backend = RenderBackend.Compute;
+            else if (Backend != RenderBackend.Deferred)
+                Backend = RenderBackend.Deferred;
+            else
+                Backend = RenderBackend.Fragment;
+
+            Interlocked.Increment(ref settingsVersion);
         }
 
-        private string LoadEmbeddedFile(string filename)
+        public void ToggleTileBinning()
         {
-            Stream stream = Assembly.GetExecutingAssembly().GetManifestResourceStream(filename);
-            TextReader reader = new StreamReader(stream);
+            TileBinning = !TileBinning && tileBinner.IsStarted;
+            Interlocked.Increment(ref settingsVersion);
+        }
 
-            return reader.ReadToEnd();
+        public void ToggleTileCulling()
+        {
+            TileCulling = !TileCulling && tileCuller.IsStarted;
+            Interlocked.Increment(ref settingsVersion);
         }
 
-        private void CreateShaders()
+        public void ToggleRasterElements()
         {
-            h_vertex = GL.CreateShader(ShaderType.VertexShader);
-            h_fragment = GL.CreateShader(ShaderType.FragmentShader);
+            RasterElements = !RasterElements && meshPass.IsStarted;
+            Interlocked.Increment(ref settingsVersion);
+        }
 
-            GL.ShaderSource(h_vertex, LoadEmbeddedFile(Const.VERTEX_FILENAME));
-            GL.ShaderSource(h_fragment, LoadEmbeddedFile(Const.FRAGMENT_FILENAME));
+        /// <summary>
+        /// Rain off, on, on with the million particles of PARTICLES_COUNT_MAX
+        /// </summary>
+        public void CycleParticles()
+        {
+            if (!particles.IsStarted)
+                return;
 
-            GL.CompileShader(h_vertex);
-            GL.CompileShader(h_fragment);
+            ParticleCount = ParticleCount == 0 ? Const.PARTICLES_COUNT
+                : ParticleCount == Const.PARTICLES_COUNT ? Const.PARTICLES_COUNT_MAX
+                : 0;
+        }
 
-            h_shaderProgram = GL.CreateProgram();
+        /// <summary>
+        /// Next resolution tier of the deferred shadow and AO passes
+        /// </summary>
+        public void CycleOcclusionScale()
+        {
+            int tier = Array.IndexOf(Const.OCCLUSION_SCALES, deferredShading.OcclusionScale);
+            deferredShading.OcclusionScale = Const.OCCLUSION_SCALES[(tier + 1) % Const.OCCLUSION_SCALES.Length];
+            Interlocked.Increment(ref settingsVersion);
+        }
 
-            GL.AttachShader(h_shaderProgram, h_vertex);
-            GL.AttachShader(h_shaderProgram, h_fragment);
+        public void ToggleShadowMap()
+        {
+            shadowMap.Enabled = !shadowMap.Enabled;
+            Interlocked.Increment(ref settingsVersion);
+        }
 
-            GL.LinkProgram(h_shaderProgram);
+        public void ToggleAoCache()
+        {
+            aoCache.Enabled = !aoCache.Enabled;
+            Interlocked.Increment(ref settingsVersion);
+        }
 
-            RemoveShader(h_shaderProgram, h_vertex);
-            RemoveShader(h_shaderProgram, h_fragment);
+        public void ToggleCapture()
+        {
+            Recording = !Recording;
+        }
+
+        public void ToggleHud()
+        {
+            hud.Enabled = !hud.Enabled;
+        }
+
+        /// <summary>
+        /// Stats text of the Hud, lines end with '\n'
+        /// </summary>
+        public void PostStats(StringBuilder stats) => hud.Post(stats);
+
+        public void ToggleProgressiveRefinement()
+        {
+            ProgressiveRefinement = !ProgressiveRefinement;
+            Interlocked.Increment(ref settingsVersion);
+        }
+
+        private void CreateShaders()
+        {
+            h_shaderProgram = ShaderLoader.Link(
+                ShaderLoader.Compile(ShaderType.VertexShader, Const.VERTEX_FILENAME),
+                ShaderLoader.Compile(ShaderType.FragmentShader, Const.FRAGMENT_FILENAME));
 
             GL.UseProgram(h_shaderProgram);
             CreateMapUbo();
+            CreateFrameParamsUbo();
 
-            uf_iGlobalTime = GetUniformLocation(Const.UF_TIMER);
-            uf_iResolution = GetUniformLocation(Const.UF_RESOLUTION);
-            uf_CamRo = GetUniformLocation(Const.UF_RAY_ORIGIN);
-            um3_CamProj = GetUniformLocation(Const.UF_PROJECTION_MATRIX);
+            sceneUniforms = new SceneUniforms(h_shaderProgram);
         }
 
         public void Start()
         {
             CreateShaders();
             GL.Disable(EnableCap.DepthTest);
+            frameCache.Start();
+            bodyGrid.Start();
+            deferredShading.Start();
+            shadowMap.Start();
+            sculptBricks.Start();
+            hud.Start();
+            meshPass.Start();
+            marchTimer.Start();
+
+            if (ComputeMarcher.IsSupported)
+            {
+                computeMarcher.Start();
+                tileBinner.Start();
+                tileCuller.Start();
+                particles.Start(Const.PARTICLES_COUNT);
+                aoCache.Start();
+                queries.Start();
+            }
         }
 
         private void CreateMapUbo()
         {
-            int binding_point = 1;
+            int binding_point = Const.UBO_SDELEMENTSMAP_BINDING;
             int block_index = GL.GetUniformBlockIndex(h_shaderProgram, Const.UBO_SDELEMENTSMAP_BLOCKNAME);
             GL.UniformBlockBinding(h_shaderProgram, block_index, binding_point);
 
@@ -130,51 +286,242 @@ namespace GldeTK
             GL.BindBuffer(BufferTarget.UniformBuffer, 0);
         }
 
+        private void CreateFrameParamsUbo()
+        {
+            GL.GenBuffers(1, out ubo_FrameParams);
+            GL.BindBuffer(BufferTarget.UniformBuffer, ubo_FrameParams);
+            GL.BufferData(BufferTarget.UniformBuffer, FrameParams.SIZE, IntPtr.Zero, BufferUsageHint.StreamDraw);
+            GL.BindBufferBase(BufferRangeTarget.UniformBuffer, Const.UBO_FRAMEPARAMS_BINDING, ubo_FrameParams);
+            GL.BindBuffer(BufferTarget.UniformBuffer, 0);
+        }
+
+        /// <summary>
+        /// One upload serves every program of the frame
+        /// </summary>
+        void UploadFrameParams(FrameState frame)
+        {
+            var block = new FrameParams(frame);
+
+            GL.BindBuffer(BufferTarget.UniformBuffer, ubo_FrameParams);
+            GL.BufferSubData(BufferTarget.UniformBuffer, IntPtr.Zero, FrameParams.SIZE, ref block);
+            GL.BindBuffer(BufferTarget.UniformBuffer, 0);
+        }
+
         internal void OnResize(int width, int height)
         {
             GL.Viewport(0, 0, width, height);
+            frameCache.OnResize(width, height);
+            computeMarcher.OnResize(width, height);
+            deferredShading.OnResize(width, height);
+            tileBinner.OnResize(width, height);
+            tileCuller.OnResize(width, height);
+
+            // a recording keeps the size it started with
+            capture.End();
+            Recording = false;
         }
 
-        internal void OnFrame(float globalTime, int width, int height, Camera camera)
+        /// <summary>
+        /// Draws the frame or presents the cached one again when nothing has changed
+        /// </summary>
+        /// <param name="camera">Camera of the snapshot, late-latched</param>
+        internal void OnFrame(FrameSnapshot snapshot, int width, int height, Camera camera)
         {
-            GL.UseProgram(h_shaderProgram);
+            // time-driven shading changes slowly, stepping it lets a still view stay still
+            var frame = new FrameState(snapshot.GlobalTime, width, height, camera, snapshot.SceneVersion, bodies.Version);
+
+            // the toggles of the input thread, read once, every pass of the frame sees the same
+            frame.SettingsVersion = Volatile.Read(ref settingsVersion);
+            frame.Backend = Backend;
+            frame.TileBinning = TileBinning;
+            frame.TileCulling = TileCulling;
+            frame.RasterElements = RasterElements;
+            float delta = snapshot.GlobalTime - lastGlobalTime;
+            lastGlobalTime = snapshot.GlobalTime;
+
+            // bound before the skip test, the particles collide with the bodies too
+            bodyGrid.OnFrame(ref frame, bodies);
+            UploadMapBlock(frame.SceneVersion);
+            sculptBricks.OnFrame(ref frame);
+
+            bool shadowMapSlice = shadowMap.OnFrame(ref frame);
+            aoCache.OnFrame(ref frame);
+
+            // a band of the next shadow map, marched with its own light and center
+            if (shadowMapSlice)
+            {
+                FrameState view = shadowMap.NextMapFrame(frame);
+                UploadFrameParams(view);
+                shadowMap.Render(view, width, height);
+            }
+            UploadFrameParams(frame);
+
+            if (queries.IsStarted)
+                queries.OnFrame(frame);
+
+            Profiler.Count(Const.PROFILER_FRAMES);
+
+            if (!frame.SameView(ref lastFrame))
+                frameCache.Invalidate();
+            lastFrame = frame;
+
+            int maxSamples = ProgressiveRefinement ? Const.REFINE_MAX_SAMPLES : 1;
+            if (frameCache.Samples >= maxSamples)
+            {
+                Profiler.Count(Const.PROFILER_FRAMES_SKIPPED);
+                frameCache.Present();
+            }
+            else
+            {
+                var sample = frame;
+                sample.Jitter = FrameCache.GetJitter(frameCache.Samples);
+
+                UploadFrameParams(sample);
+                // only the AO pass of the deferred backend reads the cache
+                if (frame.Backend == RenderBackend.Deferred)
+                    aoCache.Fill(sample, frameCache.DistanceTexture);
+                Prepare(sample);
+
+                frameCache.BeginSample();
+                if (frame.RasterElements)
+                    meshPass.Draw(sample);
+                Draw(sample);
+                frameCache.EndSample();
+
+                frameCache.Present();
+            }
+
+            // composited after the cache, moving particles do not invalidate the scene
+            int particleCount = ParticleCount;
+            if (particleCount > 0)
+            {
+                if (particles.Count != particleCount)
+                    particles.Resize(particleCount);
+
+                particles.Step(frame, delta);
+                particles.Draw(frame, frameCache.DistanceTexture);
+            }
+
+            hud.Draw(width, height);
+
+            if (Recording != capture.IsRecording)
+            {
+                if (Recording)
+                    Recording = capture.Begin(width, height);
+                else
+                    capture.End();
+            }
+
+            if (capture.IsRecording)
+                capture.OnFrame();
+        }
 
-            GL.Uniform1(uf_iGlobalTime, globalTime);
-            GL.Uniform3(uf_iResolution, width, height, 0.0f);
-            GL.Uniform3(uf_CamRo, camera.Origin);
-            GL.UniformMatrix3(um3_CamProj, false, ref camera.Projection);
+        /// <summary>
+        /// The scene may be ahead of the snapshot, a newer block is just uploaded once more
+        /// </summary>
+        void UploadMapBlock(int sceneVersion)
+        {
+            if (mapBlockVersion == sceneVersion)
+                return;
+
+            mapBlockVersion = sceneVersion;
+            SdElement[] elements = scene.Elements;
+            meshPass.OnElements(elements);
 
             GL.BindBuffer(BufferTarget.UniformBuffer, ubo_GlobalMap);
-            Vector4[] v = new Vector4[1];
-            v[0] = new Vector4(1, 1, 2, 1);
 
-            GL.BufferSubData<Vector4>(
-                BufferTarget.UniformBuffer,
-                (IntPtr)0,
-                16,
-                v
-                );
+            // a scene loaded from a pack goes to the driver straight from the mapped file
+            IntPtr mapped = scene.GetMappedBlock(elements, out int bytes);
+            if (mapped != IntPtr.Zero)
+                GL.BufferSubData(BufferTarget.UniformBuffer, (IntPtr)0, bytes, mapped);
+            else
+            {
+                int count = scene.ToBlock(mapBlock, elements);
+                GL.BufferSubData<Vector4>(
+                    BufferTarget.UniformBuffer,
+                    (IntPtr)0,
+                    count * Vector4.SizeInBytes,
+                    mapBlock
+                    );
+            }
 
-            //float[] v = new float[4] { 1, 0, 0, 0 };
+            GL.BindBuffer(BufferTarget.UniformBuffer, 0);
+        }
+
+        /// <summary>
+        /// Passes of the sample that render offscreen, before the cache is bound for blending
+        /// </summary>
+        void Prepare(FrameState frame)
+        {
+            if (frame.TileBinning)
+                tileBinner.OnFrame(frame);
 
-            //GL.BufferSubData<float>(
-            //    BufferTarget.UniformBuffer,
-            //    (IntPtr)0,
-            //    16,
-            //    v
-            //    );
+            if (frame.TileCulling)
+                tileCuller.OnFrame(frame, frame.TileBinning);
 
-            GL.DrawArrays(PrimitiveType.Triangles, 0, 3);
+            if (frame.Backend == RenderBackend.Deferred)
+                deferredShading.OnFrame(frame, frame.TileBinning, frame.TileCulling, frame.RasterElements);
+        }
+
+        void Draw(FrameState frame)
+        {
+            if (frame.Backend == RenderBackend.Deferred)
+            {
+                deferredShading.Resolve(frame);
+                return;
+            }
+
+            // the deferred passes have timers of their own, timers must not nest
+            marchTimer.Begin();
+
+            if (frame.Backend == RenderBackend.Compute)
+                computeMarcher.OnFrame(frame, frame.TileBinning, frame.TileCulling, frame.RasterElements);
+            else
+            {
+                GL.UseProgram(h_shaderProgram);
+                sceneUniforms.Set(frame, frame.TileBinning, frame.TileCulling, frame.RasterElements);
+
+                GL.DrawArrays(PrimitiveType.Triangles, 0, 3);
+
+                GL.UseProgram(0);
+            }
+
+            marchTimer.End();
+        }
+
+        /// <summary>
+        /// GPU times since the last call: the deferred passes or the march of the other backends,
+        /// and the MeshPass while the elements are rasterized
+        /// </summary>
+        public string TakeGpuTimes()
+        {
+            string deferred = deferredShading.TakeTimes(),
+                march = $" {marchTimer.Name} {marchTimer.TakeMilliseconds().ToString("0.0")}ms",
+                mesh = meshPass.TakeTimes();
 
-            GL.UseProgram(0);
+            return (Backend == RenderBackend.Deferred ? deferred : march) + (RasterElements ? mesh : "");
         }
 
         internal void Stop()
         {
+            capture.End();
+            computeMarcher.Stop();
+            deferredShading.Stop();
+            shadowMap.Stop();
+            aoCache.Stop();
+            sculptBricks.Stop();
+            tileBinner.Stop();
+            tileCuller.Stop();
+            frameCache.Stop();
+            bodyGrid.Stop();
+            particles.Stop();
+            hud.Stop();
+            meshPass.Stop();
+            marchTimer.Stop();
+            queries.Stop();
             GL.DeleteBuffers(1, ref ubo_GlobalMap);
+            GL.DeleteBuffers(1, ref ubo_FrameParams);
             GL.DeleteProgram(h_shaderProgram);
-            RemoveShader(h_shaderProgram, h_vertex);
-            RemoveShader(h_shaderProgram, h_fragment);
         }
     }
 }
@@ -0,0 +1,111 @@
+﻿using OpenTK;
+using System.Collections.Concurrent;
+using System.Diagnostics;
+using System.Drawing;
+using System.Threading;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Draws on a thread of its own with the GL context of the window, so window messages
+    /// (resizing, the resolution change of F11) never stall a frame and neither the event
+    /// nor the input thread ever waits on the GPU. Both post to lock-free queues:
+    /// FrameSnapshot every input tick, of which only the newest is drawn, and resizes.
+    /// </summary>
+    public class RenderThread
+    {
+        readonly GameWindow window;
+        readonly Render render;
+        readonly FpsController motionCtrl;
+
+        ConcurrentQueue<FrameSnapshot> snapshots = new ConcurrentQueue<FrameSnapshot>();
+        ConcurrentQueue<Size> resizes = new ConcurrentQueue<Size>();
+
+        Thread thread;
+        volatile bool running;
+
+        public readonly FrameLimiter FrameLimiter = new FrameLimiter();
+
+        /// <summary>
+        /// Seconds between the last two frames
+        /// </summary>
+        public float FrameTime { get; private set; }
+
+        public RenderThread(GameWindow window, Render render, FpsController motionCtrl)
+        {
+            this.window = window;
+            this.render = render;
+            this.motionCtrl = motionCtrl;
+        }
+
+        /// <summary>
+        /// Takes the context from the calling thread, which must not use GL afterwards
+        /// </summary>
+        public void Start()
+        {
+            window.Context.MakeCurrent(null);
+
+            running = true;
+            thread = new Thread(Run) { Name = "Render", IsBackground = true };
+            thread.Start();
+        }
+
+        public void Post(FrameSnapshot snapshot) => snapshots.Enqueue(snapshot);
+
+        public void PostResize(int width, int height) => resizes.Enqueue(new Size(width, height));
+
+        /// <summary>
+        /// Waits for the last frame, GL objects are released on the render thread
+        /// </summary>
+        public void Stop()
+        {
+            running = false;
+            thread?.Join();
+        }
+
+        void Run()
+        {
+            window.MakeCurrent();
+            render.Start();
+
+            FrameSnapshot snapshot = null;
+            var size = Size.Empty;
+            long lastTimestamp = Stopwatch.GetTimestamp();
+
+            while (running)
+            {
+                while (resizes.TryDequeue(out Size resize))
+                {
+                    size = resize;
+                    render.OnResize(size.Width, size.Height);
+                }
+
+                // ticks between two frames are never drawn
+                while (snapshots.TryDequeue(out FrameSnapshot next))
+                    snapshot = next;
+
+                if (snapshot == null || size.IsEmpty)
+                {
+                    Thread.Sleep(1);
+                    continue;
+                }
+
+                // the newest mouse state is latched only after the GPU has caught up
+                FrameLimiter.Wait();
+                Camera view = motionCtrl.Latch(snapshot, out long inputTimestamp);
+
+                render.OnFrame(snapshot, size.Width, size.Height, view);
+                window.SwapBuffers();
+                FrameLimiter.Submit(inputTimestamp);
+
+                long timestamp = Stopwatch.GetTimestamp();
+                FrameTime = (float)(timestamp - lastTimestamp) / Stopwatch.Frequency;
+                lastTimestamp = timestamp;
+            }
+
+            FrameLimiter.Stop();
+            render.Stop();
+            window.Context.MakeCurrent(null);
+        }
+    }
+}
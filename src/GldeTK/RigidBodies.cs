@@ -0,0 +1,336 @@
+﻿using OpenTK;
+using System;
+using System.Collections.Concurrent;
+using System.Threading;
+using System.Threading.Tasks;
+using Lanes = System.Numerics.Vector<float>;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Dynamic spheres (debris, projectiles) colliding with Physics.Map and each other.
+    /// State is kept as structure of arrays, every pass runs over batches of bodies in parallel
+    /// and writes only the state of its own bodies. The world narrowphase measures the scene
+    /// distance of a batch in SIMD lanes, only the bodies it can not prove free are swept.
+    /// </summary>
+    public class RigidBodies
+    {
+        // hash of the broadphase cells, primes of Teschner et al.
+        const int HASH_X = 73856093;
+        const int HASH_Y = 19349663;
+        const int HASH_Z = 83492791;
+
+        Physics physics;
+
+        float[] posX, posY, posZ,
+            velX, velY, velZ,
+            radius;
+
+        // contact response of the body pass, applied by the world pass
+        float[] pushX, pushY, pushZ,
+            impulseX, impulseY, impulseZ;
+
+        // scene distance at the body center, narrowphase
+        float[] world;
+
+        // broadphase: cell of every body, bucket lists chained through next
+        int[] cellX, cellY, cellZ,
+            next,
+            buckets;
+
+        int count;
+
+        public int Count => count;
+
+        public int Capacity => radius.Length;
+
+        /// <summary>
+        /// Worker threads of the passes, 1 runs them on the calling thread
+        /// </summary>
+        public int MaxDegreeOfParallelism = Environment.ProcessorCount;
+
+        // Step, Add and Clear of overlapping timer ticks, a step finding it taken is skipped
+        readonly object stepSync = new object();
+
+        // position and radius of every body after the last step, copied out under the lock
+        readonly object publishSync = new object();
+        readonly Vector4[] published;
+        int publishedCount;
+
+        /// <summary>
+        /// Increments on every step and change
+        /// </summary>
+        public int Version { get; private set; }
+
+        public RigidBodies(Physics physics, int capacity = Const.BODIES_MAX)
+        {
+            this.physics = physics;
+
+            posX = new float[capacity]; posY = new float[capacity]; posZ = new float[capacity];
+            velX = new float[capacity]; velY = new float[capacity]; velZ = new float[capacity];
+            radius = new float[capacity];
+
+            pushX = new float[capacity]; pushY = new float[capacity]; pushZ = new float[capacity];
+            impulseX = new float[capacity]; impulseY = new float[capacity]; impulseZ = new float[capacity];
+            world = new float[capacity];
+            published = new Vector4[capacity];
+
+            cellX = new int[capacity]; cellY = new int[capacity]; cellZ = new int[capacity];
+            next = new int[capacity];
+
+            // power of two, about two buckets per body
+            int size = 1;
+            while (size < 2 * capacity)
+                size <<= 1;
+            buckets = new int[size];
+        }
+
+        /// <summary>
+        /// Index of the new body or -1 when full
+        /// </summary>
+        /// <param name="r">Up to Const.BODIES_MAX_RADIUS</param>
+        public int Add(Vector3 position, Vector3 velocity, float r)
+        {
+            lock (stepSync)
+            {
+                if (count == Capacity)
+                    return -1;
+
+                int i = count++;
+                posX[i] = position.X; posY[i] = position.Y; posZ[i] = position.Z;
+                velX[i] = velocity.X; velY[i] = velocity.Y; velZ[i] = velocity.Z;
+                radius[i] = Math.Min(r, Const.BODIES_MAX_RADIUS);
+
+                Publish();
+                return i;
+            }
+        }
+
+        public void Clear()
+        {
+            lock (stepSync)
+            {
+                count = 0;
+                Publish();
+            }
+        }
+
+        /// <summary>
+        /// Position and radius of every body after the last step, never half-updated
+        /// </summary>
+        /// <param name="into">Capacity long at least</param>
+        /// <returns>Number of bodies copied</returns>
+        public int CopySnapshot(Vector4[] into)
+        {
+            lock (publishSync)
+            {
+                Array.Copy(published, into, publishedCount);
+                return publishedCount;
+            }
+        }
+
+        public Vector3 GetPosition(int i) => new Vector3(posX[i], posY[i], posZ[i]);
+
+        public Vector3 GetVelocity(int i) => new Vector3(velX[i], velY[i], velZ[i]);
+
+        /// <summary>
+        /// Skipped when the step of an earlier tick is still running
+        /// </summary>
+        public void Step(float delta)
+        {
+            if (!Monitor.TryEnter(stepSync))
+                return;
+
+            try
+            {
+                if (count == 0)
+                    return;
+
+                var options = new ParallelOptions { MaxDegreeOfParallelism = MaxDegreeOfParallelism };
+                var batches = Partitioner.Create(0, count, Const.BODIES_BATCH);
+
+                BuildBroadphase();
+
+                Parallel.ForEach(batches, options, range =>
+                {
+                    for (int i = range.Item1; i < range.Item2; i++)
+                        CollideBodies(i);
+                });
+
+                Parallel.ForEach(batches, options, range =>
+                {
+                    ApplyContacts(range.Item1, range.Item2, delta);
+                    physics.MapScene(posX, posY, posZ, world, range.Item1, range.Item2);
+
+                    for (int i = range.Item1; i < range.Item2; i++)
+                        Integrate(i, delta);
+                });
+
+                Publish();
+            }
+            finally
+            {
+                Monitor.Exit(stepSync);
+            }
+        }
+
+        // Broadphase ----------------------------------------------------------------------
+
+        int Bucket(int x, int y, int z)
+        {
+            return ((x * HASH_X) ^ (y * HASH_Y) ^ (z * HASH_Z)) & (buckets.Length - 1);
+        }
+
+        /// <summary>
+        /// Cells of twice the largest radius, overlapping bodies are at most one cell apart
+        /// </summary>
+        void BuildBroadphase()
+        {
+            const float CELL = 2f * Const.BODIES_MAX_RADIUS;
+
+            for (int b = 0; b < buckets.Length; b++)
+                buckets[b] = -1;
+
+            for (int i = 0; i < count; i++)
+            {
+                cellX[i] = (int)Math.Floor(posX[i] / CELL);
+                cellY[i] = (int)Math.Floor(posY[i] / CELL);
+                cellZ[i] = (int)Math.Floor(posZ[i] / CELL);
+
+                int b = Bucket(cellX[i], cellY[i], cellZ[i]);
+                next[i] = buckets[b];
+                buckets[b] = i;
+            }
+        }
+
+        // Narrowphase ----------------------------------------------------------------------
+
+        /// <summary>
+        /// Separation and impulse of body i against its neighbours. Both bodies of a pair
+        /// compute their own half, so no two threads write the same body.
+        /// </summary>
+        void CollideBodies(int i)
+        {
+            float px = 0f, py = 0f, pz = 0f,
+                ix = 0f, iy = 0f, iz = 0f;
+
+            for (int z = cellZ[i] - 1; z <= cellZ[i] + 1; z++)
+                for (int y = cellY[i] - 1; y <= cellY[i] + 1; y++)
+                    for (int x = cellX[i] - 1; x <= cellX[i] + 1; x++)
+                        for (int j = buckets[Bucket(x, y, z)]; j >= 0; j = next[j])
+                        {
+                            // buckets are shared by colliding cells
+                            if (j == i || cellX[j] != x || cellY[j] != y || cellZ[j] != z)
+                                continue;
+
+                            float dx = posX[i] - posX[j],
+                                dy = posY[i] - posY[j],
+                                dz = posZ[i] - posZ[j];
+                            float r = radius[i] + radius[j];
+                            float d2 = dx * dx + dy * dy + dz * dz;
+
+                            if (d2 >= r * r || d2 == 0f)
+                                continue;
+
+                            float d = (float)Math.Sqrt(d2);
+                            dx /= d; dy /= d; dz /= d;
+
+                            float overlap = 0.5f * (r - d);
+                            px += dx * overlap; py += dy * overlap; pz += dz * overlap;
+
+                            // approaching along the normal, equal masses
+                            float vn = (velX[i] - velX[j]) * dx + (velY[i] - velY[j]) * dy + (velZ[i] - velZ[j]) * dz;
+                            if (vn < 0f)
+                            {
+                                float k = -0.5f * (1f + Const.BODIES_RESTITUTION) * vn;
+                                ix += dx * k; iy += dy * k; iz += dz * k;
+                            }
+                        }
+
+            pushX[i] = px; pushY[i] = py; pushZ[i] = pz;
+            impulseX[i] = ix; impulseY[i] = iy; impulseZ[i] = iz;
+        }
+
+        /// <summary>
+        /// Adds the body contacts and gravity to the state of the batch, all body pairs are resolved by now
+        /// </summary>
+        void ApplyContacts(int start, int end, float delta)
+        {
+            int width = Lanes.Count;
+            var gravity = new Lanes(Const.PHYS_GRAVITY * delta);
+            int i = start;
+
+            for (; i + width <= end; i += width)
+            {
+                (new Lanes(posX, i) + new Lanes(pushX, i)).CopyTo(posX, i);
+                (new Lanes(posY, i) + new Lanes(pushY, i)).CopyTo(posY, i);
+                (new Lanes(posZ, i) + new Lanes(pushZ, i)).CopyTo(posZ, i);
+                (new Lanes(velX, i) + new Lanes(impulseX, i)).CopyTo(velX, i);
+                (new Lanes(velY, i) + new Lanes(impulseY, i) - gravity).CopyTo(velY, i);
+                (new Lanes(velZ, i) + new Lanes(impulseZ, i)).CopyTo(velZ, i);
+            }
+
+            for (; i < end; i++)
+            {
+                posX[i] += pushX[i]; posY[i] += pushY[i]; posZ[i] += pushZ[i];
+                velX[i] += impulseX[i]; velY[i] += impulseY[i] - Const.PHYS_GRAVITY * delta; velZ[i] += impulseZ[i];
+            }
+        }
+
+        /// <summary>
+        /// Moves the body against the world: in free flight when the narrowphase distance
+        /// clears the whole motion, swept otherwise. A contact resolves the velocity along its
+        /// normal only and the rest of the motion slides along the surface.
+        /// </summary>
+        void Integrate(int i, float delta)
+        {
+            var position = new Vector3(posX[i], posY[i], posZ[i]);
+            var velocity = new Vector3(velX[i], velY[i], velZ[i]);
+            float r = radius[i];
+
+            // pushed into the world by its neighbours
+            float d = world[i] - r;
+            if (d < 0f)
+                position -= physics.GetSurfaceNormal(position) * d;
+
+            Vector3 motion = velocity * delta;
+
+            if (d > motion.Length + Const.PHYS_SWEEP_CONTACT_DIST)
+                position += motion;
+            else
+            {
+                SweepHit hit = physics.SweepSphere(position, r, motion);
+                position += motion * hit.Time;
+
+                if (hit.Hit)
+                {
+                    float vn = Vector3.Dot(velocity, hit.Normal);
+                    if (vn < 0f)
+                        velocity -= hit.Normal * vn * (1f + Const.BODIES_RESTITUTION);
+
+                    Vector3 rest = motion * (1f - hit.Time);
+                    float rn = Vector3.Dot(rest, hit.Normal);
+                    if (rn < 0f)
+                        rest -= hit.Normal * rn;
+
+                    position += rest * physics.SweepSphere(position, r, rest).Time;
+                }
+            }
+
+            posX[i] = position.X; posY[i] = position.Y; posZ[i] = position.Z;
+            velX[i] = velocity.X; velY[i] = velocity.Y; velZ[i] = velocity.Z;
+        }
+
+        void Publish()
+        {
+            lock (publishSync)
+            {
+                for (int i = 0; i < count; i++)
+                    published[i] = new Vector4(posX[i], posY[i], posZ[i], radius[i]);
+
+                publishedCount = count;
+                Version++;
+            }
+        }
+    }
+}
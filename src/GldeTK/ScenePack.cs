@@ -0,0 +1,259 @@
+﻿using OpenTK;
+using System;
+using System.Collections.Generic;
+using System.IO;
+using System.IO.MemoryMappedFiles;
+using System.Text;
+
+namespace GldeTK
+{
+    public enum ScenePackSection
+    {
+        Elements = 1,   // std140 image of the SdElements block, as SdScene.ToBlock fills it
+        Shader = 2,     // UTF-8 source, named like the embedded shader it replaces
+        Field = 3,      // baked distance grid, FIELD_HEADER_SIZE header then float32 x fastest
+        Metadata = 4    // UTF-8 "key=value" lines
+    }
+
+    /// <summary>
+    /// Read-only scene and asset pack mapped into memory. Sections are used in place: the
+    /// element block is uploaded by the driver straight from the mapping and a field is a
+    /// pointer into it, only the managed copies Physics and the shader compiler need are made.
+    /// Little-endian layout: "GTKP", version, section count, 0 as int32, then per section kind,
+    /// name bytes as int32 and name offset, data offset, data length as int64. The names follow
+    /// the table, every data section starts on SECTION_ALIGNMENT. ScenePackBuilder writes it.
+    /// </summary>
+    public sealed class ScenePack : IDisposable
+    {
+        public const uint MAGIC = 0x504b5447;   // "GTKP"
+        public const int VERSION = 1;
+        public const int HEADER_SIZE = 16;
+        public const int ENTRY_SIZE = 32;
+        public const int SECTION_ALIGNMENT = 64;
+        public const int FIELD_HEADER_SIZE = 32;    // nx, ny, nz, 0 as int32, min xyz, cell as float32
+
+        public struct Section
+        {
+            public ScenePackSection Kind;
+            public string Name;
+            public long Offset;
+            public long Length;
+        }
+
+        /// <summary>
+        /// Distance samples at min + (x, y, z) * Cell, Data points into the mapping
+        /// </summary>
+        public struct Field
+        {
+            public int X, Y, Z;
+            public Vector3 Min;
+            public float Cell;
+            public IntPtr Data;
+
+            public long Count => (long)X * Y * Z;
+        }
+
+        readonly MemoryMappedFile file;
+        readonly MemoryMappedViewAccessor view;
+        readonly IntPtr pointer;
+        bool addedRef;
+
+        public readonly string Path;
+        public readonly Section[] Sections;
+        public readonly Dictionary<string, string> Metadata = new Dictionary<string, string>();
+
+        public long Bytes => view.Capacity;
+
+        ScenePack(string path, MemoryMappedFile file, MemoryMappedViewAccessor view, Section[] sections)
+        {
+            Path = path;
+            this.file = file;
+            this.view = view;
+            Sections = sections;
+
+            view.SafeMemoryMappedViewHandle.DangerousAddRef(ref addedRef);
+            pointer = new IntPtr(view.SafeMemoryMappedViewHandle.DangerousGetHandle().ToInt64() + view.PointerOffset);
+
+            foreach (Section section in sections)
+                if (section.Kind == ScenePackSection.Metadata)
+                    foreach (string line in ReadText(section).Split('\n'))
+                    {
+                        int split = line.IndexOf('=');
+                        if (split > 0)
+                            Metadata[line.Substring(0, split).Trim()] = line.Substring(split + 1).Trim();
+                    }
+        }
+
+        /// <returns>Null when the file is missing, not a pack of this version or its table is damaged</returns>
+        public static ScenePack Open(string path)
+        {
+            var info = new FileInfo(path);
+            if (!info.Exists || info.Length < HEADER_SIZE)
+                return null;
+
+            long size = info.Length;
+
+            // the file may go or be locked between the check above and the mapping
+            MemoryMappedFile file = null;
+            MemoryMappedViewAccessor view;
+            try
+            {
+                file = MemoryMappedFile.CreateFromFile(path, FileMode.Open, null, 0, MemoryMappedFileAccess.Read);
+                view = file.CreateViewAccessor(0, 0, MemoryMappedFileAccess.Read);
+            }
+            catch (IOException)
+            {
+                file?.Dispose();
+                return null;
+            }
+            catch (UnauthorizedAccessException)
+            {
+                file?.Dispose();
+                return null;
+            }
+
+            Section[] sections = ReadTable(view, size);
+            if (sections == null)
+            {
+                view.Dispose();
+                file.Dispose();
+                return null;
+            }
+
+            return new ScenePack(path, file, view, sections);
+        }
+
+        static Section[] ReadTable(MemoryMappedViewAccessor view, long size)
+        {
+            if (view.ReadUInt32(0) != MAGIC || view.ReadInt32(4) != VERSION)
+                return null;
+
+            int count = view.ReadInt32(8);
+            if (count < 0 || HEADER_SIZE + (long)count * ENTRY_SIZE > size)
+                return null;
+
+            var sections = new Section[count];
+            for (int i = 0; i < count; i++)
+            {
+                long entry = HEADER_SIZE + (long)i * ENTRY_SIZE;
+                int nameBytes = view.ReadInt32(entry + 4);
+                long nameOffset = view.ReadInt64(entry + 8);
+
+                sections[i].Kind = (ScenePackSection)view.ReadInt32(entry);
+                sections[i].Offset = view.ReadInt64(entry + 16);
+                sections[i].Length = view.ReadInt64(entry + 24);
+
+                if (nameBytes < 0 || nameOffset < 0 || nameOffset + nameBytes > size
+                    || sections[i].Offset < 0 || sections[i].Length < 0 || sections[i].Offset + sections[i].Length > size)
+                    return null;
+
+                var name = new byte[nameBytes];
+                view.ReadArray(nameOffset, name, 0, nameBytes);
+                sections[i].Name = Encoding.UTF8.GetString(name);
+            }
+
+            return sections;
+        }
+
+        /// <summary>
+        /// Address of the section data in the mapping, valid until Dispose
+        /// </summary>
+        public IntPtr Pointer(Section section) => new IntPtr(pointer.ToInt64() + section.Offset);
+
+        /// <summary>
+        /// First section of the kind, of any name when name is null
+        /// </summary>
+        public bool Find(ScenePackSection kind, string name, out Section section)
+        {
+            foreach (Section candidate in Sections)
+                if (candidate.Kind == kind && (name == null || candidate.Name == name))
+                {
+                    section = candidate;
+                    return true;
+                }
+
+            section = default(Section);
+            return false;
+        }
+
+        string ReadText(Section section)
+        {
+            var bytes = new byte[section.Length];
+            view.ReadArray(section.Offset, bytes, 0, bytes.Length);
+
+            return Encoding.UTF8.GetString(bytes);
+        }
+
+        /// <summary>
+        /// The SdElements block in place, Zero when the pack has none or it does not fit the block
+        /// </summary>
+        public IntPtr GetElementsBlock(out int bytes)
+        {
+            bytes = 0;
+            if (!Find(ScenePackSection.Elements, null, out Section section) || section.Length < SdScene.ELEMENTS_OFFSET * Vector4.SizeInBytes)
+                return IntPtr.Zero;
+
+            int count = (int)view.ReadSingle(section.Offset + Vector4.SizeInBytes);
+            if (count < 0 || count > SdScene.MAX_ELEMENTS || section.Length != (SdScene.ELEMENTS_OFFSET + 2 * count) * Vector4.SizeInBytes)
+                return IntPtr.Zero;
+
+            bytes = (int)section.Length;
+            return Pointer(section);
+        }
+
+        /// <summary>
+        /// Copy of the elements of the block for the CPU side
+        /// </summary>
+        /// <returns>Null when the pack has no valid block</returns>
+        public SdElement[] ReadElements(out Vector4 parameters)
+        {
+            parameters = Vector4.Zero;
+            if (GetElementsBlock(out int bytes) == IntPtr.Zero)
+                return null;
+
+            Find(ScenePackSection.Elements, null, out Section section);
+            var elements = new SdElement[bytes / Vector4.SizeInBytes / 2 - SdScene.ELEMENTS_OFFSET / 2];
+
+            view.Read(section.Offset, out parameters);
+            view.ReadArray(section.Offset + SdScene.ELEMENTS_OFFSET * Vector4.SizeInBytes, elements, 0, elements.Length);
+            return elements;
+        }
+
+        /// <summary>
+        /// Source of a shader by the embedded name without Const.SHADER_RESOURCE_PREFIX, null when not packed
+        /// </summary>
+        public string GetShader(string name)
+        {
+            return Find(ScenePackSection.Shader, name, out Section section) ? ReadText(section) : null;
+        }
+
+        public bool GetField(string name, out Field field)
+        {
+            field = default(Field);
+            if (!Find(ScenePackSection.Field, name, out Section section) || section.Length < FIELD_HEADER_SIZE)
+                return false;
+
+            field.X = view.ReadInt32(section.Offset);
+            field.Y = view.ReadInt32(section.Offset + 4);
+            field.Z = view.ReadInt32(section.Offset + 8);
+            field.Min = new Vector3(view.ReadSingle(section.Offset + 16), view.ReadSingle(section.Offset + 20), view.ReadSingle(section.Offset + 24));
+            field.Cell = view.ReadSingle(section.Offset + 28);
+            field.Data = new IntPtr(Pointer(section).ToInt64() + FIELD_HEADER_SIZE);
+
+            return field.X > 0 && field.Y > 0 && field.Z > 0
+                && FIELD_HEADER_SIZE + field.Count * sizeof(float) == section.Length;
+        }
+
+        public void Dispose()
+        {
+            if (addedRef)
+            {
+                view.SafeMemoryMappedViewHandle.DangerousRelease();
+                addedRef = false;
+            }
+
+            view.Dispose();
+            file.Dispose();
+        }
+    }
+}
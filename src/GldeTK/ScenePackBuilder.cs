@@ -0,0 +1,264 @@
+﻿using OpenTK;
+using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.IO;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Collects the sections of a ScenePack and writes the file. FromText converts a scene
+    /// description, one entry per line, '#' starts a comment:
+    ///   meta key value            parameters x y z w
+    ///   sphere x y z r            box x y z hx hy hz
+    ///   cylinder x y z r h        scatter count [seed]
+    ///   shader name file          field name resolution
+    /// Shader names are the embedded ones without Const.SHADER_RESOURCE_PREFIX, the file is
+    /// relative to the description. A field samples Physics.Map of the scene so far over the
+    /// --mesh cube.
+    /// </summary>
+    public class ScenePackBuilder
+    {
+        class Entry
+        {
+            public ScenePackSection Kind;
+            public string Name;
+            public byte[] Data;
+        }
+
+        readonly List<Entry> entries = new List<Entry>();
+        readonly StringBuilder metadata = new StringBuilder();
+
+        public void AddMetadata(string key, string value)
+        {
+            metadata.Append(key).Append('=').Append(value).Append('\n');
+        }
+
+        /// <summary>
+        /// Same image as SdScene.ToBlock, the elements past SdScene.MAX_ELEMENTS are dropped
+        /// </summary>
+        public void AddElements(Vector4 parameters, IList<SdElement> elements)
+        {
+            var scene = new SdScene { Parameters = parameters };
+            scene.SetElements(elements);
+
+            var block = new Vector4[Const.UBO_SDELEMENTSMAP_BLOCKCOUNT];
+            int count = scene.ToBlock(block);
+
+            var floats = new float[count * 4];
+            for (int i = 0; i < count; i++)
+            {
+                floats[i * 4] = block[i].X;
+                floats[i * 4 + 1] = block[i].Y;
+                floats[i * 4 + 2] = block[i].Z;
+                floats[i * 4 + 3] = block[i].W;
+            }
+
+            var data = new byte[floats.Length * sizeof(float)];
+            Buffer.BlockCopy(floats, 0, data, 0, data.Length);
+
+            entries.Add(new Entry { Kind = ScenePackSection.Elements, Name = "", Data = data });
+        }
+
+        public void AddShader(string name, string source)
+        {
+            entries.Add(new Entry { Kind = ScenePackSection.Shader, Name = name, Data = Encoding.UTF8.GetBytes(source) });
+        }
+
+        /// <param name="samples">x * y * z distances, x fastest</param>
+        public void AddField(string name, int x, int y, int z, Vector3 min, float cell, float[] samples)
+        {
+            var data = new byte[ScenePack.FIELD_HEADER_SIZE + samples.Length * sizeof(float)];
+            var header = new[] { x, y, z, 0 };
+            var bounds = new[] { min.X, min.Y, min.Z, cell };
+
+            Buffer.BlockCopy(header, 0, data, 0, 16);
+            Buffer.BlockCopy(bounds, 0, data, 16, 16);
+            Buffer.BlockCopy(samples, 0, data, ScenePack.FIELD_HEADER_SIZE, samples.Length * sizeof(float));
+
+            entries.Add(new Entry { Kind = ScenePackSection.Field, Name = name, Data = data });
+        }
+
+        /// <summary>
+        /// Cube of resolution^3 samples of the field from min, size wide
+        /// </summary>
+        public void BakeField(string name, Func<Vector3, float> field, Vector3 min, float size, int resolution)
+        {
+            float cell = size / Math.Max(resolution - 1, 1);
+            var samples = new float[(long)resolution * resolution * resolution];
+
+            Parallel.For(0, resolution, z =>
+            {
+                for (int y = 0; y < resolution; y++)
+                    for (int x = 0; x < resolution; x++)
+                        samples[((long)z * resolution + y) * resolution + x] = field(min + new Vector3(x, y, z) * cell);
+            });
+
+            AddField(name, resolution, resolution, resolution, min, cell, samples);
+        }
+
+        static long Align(long offset) =>
+            (offset + ScenePack.SECTION_ALIGNMENT - 1) / ScenePack.SECTION_ALIGNMENT * ScenePack.SECTION_ALIGNMENT;
+
+        /// <returns>Size of the file in bytes</returns>
+        public long Save(string path)
+        {
+            var all = new List<Entry>(entries);
+            if (metadata.Length > 0)
+                all.Add(new Entry { Kind = ScenePackSection.Metadata, Name = "", Data = Encoding.UTF8.GetBytes(metadata.ToString()) });
+
+            var names = new byte[all.Count][];
+            long offset = ScenePack.HEADER_SIZE + all.Count * ScenePack.ENTRY_SIZE;
+            var nameOffsets = new long[all.Count];
+
+            for (int i = 0; i < all.Count; i++)
+            {
+                names[i] = Encoding.UTF8.GetBytes(all[i].Name);
+                nameOffsets[i] = offset;
+                offset += names[i].Length;
+            }
+
+            var dataOffsets = new long[all.Count];
+            for (int i = 0; i < all.Count; i++)
+            {
+                dataOffsets[i] = Align(offset);
+                offset = dataOffsets[i] + all[i].Data.Length;
+            }
+
+            using (var writer = new BinaryWriter(new BufferedStream(File.Create(path), 1 << 16)))
+            {
+                writer.Write(ScenePack.MAGIC);
+                writer.Write(ScenePack.VERSION);
+                writer.Write(all.Count);
+                writer.Write(0);
+
+                for (int i = 0; i < all.Count; i++)
+                {
+                    writer.Write((int)all[i].Kind);
+                    writer.Write(names[i].Length);
+                    writer.Write(nameOffsets[i]);
+                    writer.Write(dataOffsets[i]);
+                    writer.Write((long)all[i].Data.Length);
+                }
+
+                foreach (byte[] name in names)
+                    writer.Write(name);
+
+                for (int i = 0; i < all.Count; i++)
+                {
+                    // the gap up to the aligned offset reads as zeros
+                    writer.Seek((int)(dataOffsets[i] - writer.BaseStream.Position), SeekOrigin.Current);
+                    writer.Write(all[i].Data);
+                }
+            }
+
+            return offset;
+        }
+
+        // Text ----------------------------------------------------------------------
+
+        static float[] Numbers(string[] words, int first, int count)
+        {
+            if (words.Length < first + count)
+                return null;
+
+            var numbers = new float[count];
+            for (int i = 0; i < count; i++)
+                if (!float.TryParse(words[first + i], NumberStyles.Float, CultureInfo.InvariantCulture, out numbers[i]))
+                    return null;
+
+            return numbers;
+        }
+
+        /// <returns>Null when a line is not understood, the line is reported to log</returns>
+        public static ScenePackBuilder FromText(string path, TextWriter log)
+        {
+            var builder = new ScenePackBuilder();
+            var scene = new SdScene();
+            var elements = new List<SdElement>();
+            string directory = Path.GetDirectoryName(Path.GetFullPath(path));
+            int number = 0;
+
+            foreach (string raw in File.ReadAllLines(path))
+            {
+                number++;
+                int comment = raw.IndexOf('#');
+                string line = (comment >= 0 ? raw.Substring(0, comment) : raw).Trim();
+                if (line.Length == 0)
+                    continue;
+
+                string[] words = line.Split((char[])null, StringSplitOptions.RemoveEmptyEntries);
+                float[] n = null;
+                bool ok = true;
+
+                switch (words[0])
+                {
+                    case "meta":
+                        ok = words.Length > 2;
+                        if (ok)
+                            builder.AddMetadata(words[1], string.Join(" ", words, 2, words.Length - 2));
+                        break;
+                    case "parameters":
+                        ok = (n = Numbers(words, 1, 4)) != null;
+                        if (ok)
+                            scene.Parameters = new Vector4(n[0], n[1], n[2], n[3]);
+                        break;
+                    case "sphere":
+                        ok = (n = Numbers(words, 1, 4)) != null;
+                        if (ok)
+                            elements.Add(new SdElement(SdElementType.Sphere, new Vector3(n[0], n[1], n[2]), new Vector3(n[3])));
+                        break;
+                    case "box":
+                        ok = (n = Numbers(words, 1, 6)) != null;
+                        if (ok)
+                            elements.Add(new SdElement(SdElementType.Box, new Vector3(n[0], n[1], n[2]), new Vector3(n[3], n[4], n[5])));
+                        break;
+                    case "cylinder":
+                        ok = (n = Numbers(words, 1, 5)) != null;
+                        if (ok)
+                            elements.Add(new SdElement(SdElementType.Cylinder, new Vector3(n[0], n[1], n[2]), new Vector3(n[3], n[4], n[3])));
+                        break;
+                    case "scatter":
+                        int seed = 1;
+                        if (words.Length > 1 && int.TryParse(words[1], out int count) && (words.Length < 3 || int.TryParse(words[2], out seed)))
+                            elements.AddRange(SdScene.Scatter(count, Vector3.Zero, Const.SCENE_FIELD_EXTENT, seed));
+                        else
+                            ok = false;
+                        break;
+                    case "shader":
+                        string file = words.Length > 2 ? Path.Combine(directory, words[2]) : null;
+                        ok = file != null && File.Exists(file);
+                        if (ok)
+                            builder.AddShader(words[1], File.ReadAllText(file));
+                        break;
+                    case "field":
+                        if (words.Length > 2 && int.TryParse(words[2], out int resolution) && resolution > 1)
+                        {
+                            scene.SetElements(elements);
+                            builder.BakeField(words[1], new Physics(scene).Map, Const.MESH_ORIGIN, Const.MESH_SIZE, resolution);
+                        }
+                        else
+                            ok = false;
+                        break;
+                    default:
+                        ok = false;
+                        break;
+                }
+
+                if (!ok)
+                {
+                    log.WriteLine($"{path}({number}): {line}");
+                    return null;
+                }
+            }
+
+            if (elements.Count > SdScene.MAX_ELEMENTS)
+                log.WriteLine($"{path}: {elements.Count} elements, the first {SdScene.MAX_ELEMENTS} are kept");
+
+            builder.AddElements(scene.Parameters, elements);
+            return builder;
+        }
+    }
+}
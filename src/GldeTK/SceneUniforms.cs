@@ -0,0 +1,67 @@
+﻿using OpenTK.Graphics.OpenGL4;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Uniforms of scene.c, every program including the scene sets them the same way.
+    /// The per-frame values come from the FrameParams block Render uploads once per frame.
+    /// </summary>
+    public class SceneUniforms
+    {
+        int uf_iResolution,
+            uf_TileBinning,
+            uf_TileLists,
+            uf_TileCulling,
+            uf_TileRanges,
+            uf_RasterElements,
+            uf_Bodies,
+            uf_BodyGridCells,
+            uf_ShadowMap,
+            uf_AoCache,
+            uf_SculptAtlas,
+            uf_SculptMap;
+
+        public SceneUniforms(int h_program)
+        {
+            int block_index = GL.GetUniformBlockIndex(h_program, Const.UBO_FRAMEPARAMS_BLOCKNAME);
+            GL.UniformBlockBinding(h_program, block_index, Const.UBO_FRAMEPARAMS_BINDING);
+
+            uf_iResolution = GL.GetUniformLocation(h_program, Const.UF_RESOLUTION);
+            uf_TileBinning = GL.GetUniformLocation(h_program, Const.UF_TILE_BINNING);
+            uf_TileLists = GL.GetUniformLocation(h_program, Const.UF_TILE_LISTS);
+            uf_TileCulling = GL.GetUniformLocation(h_program, Const.UF_TILE_CULLING);
+            uf_TileRanges = GL.GetUniformLocation(h_program, Const.UF_TILE_RANGES);
+            uf_RasterElements = GL.GetUniformLocation(h_program, Const.UF_RASTER_ELEMENTS);
+            uf_Bodies = GL.GetUniformLocation(h_program, Const.UF_BODIES);
+            uf_BodyGridCells = GL.GetUniformLocation(h_program, Const.UF_BODY_GRID_CELLS);
+            uf_ShadowMap = GL.GetUniformLocation(h_program, Const.UF_SHADOW_MAP);
+            uf_AoCache = GL.GetUniformLocation(h_program, Const.UF_AO_CACHE);
+            uf_SculptAtlas = GL.GetUniformLocation(h_program, Const.UF_SCULPT_ATLAS);
+            uf_SculptMap = GL.GetUniformLocation(h_program, Const.UF_SCULPT_MAP);
+        }
+
+        /// <summary>
+        /// Program must be in use
+        /// </summary>
+        /// <param name="tileBinning">Read elements from the tile lists of TileBinner</param>
+        /// <param name="tileCulling">March primary rays within the tile ranges of TileCuller</param>
+        /// <param name="rasterElements">Primary rays skip the elements, MeshPass draws them</param>
+        public void Set(FrameState frame, bool tileBinning = false, bool tileCulling = false, bool rasterElements = false)
+        {
+            GL.Uniform3(uf_iResolution, frame.Width, frame.Height, 0.0f);
+
+            // samplers of different types must not share a unit even when unused
+            GL.Uniform1(uf_TileLists, Const.TILE_LISTS_TEXTURE_UNIT);
+            GL.Uniform1(uf_TileRanges, Const.TILE_RANGES_TEXTURE_UNIT);
+            GL.Uniform1(uf_Bodies, Const.BODIES_TEXTURE_UNIT);
+            GL.Uniform1(uf_BodyGridCells, Const.BODY_GRID_TEXTURE_UNIT);
+            GL.Uniform1(uf_ShadowMap, Const.SHADOW_MAP_TEXTURE_UNIT);
+            GL.Uniform1(uf_AoCache, Const.AO_CACHE_TEXTURE_UNIT);
+            GL.Uniform1(uf_SculptAtlas, Const.SCULPT_ATLAS_TEXTURE_UNIT);
+            GL.Uniform1(uf_SculptMap, Const.SCULPT_MAP_TEXTURE_UNIT);
+            GL.Uniform1(uf_TileBinning, tileBinning ? 1 : 0);
+            GL.Uniform1(uf_TileCulling, tileCulling ? 1 : 0);
+            GL.Uniform1(uf_RasterElements, rasterElements ? 1 : 0);
+        }
+    }
+}
@@ -0,0 +1,369 @@
+﻿using OpenTK;
+using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace GldeTK
+{
+    public enum SculptOp
+    {
+        Union = 0,
+        Subtract = 1,
+        SmoothUnion = 2,
+        SmoothSubtract = 3
+    }
+
+    /// <summary>
+    /// One entry of the edit log, a primitive combined with the field so far
+    /// </summary>
+    public struct SculptEdit
+    {
+        public SculptOp Op;
+        public SdElement Shape;
+        public float Smoothing;     // m, blend of the smooth operations
+
+        public SculptEdit(SculptOp op, SdElement shape, float smoothing = 0f)
+        {
+            Op = op;
+            Shape = shape;
+            Smoothing = smoothing;
+        }
+
+        /// <summary>
+        /// Distance from the shape within which the edit changes the field
+        /// </summary>
+        public float Reach => Shape.BoundRadius + Smoothing;
+
+        /// <summary>
+        /// The shape is evaluated only where its bounding sphere can change d
+        /// </summary>
+        public float Apply(float d, Vector3 p)
+        {
+            bool subtract = Op == SculptOp.Subtract || Op == SculptOp.SmoothSubtract;
+            float r = Op == SculptOp.SmoothUnion || Op == SculptOp.SmoothSubtract ? Smoothing : 0f;
+            float bound = Shape.BoundDistance(p);
+
+            if (subtract ? SdOperators.DifferenceFar(d, bound, r) : SdOperators.UnionFar(d, bound, r))
+                return d;
+
+            float e = Shape.Distance(p);
+            return subtract
+                ? SdOperators.Difference(SdBlend.Smooth, d, e, r)
+                : SdOperators.Union(SdBlend.Smooth, d, e, r);
+        }
+    }
+
+    /// <summary>
+    /// Brick baked on a worker, waiting for the render thread
+    /// </summary>
+    public struct SculptUpload
+    {
+        public int Slot;
+        public int Brick;
+        public int Version;
+        public float[] Samples;
+    }
+
+    /// <summary>
+    /// Ground plane edited at runtime by a log of SculptEdits, baked into a sparse pool of bricks.
+    /// The grid of Const.SCULPT_BRICKS_* bricks from Const.SCULPT_ORIGIN gets a pool slot only
+    /// for the bricks within Const.SCULPT_MARGIN of the reach of an edit, a slot keeps the field
+    /// at the 9x9x9 corners of its cells. An edit marks its bricks dirty, they alone are baked
+    /// again on the thread pool from the edits listed in them, and go to the GPU one brick at a
+    /// time (SculptBricks). Physics samples the same baked bricks. Bricks hold no edit farther than
+    /// the margin, so out of them and in them the field is at most the margin, a lower bound. The
+    /// pool is never evicted, edits past its end are left out of the bricks they no longer fit.
+    /// </summary>
+    public class Sculpt
+    {
+        const int SAMPLES = Const.SCULPT_BRICK_CELLS + 1;
+        const int BRICK_SAMPLES = SAMPLES * SAMPLES * SAMPLES;
+        const float BRICK_SIZE = Const.SCULPT_BRICK_CELLS * Const.SCULPT_CELL;
+        const int BRICKS = Const.SCULPT_BRICKS_X * Const.SCULPT_BRICKS_Y * Const.SCULPT_BRICKS_Z;
+
+        public const int BRICK_BYTES = BRICK_SAMPLES * sizeof(float);
+
+        /// <summary>
+        /// Edit waiting for the upload of all its bricks
+        /// </summary>
+        class Pending
+        {
+            public int Version;
+            public long Timestamp;
+            public int[] Slots;
+        }
+
+        readonly object sync = new object();
+
+        readonly List<SculptEdit> edits = new List<SculptEdit>();
+        readonly int[] brickSlot = new int[BRICKS];
+
+        // per slot: its brick, the edits reaching it, versions of the edit log
+        readonly int[] slotBrick = new int[Const.SCULPT_POOL_BRICKS];
+        readonly List<int>[] slotEdits = new List<int>[Const.SCULPT_POOL_BRICKS];
+        readonly int[] slotVersion = new int[Const.SCULPT_POOL_BRICKS];
+        readonly int[] baking = new int[Const.SCULPT_POOL_BRICKS];
+        readonly int[] uploaded = new int[Const.SCULPT_POOL_BRICKS];
+        int slots;
+
+        // read without the lock: replaced as a whole, null until the first bake
+        readonly float[][] published = new float[Const.SCULPT_POOL_BRICKS][];
+        int[] bounds;   // lowest and highest brick of the published ones
+
+        readonly List<Pending> pending = new List<Pending>();
+        readonly ConcurrentQueue<SculptUpload> uploads = new ConcurrentQueue<SculptUpload>();
+        int inFlight;
+
+        // read by the render thread without the lock
+        volatile int version;
+
+        public Sculpt()
+        {
+            for (int i = 0; i < BRICKS; i++)
+                brickSlot[i] = -1;
+        }
+
+        public int EditCount => edits.Count;
+
+        /// <summary>
+        /// Increments once per edit, when the last of its bricks is on the GPU. The caches
+        /// of the ground (AoCache, ShadowMap) start over when it differs.
+        /// </summary>
+        public int Version => version;
+
+        public int BrickCount => slots;
+
+        /// <summary>
+        /// Bricks being baked on the workers
+        /// </summary>
+        public int Baking => inFlight;
+
+        static Vector3 BrickMin(int brick)
+        {
+            int x = brick % Const.SCULPT_BRICKS_X,
+                y = brick / Const.SCULPT_BRICKS_X % Const.SCULPT_BRICKS_Y,
+                z = brick / (Const.SCULPT_BRICKS_X * Const.SCULPT_BRICKS_Y);
+
+            return Const.SCULPT_ORIGIN + new Vector3(x, y, z) * BRICK_SIZE;
+        }
+
+        /// <summary>
+        /// Appends the edit, lists it in the bricks it reaches and bakes them again
+        /// </summary>
+        public void Add(SculptEdit edit)
+        {
+            lock (sync)
+            {
+                int index = edits.Count;
+                edits.Add(edit);
+
+                float reach = edit.Reach + Const.SCULPT_MARGIN;
+                Vector3 center = edit.Shape.Position;
+                Vector3 lo = (center - new Vector3(reach) - Const.SCULPT_ORIGIN) / BRICK_SIZE,
+                    hi = (center + new Vector3(reach) - Const.SCULPT_ORIGIN) / BRICK_SIZE;
+
+                int x0 = Math.Max((int)Math.Floor(lo.X), 0), x1 = Math.Min((int)Math.Floor(hi.X), Const.SCULPT_BRICKS_X - 1),
+                    y0 = Math.Max((int)Math.Floor(lo.Y), 0), y1 = Math.Min((int)Math.Floor(hi.Y), Const.SCULPT_BRICKS_Y - 1),
+                    z0 = Math.Max((int)Math.Floor(lo.Z), 0), z1 = Math.Min((int)Math.Floor(hi.Z), Const.SCULPT_BRICKS_Z - 1);
+
+                var touched = new List<int>();
+                for (int z = z0; z <= z1; z++)
+                    for (int y = y0; y <= y1; y++)
+                        for (int x = x0; x <= x1; x++)
+                        {
+                            int brick = (z * Const.SCULPT_BRICKS_Y + y) * Const.SCULPT_BRICKS_X + x;
+
+                            // bounding sphere against the brick
+                            Vector3 min = BrickMin(brick);
+                            Vector3 q = center - Vector3.ComponentMax(min, Vector3.ComponentMin(min + new Vector3(BRICK_SIZE), center));
+                            if (q.LengthSquared > reach * reach)
+                                continue;
+
+                            int slot = brickSlot[brick];
+                            if (slot < 0)
+                            {
+                                if (slots == Const.SCULPT_POOL_BRICKS)
+                                {
+                                    Profiler.Count(Const.PROFILER_SCULPT_DROPPED);
+                                    continue;
+                                }
+
+                                slot = slots++;
+                                slotBrick[slot] = brick;
+                                slotEdits[slot] = new List<int>();
+                                brickSlot[brick] = slot;
+                            }
+
+                            slotEdits[slot].Add(index);
+                            slotVersion[slot] = index + 1;
+                            touched.Add(slot);
+                            Schedule(slot);
+                        }
+
+                pending.Add(new Pending { Version = index + 1, Timestamp = Stopwatch.GetTimestamp(), Slots = touched.ToArray() });
+            }
+        }
+
+        /// <summary>
+        /// Starts a bake of the slot unless one is running, its end starts the next when needed
+        /// </summary>
+        void Schedule(int slot)
+        {
+            if (baking[slot] != 0)
+                return;
+
+            int version = slotVersion[slot];
+            baking[slot] = version;
+            Interlocked.Increment(ref inFlight);
+
+            List<int> listed = slotEdits[slot];
+            var brickEdits = new SculptEdit[listed.Count];
+            for (int i = 0; i < brickEdits.Length; i++)
+                brickEdits[i] = edits[listed[i]];
+
+            int brick = slotBrick[slot];
+            Task.Run(() => Bake(slot, brick, version, brickEdits));
+        }
+
+        void Bake(int slot, int brick, int version, SculptEdit[] brickEdits)
+        {
+            var samples = new float[BRICK_SAMPLES];
+            Vector3 min = BrickMin(brick);
+            int i = 0;
+
+            for (int z = 0; z < SAMPLES; z++)
+                for (int y = 0; y < SAMPLES; y++)
+                    for (int x = 0; x < SAMPLES; x++)
+                    {
+                        float d = Evaluate(brickEdits, min + new Vector3(x, y, z) * Const.SCULPT_CELL);
+                        samples[i++] = Math.Min(d, Const.SCULPT_MARGIN);
+                    }
+
+            lock (sync)
+            {
+                published[slot] = samples;
+                Publish(brick);
+                uploads.Enqueue(new SculptUpload { Slot = slot, Brick = brick, Version = version, Samples = samples });
+
+                baking[slot] = 0;
+                Interlocked.Decrement(ref inFlight);
+                if (slotVersion[slot] != version)
+                    Schedule(slot);
+            }
+
+            Profiler.Count(Const.PROFILER_SCULPT_BAKES);
+        }
+
+        void Publish(int brick)
+        {
+            int x = brick % Const.SCULPT_BRICKS_X,
+                y = brick / Const.SCULPT_BRICKS_X % Const.SCULPT_BRICKS_Y,
+                z = brick / (Const.SCULPT_BRICKS_X * Const.SCULPT_BRICKS_Y);
+
+            int[] current = bounds;
+            bounds = current == null
+                ? new[] { x, y, z, x, y, z }
+                : new[] {
+                    Math.Min(current[0], x), Math.Min(current[1], y), Math.Min(current[2], z),
+                    Math.Max(current[3], x), Math.Max(current[4], y), Math.Max(current[5], z) };
+        }
+
+        /// <summary>
+        /// Next baked brick for the GPU, called by the render thread
+        /// </summary>
+        internal bool TryTakeUpload(out SculptUpload upload) => uploads.TryDequeue(out upload);
+
+        /// <summary>
+        /// The brick is on the GPU, an edit with all its bricks there counts as visible
+        /// </summary>
+        internal void OnUploaded(int slot, int version)
+        {
+            lock (sync)
+            {
+                uploaded[slot] = Math.Max(uploaded[slot], version);
+
+                long now = Stopwatch.GetTimestamp();
+                pending.RemoveAll(edit =>
+                {
+                    foreach (int s in edit.Slots)
+                        if (uploaded[s] < edit.Version)
+                            return false;
+
+                    Profiler.Count(Const.PROFILER_SCULPT_VISIBLE);
+                    Profiler.Count(Const.PROFILER_SCULPT_LATENCY_US, (now - edit.Timestamp) * 1000000 / Stopwatch.Frequency);
+                    version++;
+                    return true;
+                });
+            }
+        }
+
+        /// <summary>
+        /// Field of the edited ground, the baked bricks where there are any, same as mapSculpt() of scene.c
+        /// </summary>
+        public float Distance(Vector3 p)
+        {
+            float d = Physics.SdPlaneY(p);
+
+            int[] b = bounds;
+            if (b == null)
+                return d;
+
+            // out of the published bricks by a, the edits are the margin farther
+            Vector3 lo = Const.SCULPT_ORIGIN + new Vector3(b[0], b[1], b[2]) * BRICK_SIZE,
+                hi = Const.SCULPT_ORIGIN + new Vector3(b[3] + 1, b[4] + 1, b[5] + 1) * BRICK_SIZE;
+            float a = Physics.SdBox(p - (lo + hi) * 0.5f, (hi - lo) * 0.5f);
+            if (a > 0f)
+                return Math.Min(d, a + Const.SCULPT_MARGIN);
+
+            Vector3 g = (p - Const.SCULPT_ORIGIN) / BRICK_SIZE;
+            int x = Math.Min((int)g.X, Const.SCULPT_BRICKS_X - 1),
+                y = Math.Min((int)g.Y, Const.SCULPT_BRICKS_Y - 1),
+                z = Math.Min((int)g.Z, Const.SCULPT_BRICKS_Z - 1);
+
+            int slot = brickSlot[(z * Const.SCULPT_BRICKS_Y + y) * Const.SCULPT_BRICKS_X + x];
+            float[] samples = slot >= 0 ? published[slot] : null;
+            if (samples == null)
+                return Math.Min(d, Const.SCULPT_MARGIN);
+
+            // trilinear, as the texture unit filters the atlas
+            Vector3 c = (g - new Vector3(x, y, z)) * Const.SCULPT_BRICK_CELLS;
+            int cx = Math.Min((int)c.X, Const.SCULPT_BRICK_CELLS - 1),
+                cy = Math.Min((int)c.Y, Const.SCULPT_BRICK_CELLS - 1),
+                cz = Math.Min((int)c.Z, Const.SCULPT_BRICK_CELLS - 1);
+            float fx = c.X - cx, fy = c.Y - cy, fz = c.Z - cz;
+
+            int i = (cz * SAMPLES + cy) * SAMPLES + cx;
+            float x00 = samples[i] + (samples[i + 1] - samples[i]) * fx,
+                x10 = samples[i + SAMPLES] + (samples[i + SAMPLES + 1] - samples[i + SAMPLES]) * fx;
+            i += SAMPLES * SAMPLES;
+            float x01 = samples[i] + (samples[i + 1] - samples[i]) * fx,
+                x11 = samples[i + SAMPLES] + (samples[i + SAMPLES + 1] - samples[i + SAMPLES]) * fx;
+
+            float y0 = x00 + (x10 - x00) * fy,
+                y1 = x01 + (x11 - x01) * fy;
+
+            return y0 + (y1 - y0) * fz;
+        }
+
+        public SculptEdit[] CopyEdits()
+        {
+            lock (sync)
+                return edits.ToArray();
+        }
+
+        /// <summary>
+        /// Ground plane and the edits at p, the field the bricks sample
+        /// </summary>
+        public static float Evaluate(IList<SculptEdit> log, Vector3 p)
+        {
+            float d = Physics.SdPlaneY(p);
+            for (int i = 0; i < log.Count; i++)
+                d = log[i].Apply(d, p);
+
+            return d;
+        }
+    }
+}
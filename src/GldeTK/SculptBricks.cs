@@ -0,0 +1,151 @@
+﻿using OpenTK;
+using OpenTK.Graphics.OpenGL4;
+using System;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// GPU copy of the Sculpt brick pool for mapSculpt() of scene.c: an atlas of
+    /// Const.SCULPT_ATLAS_BRICKS^3 bricks of 9x9x9 float samples, filtered by the texture unit,
+    /// and a map of the brick grid holding the slot + 1 of every brick, 0 - none. Every frame the
+    /// bricks baked since the last one go up as sub-images of their own, a new brick also
+    /// writes its single texel of the map. The bounds of the uploaded bricks and the version
+    /// of the edits complete on the GPU go to the frame.
+    /// </summary>
+    public class SculptBricks
+    {
+        const int SAMPLES = Const.SCULPT_BRICK_CELLS + 1;
+        const int ATLAS_SIZE = Const.SCULPT_ATLAS_BRICKS * SAMPLES;
+
+        readonly Sculpt sculpt;
+
+        int tex_atlas,
+            tex_map;
+
+        bool[] mapped = new bool[Const.SCULPT_BRICKS_X * Const.SCULPT_BRICKS_Y * Const.SCULPT_BRICKS_Z];
+        ushort[] mapTexel = new ushort[1];
+        Vector3 lo,
+            hi;
+        bool any;
+
+        public bool IsStarted => tex_atlas != 0;
+
+        public SculptBricks(Sculpt sculpt)
+        {
+            this.sculpt = sculpt;
+        }
+
+        public void Start()
+        {
+            // only mapped bricks are ever read, the atlas starts undefined
+            tex_atlas = GL.GenTexture();
+            GL.BindTexture(TextureTarget.Texture3D, tex_atlas);
+            GL.TexImage3D(
+                TextureTarget.Texture3D, 0,
+                PixelInternalFormat.R32f,
+                ATLAS_SIZE, ATLAS_SIZE, ATLAS_SIZE, 0,
+                PixelFormat.Red, PixelType.Float,
+                IntPtr.Zero);
+            GL.TexParameter(TextureTarget.Texture3D, TextureParameterName.TextureMinFilter, (int)TextureMinFilter.Linear);
+            GL.TexParameter(TextureTarget.Texture3D, TextureParameterName.TextureMagFilter, (int)TextureMagFilter.Linear);
+            GL.TexParameter(TextureTarget.Texture3D, TextureParameterName.TextureWrapS, (int)TextureWrapMode.ClampToEdge);
+            GL.TexParameter(TextureTarget.Texture3D, TextureParameterName.TextureWrapT, (int)TextureWrapMode.ClampToEdge);
+            GL.TexParameter(TextureTarget.Texture3D, TextureParameterName.TextureWrapR, (int)TextureWrapMode.ClampToEdge);
+
+            tex_map = GL.GenTexture();
+            GL.BindTexture(TextureTarget.Texture3D, tex_map);
+            GL.TexImage3D(
+                TextureTarget.Texture3D, 0,
+                PixelInternalFormat.R16ui,
+                Const.SCULPT_BRICKS_X, Const.SCULPT_BRICKS_Y, Const.SCULPT_BRICKS_Z, 0,
+                PixelFormat.RedInteger, PixelType.UnsignedShort,
+                new ushort[mapped.Length]);
+
+            // integer textures are incomplete with linear filters
+            GL.TexParameter(TextureTarget.Texture3D, TextureParameterName.TextureMinFilter, (int)TextureMinFilter.Nearest);
+            GL.TexParameter(TextureTarget.Texture3D, TextureParameterName.TextureMagFilter, (int)TextureMagFilter.Nearest);
+            GL.BindTexture(TextureTarget.Texture3D, 0);
+        }
+
+        /// <summary>
+        /// Uploads the bricks baked since the last frame, sets the sculpt fields of the frame
+        /// and binds the textures to their units
+        /// </summary>
+        internal void OnFrame(ref FrameState frame)
+        {
+            if (!IsStarted)
+                return;
+
+            long bytes = 0;
+
+            while (sculpt.TryTakeUpload(out SculptUpload upload))
+            {
+                int slot = upload.Slot;
+                int ax = slot % Const.SCULPT_ATLAS_BRICKS,
+                    ay = slot / Const.SCULPT_ATLAS_BRICKS % Const.SCULPT_ATLAS_BRICKS,
+                    az = slot / (Const.SCULPT_ATLAS_BRICKS * Const.SCULPT_ATLAS_BRICKS);
+
+                GL.BindTexture(TextureTarget.Texture3D, tex_atlas);
+                GL.TexSubImage3D(
+                    TextureTarget.Texture3D, 0,
+                    ax * SAMPLES, ay * SAMPLES, az * SAMPLES,
+                    SAMPLES, SAMPLES, SAMPLES,
+                    PixelFormat.Red, PixelType.Float,
+                    upload.Samples);
+                bytes += Sculpt.BRICK_BYTES;
+
+                int brick = upload.Brick;
+                if (!mapped[brick])
+                {
+                    mapped[brick] = true;
+
+                    int x = brick % Const.SCULPT_BRICKS_X,
+                        y = brick / Const.SCULPT_BRICKS_X % Const.SCULPT_BRICKS_Y,
+                        z = brick / (Const.SCULPT_BRICKS_X * Const.SCULPT_BRICKS_Y);
+
+                    mapTexel[0] = (ushort)(slot + 1);
+                    GL.BindTexture(TextureTarget.Texture3D, tex_map);
+                    GL.TexSubImage3D(
+                        TextureTarget.Texture3D, 0,
+                        x, y, z, 1, 1, 1,
+                        PixelFormat.RedInteger, PixelType.UnsignedShort,
+                        mapTexel);
+                    bytes += sizeof(ushort);
+
+                    var brickLo = new Vector3(x, y, z);
+                    lo = any ? Vector3.ComponentMin(lo, brickLo) : brickLo;
+                    hi = any ? Vector3.ComponentMax(hi, brickLo + Vector3.One) : brickLo + Vector3.One;
+                    any = true;
+                }
+
+                sculpt.OnUploaded(slot, upload.Version);
+            }
+
+            GL.BindTexture(TextureTarget.Texture3D, 0);
+
+            if (bytes > 0)
+                Profiler.Count(Const.PROFILER_SCULPT_UPLOAD_BYTES, bytes);
+
+            float brickSize = Const.SCULPT_BRICK_CELLS * Const.SCULPT_CELL;
+            frame.SculptLo = any ? new Vector4(Const.SCULPT_ORIGIN + lo * brickSize, 1f) : Vector4.Zero;
+            frame.SculptHi = any ? new Vector4(Const.SCULPT_ORIGIN + hi * brickSize, 0f) : Vector4.Zero;
+            frame.SculptVersion = sculpt.Version;
+
+            GL.ActiveTexture(TextureUnit.Texture0 + Const.SCULPT_ATLAS_TEXTURE_UNIT);
+            GL.BindTexture(TextureTarget.Texture3D, tex_atlas);
+            GL.ActiveTexture(TextureUnit.Texture0 + Const.SCULPT_MAP_TEXTURE_UNIT);
+            GL.BindTexture(TextureTarget.Texture3D, tex_map);
+            GL.ActiveTexture(TextureUnit.Texture0);
+        }
+
+        internal void Stop()
+        {
+            if (!IsStarted)
+                return;
+
+            GL.DeleteTexture(tex_atlas);
+            GL.DeleteTexture(tex_map);
+            tex_atlas = 0;
+        }
+    }
+}
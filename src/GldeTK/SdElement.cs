@@ -0,0 +1,78 @@
+﻿using OpenTK;
+using System.Runtime.InteropServices;
+
+namespace GldeTK
+{
+    public enum SdElementType
+    {
+        Sphere = 0,
+        Box = 1,
+        Cylinder = 2
+    }
+
+    /// <summary>
+    /// One primitive of the SdElements block, two std140 vec4:
+    /// position + type, size + bounding sphere radius
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct SdElement
+    {
+        public Vector4 PositionType;
+        public Vector4 SizeBound;
+
+        /// <param name="size">Sphere: radius; Box: half size; Cylinder: radius, half height</param>
+        public SdElement(SdElementType type, Vector3 position, Vector3 size)
+        {
+            PositionType = new Vector4(position, (float)type);
+            SizeBound = new Vector4(size, GetBoundRadius(type, size));
+        }
+
+        public SdElementType Type => (SdElementType)(int)PositionType.W;
+        public Vector3 Position => PositionType.Xyz;
+        public Vector3 Size => SizeBound.Xyz;
+        public float BoundRadius => SizeBound.W;
+
+        public static float GetBoundRadius(SdElementType type, Vector3 size)
+        {
+            switch (type)
+            {
+                case SdElementType.Sphere:
+                    return size.X;
+                case SdElementType.Box:
+                    return size.Length;
+                default:
+                    return size.Xy.Length;
+            }
+        }
+
+        /// <summary>
+        /// Same as sdElement() of scene.c
+        /// </summary>
+        public float Distance(Vector3 p)
+        {
+            Vector3 q = p - Position;
+
+            switch (Type)
+            {
+                case SdElementType.Sphere:
+                    return Physics.SdSphere(q, SizeBound.X);
+                case SdElementType.Box:
+                    return Physics.SdBox(q, Size);
+                default:
+                    return Physics.SdCylinder(q, SizeBound.X, SizeBound.Y);
+            }
+        }
+
+        /// <summary>
+        /// Distance to the bounding sphere, never more than Distance, inside too. The
+        /// cylinder field is the larger of its radial and axial distances, down to 1/sqrt(2)
+        /// of the true one off its rims.
+        /// </summary>
+        public float BoundDistance(Vector3 p)
+        {
+            float d = (p - Position).Length - BoundRadius;
+
+            return Type == SdElementType.Cylinder && d > 0f ? d * 0.70710678f : d;
+        }
+    }
+}
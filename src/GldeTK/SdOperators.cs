@@ -0,0 +1,89 @@
+﻿using System;
+
+namespace GldeTK
+{
+    public enum SdBlend
+    {
+        Round = 0,      // quarter circle fillet
+        Soft = 1,       // quadratic, union only, Round elsewhere
+        Chamfer = 2,    // 45 degree bevel
+        Smooth = 3      // polynomial smooth minimum
+    }
+
+    /// <summary>
+    /// CPU side of operators.c: union, difference (a minus b) and intersection of two
+    /// distances blended r wide, and the tests that prove the second operand unable to
+    /// change the result from a lower bound of it, so it need not be evaluated. A bound is
+    /// any value b never goes below, SdElement.BoundDistance or a Lipschitz bound. Skipped
+    /// unions and differences give exactly what the full evaluation would, a skipped
+    /// intersection gives the bound, a safe distance.
+    /// </summary>
+    public static class SdOperators
+    {
+        const float SQRT_HALF = 0.70710678f;
+
+        public static float Union(SdBlend blend, float a, float b, float r)
+        {
+            if (r <= 0f)
+                return Math.Min(a, b);
+
+            switch (blend)
+            {
+                case SdBlend.Soft:
+                    float e = Math.Max(r - Math.Abs(a - b), 0f);
+                    return Math.Min(a, b) - e * e * 0.25f / r;
+                case SdBlend.Chamfer:
+                    return Math.Min(Math.Min(a, b), (a - r + b) * SQRT_HALF);
+                case SdBlend.Smooth:
+                    float h = Math.Max(0f, Math.Min(1f, 0.5f + 0.5f * (b - a) / r));
+                    return b + (a - b) * h - r * h * (1f - h);
+                default:
+                    float ux = Math.Max(r - a, 0f),
+                        uy = Math.Max(r - b, 0f);
+                    return Math.Max(r, Math.Min(a, b)) - (float)Math.Sqrt(ux * ux + uy * uy);
+            }
+        }
+
+        public static float Intersection(SdBlend blend, float a, float b, float r)
+        {
+            if (r <= 0f)
+                return Math.Max(a, b);
+
+            switch (blend)
+            {
+                case SdBlend.Chamfer:
+                    return Math.Max(Math.Max(a, b), (a + r + b) * SQRT_HALF);
+                case SdBlend.Smooth:
+                    return -Union(SdBlend.Smooth, -a, -b, r);
+                default:
+                    float ux = Math.Max(r + a, 0f),
+                        uy = Math.Max(r + b, 0f);
+                    return Math.Min(-r, Math.Max(a, b)) + (float)Math.Sqrt(ux * ux + uy * uy);
+            }
+        }
+
+        public static float Difference(SdBlend blend, float a, float b, float r)
+        {
+            return blend == SdBlend.Smooth
+                ? -Union(SdBlend.Smooth, -a, b, r)
+                : Intersection(blend, a, -b, r);
+        }
+
+        // Bounds ----------------------------------------------------------------------
+
+        /// <summary>
+        /// Any blend of the union of a with b gives exactly a, b being at least bBound
+        /// </summary>
+        public static bool UnionFar(float a, float bBound, float r) => bBound >= Math.Max(a, 0f) + r;
+
+        /// <summary>
+        /// Any blend of the difference a minus b gives exactly a, b being at least bBound
+        /// </summary>
+        public static bool DifferenceFar(float a, float bBound, float r) => bBound >= Math.Max(-a, 0f) + r;
+
+        /// <summary>
+        /// Any blend of the intersection of a with b is at least bBound, close enough to stand in for it
+        /// </summary>
+        public static bool IntersectionFar(float a, float bBound, float r) => bBound >= Math.Max(a, 0f) + r;
+    }
+}
@@ -0,0 +1,145 @@
+﻿using OpenTK;
+using System;
+using System.Collections.Generic;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Contents of the SdElements block shared by the shaders and Physics:
+    /// [0] scene parameters, [1].x element count, then elements two vec4 each
+    /// </summary>
+    public class SdScene
+    {
+        public const int ELEMENTS_OFFSET = 2;
+        public const int MAX_ELEMENTS = (Const.UBO_SDELEMENTSMAP_BLOCKCOUNT - ELEMENTS_OFFSET) / 2;
+
+        /// <summary>
+        /// Sphere radius, box size of the repeated scene (g_map[0])
+        /// </summary>
+        public Vector4 Parameters = new Vector4(1, 1, 2, 1);
+
+        // replaced as a whole, so readers on other threads never see a half-built list
+        SdElement[] elements = new SdElement[0];
+
+        // the pack the elements were read from, its block is uploaded in place while they are current
+        ScenePack pack;
+        SdElement[] packElements;
+
+        /// <summary>
+        /// Increments on every change, renderers reupload when it differs
+        /// </summary>
+        public int Version { get; private set; }
+
+        public int Count => elements.Length;
+
+        public SdElement[] Elements => elements;
+
+        public void SetElements(IList<SdElement> list)
+        {
+            var copy = new SdElement[Math.Min(list.Count, MAX_ELEMENTS)];
+            for (int i = 0; i < copy.Length; i++)
+                copy[i] = list[i];
+
+            elements = copy;
+            Version++;
+        }
+
+        /// <summary>
+        /// Parameters and elements of the pack, which has to stay open while they are in use
+        /// </summary>
+        /// <returns>False when the pack has no valid element block</returns>
+        public bool SetElements(ScenePack source)
+        {
+            SdElement[] read = source.ReadElements(out Vector4 parameters);
+            if (read == null)
+                return false;
+
+            Parameters = parameters;
+            pack = source;
+            packElements = read;
+
+            elements = read;
+            Version++;
+            return true;
+        }
+
+        /// <summary>
+        /// The block image in the mapped pack when current are the elements read from it
+        /// </summary>
+        /// <param name="current">Elements the caller is about to upload</param>
+        /// <returns>Zero when the block has to be filled by ToBlock</returns>
+        public IntPtr GetMappedBlock(SdElement[] current, out int bytes)
+        {
+            bytes = 0;
+            if (pack == null || !ReferenceEquals(current, packElements))
+                return IntPtr.Zero;
+
+            return pack.GetElementsBlock(out bytes);
+        }
+
+        /// <summary>
+        /// Fills std140 image of the SdElements block
+        /// </summary>
+        /// <returns>Number of used vec4</returns>
+        public int ToBlock(Vector4[] block) => ToBlock(block, elements);
+
+        /// <summary>
+        /// Fills std140 image of the SdElements block with the given elements
+        /// </summary>
+        /// <param name="current">Elements read once by the caller, they may be replaced meanwhile</param>
+        /// <returns>Number of used vec4</returns>
+        public int ToBlock(Vector4[] block, SdElement[] current)
+        {
+            block[0] = Parameters;
+            block[1] = new Vector4(current.Length, 0, 0, 0);
+
+            for (int i = 0; i < current.Length; i++)
+            {
+                block[ELEMENTS_OFFSET + 2 * i] = current[i].PositionType;
+                block[ELEMENTS_OFFSET + 2 * i + 1] = current[i].SizeBound;
+            }
+
+            return ELEMENTS_OFFSET + 2 * current.Length;
+        }
+
+        /// <summary>
+        /// Distance to the nearest element or float.MaxValue when empty
+        /// </summary>
+        public float Distance(Vector3 p)
+        {
+            SdElement[] current = elements;
+            float d = float.MaxValue;
+
+            for (int i = 0; i < current.Length; i++)
+                d = Math.Min(d, current[i].Distance(p));
+
+            return d;
+        }
+
+        /// <summary>
+        /// Random field of spheres, boxes and cylinders standing on the ground plane
+        /// </summary>
+        public static List<SdElement> Scatter(int count, Vector3 center, float extent, int seed = 1)
+        {
+            var rnd = new Random(seed);
+            var list = new List<SdElement>(count);
+
+            for (int i = 0; i < count; i++)
+            {
+                var type = (SdElementType)(i % 3);
+                var size = new Vector3(
+                    0.3f + (float)rnd.NextDouble() * 0.5f,
+                    0.3f + (float)rnd.NextDouble() * 1.0f,
+                    0.3f + (float)rnd.NextDouble() * 0.5f);
+                var position = new Vector3(
+                    center.X + ((float)rnd.NextDouble() * 2f - 1f) * extent,
+                    size.Y,
+                    center.Z + ((float)rnd.NextDouble() * 2f - 1f) * extent);
+
+                list.Add(new SdElement(type, position, size));
+            }
+
+            return list;
+        }
+    }
+}
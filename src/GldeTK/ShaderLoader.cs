@@ -0,0 +1,115 @@
+﻿using OpenTK.Graphics.OpenGL4;
+using System.Diagnostics;
+using System.IO;
+using System.Reflection;
+using System.Text;
+
+namespace GldeTK
+{
+    public static class ShaderLoader
+    {
+        const string INCLUDE_DIRECTIVE = "#include";
+
+        /// <summary>
+        /// Shaders of this pack replace the embedded ones of the same name, set before the Render starts
+        /// </summary>
+        public static ScenePack Pack;
+
+        public static string LoadEmbeddedFile(string filename)
+        {
+            string packed = Pack?.GetShader(filename.StartsWith(Const.SHADER_RESOURCE_PREFIX)
+                ? filename.Substring(Const.SHADER_RESOURCE_PREFIX.Length)
+                : filename);
+            if (packed != null)
+                return packed;
+
+            using (Stream stream = Assembly.GetExecutingAssembly().GetManifestResourceStream(filename))
+            using (TextReader reader = new StreamReader(stream))
+                return reader.ReadToEnd();
+        }
+
+        /// <summary>
+        /// Loads shader source and pastes every #include "file.c" line
+        /// with the embedded shader of the same name
+        /// </summary>
+        /// <param name="filename">Embedded resource name</param>
+        public static string LoadSource(string filename)
+        {
+            var source = new StringBuilder();
+
+            using (var reader = new StringReader(LoadEmbeddedFile(filename)))
+            {
+                string line;
+                while ((line = reader.ReadLine()) != null)
+                {
+                    string directive = line.Trim();
+                    if (directive.StartsWith(INCLUDE_DIRECTIVE))
+                    {
+                        string include = directive.Substring(INCLUDE_DIRECTIVE.Length).Trim().Trim('"');
+                        source.AppendLine(LoadSource(Const.SHADER_RESOURCE_PREFIX + include));
+                    }
+                    else
+                        source.AppendLine(line);
+                }
+            }
+
+            return source.ToString();
+        }
+
+        public static int Compile(ShaderType type, string filename)
+        {
+            int h_shader = GL.CreateShader(type);
+            GL.ShaderSource(h_shader, LoadSource(filename));
+            GL.CompileShader(h_shader);
+
+            GL.GetShader(h_shader, ShaderParameter.CompileStatus, out int status);
+            if (status == 0)
+                Debug.WriteLine($"{filename}: {GL.GetShaderInfoLog(h_shader)}");
+
+            return h_shader;
+        }
+
+        /// <summary>
+        /// Links shaders into a new program, shaders are detached and deleted afterwards
+        /// </summary>
+        /// <returns>Shader program name index</returns>
+        public static int Link(params int[] h_shaders)
+        {
+            int h_program = GL.CreateProgram();
+
+            foreach (int h_shader in h_shaders)
+                GL.AttachShader(h_program, h_shader);
+
+            GL.LinkProgram(h_program);
+
+            GL.GetProgram(h_program, GetProgramParameterName.LinkStatus, out int status);
+            if (status == 0)
+                Debug.WriteLine(GL.GetProgramInfoLog(h_program));
+
+            foreach (int h_shader in h_shaders)
+                RemoveShader(h_program, h_shader);
+
+            return h_program;
+        }
+
+        /// <summary>
+        /// Detach than delete shader
+        /// </summary>
+        /// <param name="h_program">Shader program name index</param>
+        /// <param name="h_index">Shader name index</param>
+        public static void RemoveShader(int h_program, int h_index)
+        {
+            GL.DetachShader(h_program, h_index);
+            GL.DeleteShader(h_index);
+        }
+
+        /// <summary>
+        /// Binds program's SdElements block to the shared map buffer
+        /// </summary>
+        public static void BindMapBlock(int h_program)
+        {
+            int block_index = GL.GetUniformBlockIndex(h_program, Const.UBO_SDELEMENTSMAP_BLOCKNAME);
+            GL.UniformBlockBinding(h_program, block_index, Const.UBO_SDELEMENTSMAP_BINDING);
+        }
+    }
+}
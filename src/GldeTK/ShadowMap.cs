@@ -0,0 +1,200 @@
+﻿using OpenTK;
+using OpenTK.Graphics.OpenGL4;
+using System;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Directional shadow map of the sun around the camera (fragment_shadowmap.c). Every texel
+    /// marches one ray down along the light and keeps the distance and softshadow() of its hit,
+    /// so shading replaces the shadow march by four texel fetches. The map is kept across frames
+    /// and marched again only when the light turned past Const.SHADOW_MAP_MAX_ANGLE, the camera
+    /// left its cell, the scene or the sculpted ground changed, or every Const.SHADOW_MAP_INTERVAL
+    /// frames while bodies move.
+    /// A new map is marched into the back texture in Const.SHADOW_MAP_SLICES bands, one per frame,
+    /// shading reads the last complete one until it is done.
+    /// </summary>
+    public class ShadowMap
+    {
+        int h_program;
+        SceneUniforms uniforms;
+
+        int[] fbo_maps = new int[2],
+            tex_maps = new int[2];
+        int front;      // map shading reads
+
+        // complete map of the front texture
+        bool valid;
+        Vector3 mapLight,
+            mapCenter;
+        int version;
+
+        // map marched into the back texture, slice - next band, -1 none
+        int slice = -1;
+        Vector3 nextLight,
+            nextCenter;
+        int nextSceneVersion,
+            nextSculptVersion,
+            nextBodyVersion,
+            framesSinceMap;
+
+        public bool IsStarted => h_program != 0;
+
+        /// <summary>
+        /// Shading reads the map, softshadow() otherwise. Set by the input thread.
+        /// </summary>
+        public bool Enabled { get; set; }
+
+        public void Start()
+        {
+            h_program = ShaderLoader.Link(
+                ShaderLoader.Compile(ShaderType.VertexShader, Const.VERTEX_FILENAME),
+                ShaderLoader.Compile(ShaderType.FragmentShader, Const.FRAGMENT_SHADOWMAP_FILENAME));
+
+            ShaderLoader.BindMapBlock(h_program);
+            uniforms = new SceneUniforms(h_program);
+
+            // distance, softshadow() of the hit
+            GL.GenTextures(2, tex_maps);
+            GL.GenFramebuffers(2, fbo_maps);
+
+            for (int i = 0; i < 2; i++)
+            {
+                GL.BindTexture(TextureTarget.Texture2D, tex_maps[i]);
+                GL.TexImage2D(
+                    TextureTarget.Texture2D, 0,
+                    PixelInternalFormat.Rg32f,
+                    Const.SHADOW_MAP_SIZE, Const.SHADOW_MAP_SIZE, 0,
+                    PixelFormat.Rg, PixelType.Float,
+                    IntPtr.Zero);
+                GL.TexParameter(TextureTarget.Texture2D, TextureParameterName.TextureMinFilter, (int)TextureMinFilter.Nearest);
+                GL.TexParameter(TextureTarget.Texture2D, TextureParameterName.TextureMagFilter, (int)TextureMagFilter.Nearest);
+
+                GL.BindFramebuffer(FramebufferTarget.Framebuffer, fbo_maps[i]);
+                GL.FramebufferTexture2D(FramebufferTarget.Framebuffer, FramebufferAttachment.ColorAttachment0, TextureTarget.Texture2D, tex_maps[i], 0);
+            }
+
+            GL.BindTexture(TextureTarget.Texture2D, 0);
+            GL.BindFramebuffer(FramebufferTarget.Framebuffer, 0);
+        }
+
+        /// <summary>
+        /// Map center of the camera, snapped so small moves keep the map
+        /// </summary>
+        static Vector3 MapCenter(Vector3 eye)
+        {
+            return new Vector3(
+                (float)Math.Round(eye.X / Const.SHADOW_MAP_RECENTER) * Const.SHADOW_MAP_RECENTER,
+                0f,
+                (float)Math.Round(eye.Z / Const.SHADOW_MAP_RECENTER) * Const.SHADOW_MAP_RECENTER);
+        }
+
+        /// <summary>
+        /// Swaps in a completed map, starts a new one when the light, the camera cell,
+        /// the scene or the bodies moved on, and sets the shadow fields of the frame
+        /// </summary>
+        /// <returns>A band is due, Render it with the FrameParams of NextMapFrame</returns>
+        internal bool OnFrame(ref FrameState frame)
+        {
+            if (!IsStarted || !Enabled)
+            {
+                valid = false;
+                slice = -1;
+                frame.ShadowLight = Vector4.Zero;
+                frame.ShadowVersion = version;
+                return false;
+            }
+
+            if (slice == Const.SHADOW_MAP_SLICES)
+            {
+                front = 1 - front;
+                valid = true;
+                mapLight = nextLight;
+                mapCenter = nextCenter;
+                slice = -1;
+                version++;
+
+                GL.ActiveTexture(TextureUnit.Texture0 + Const.SHADOW_MAP_TEXTURE_UNIT);
+                GL.BindTexture(TextureTarget.Texture2D, tex_maps[front]);
+                GL.ActiveTexture(TextureUnit.Texture0);
+            }
+
+            Vector3 light = FrameParams.GetLightDirection(frame.GlobalTime);
+            Vector3 center = MapCenter(frame.Origin);
+            framesSinceMap++;
+
+            // against the map in the making, the complete one otherwise
+            bool stale = (!valid && slice < 0)
+                || Vector3.Dot(light, nextLight) < Math.Cos(Const.SHADOW_MAP_MAX_ANGLE)
+                || center != nextCenter
+                || frame.SceneVersion != nextSceneVersion
+                || frame.SculptVersion != nextSculptVersion
+                || (frame.BodyVersion != nextBodyVersion && framesSinceMap >= Const.SHADOW_MAP_INTERVAL);
+
+            if (stale)
+            {
+                nextLight = light;
+                nextCenter = center;
+                nextSceneVersion = frame.SceneVersion;
+                nextSculptVersion = frame.SculptVersion;
+                nextBodyVersion = frame.BodyVersion;
+                framesSinceMap = 0;
+                slice = 0;
+            }
+
+            frame.ShadowLight = valid ? new Vector4(mapLight, 1f) : Vector4.Zero;
+            frame.ShadowCenter = new Vector4(mapCenter, Const.SHADOW_MAP_EXTENT);
+            frame.ShadowVersion = version;
+            return slice >= 0;
+        }
+
+        /// <summary>
+        /// The frame with the light and center of the map in the making, for its FrameParams
+        /// </summary>
+        internal FrameState NextMapFrame(FrameState frame)
+        {
+            var view = frame;
+            view.Width = view.Height = Const.SHADOW_MAP_SIZE;
+            view.ShadowLight = new Vector4(nextLight, 1f);
+            view.ShadowCenter = new Vector4(nextCenter, Const.SHADOW_MAP_EXTENT);
+            return view;
+        }
+
+        /// <summary>
+        /// Marches the next band of the back map, the front one stays bound to its texture unit
+        /// </summary>
+        /// <param name="view">NextMapFrame of the frame</param>
+        internal void Render(FrameState view, int width, int height)
+        {
+            int rows = (Const.SHADOW_MAP_SIZE + Const.SHADOW_MAP_SLICES - 1) / Const.SHADOW_MAP_SLICES;
+
+            GL.BindFramebuffer(FramebufferTarget.Framebuffer, fbo_maps[1 - front]);
+            GL.Viewport(0, 0, Const.SHADOW_MAP_SIZE, Const.SHADOW_MAP_SIZE);
+            GL.Enable(EnableCap.ScissorTest);
+            GL.Scissor(0, slice * rows, Const.SHADOW_MAP_SIZE, rows);
+
+            GL.UseProgram(h_program);
+            uniforms.Set(view);
+            GL.DrawArrays(PrimitiveType.Triangles, 0, 3);
+            GL.UseProgram(0);
+
+            GL.Disable(EnableCap.ScissorTest);
+            GL.Viewport(0, 0, width, height);
+            GL.BindFramebuffer(FramebufferTarget.Framebuffer, 0);
+
+            if (++slice == Const.SHADOW_MAP_SLICES)
+                Profiler.Count(Const.PROFILER_SHADOW_MAPS);
+        }
+
+        internal void Stop()
+        {
+            if (!IsStarted)
+                return;
+
+            GL.DeleteTextures(2, tex_maps);
+            GL.DeleteFramebuffers(2, fbo_maps);
+            GL.DeleteProgram(h_program);
+            h_program = 0;
+        }
+    }
+}
@@ -0,0 +1,27 @@
+﻿using OpenTK;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Result of a swept shape against Physics.Map
+    /// </summary>
+    public struct SweepHit
+    {
+        /// <summary>
+        /// A surface is within contact distance at Time
+        /// </summary>
+        public bool Hit;
+
+        /// <summary>
+        /// Fraction of the motion that is free of the surface (time of impact on a hit)
+        /// </summary>
+        public float Time;
+
+        /// <summary>
+        /// Surface normal at the contact, zero without a hit
+        /// </summary>
+        public Vector3 Normal;
+
+        public int Steps;
+    }
+}
@@ -0,0 +1,88 @@
+﻿using OpenTK.Graphics.OpenGL4;
+using System;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Culling pass writing per screen tile lists of SdElements (compute_bin.c),
+    /// the marchers read them through a texture buffer
+    /// </summary>
+    public class TileBinner
+    {
+        const int TILE_LISTS_BINDING = 5;
+
+        int h_bin;
+        SceneUniforms binUniforms;
+
+        int buf_tileLists,
+            tex_tileLists;
+
+        int tilesX,
+            tilesY;
+
+        public bool IsStarted => h_bin != 0;
+
+        public void Start()
+        {
+            h_bin = ShaderLoader.Link(
+                ShaderLoader.Compile(ShaderType.ComputeShader, Const.COMPUTE_BIN_FILENAME));
+
+            ShaderLoader.BindMapBlock(h_bin);
+            binUniforms = new SceneUniforms(h_bin);
+
+            buf_tileLists = GL.GenBuffer();
+            tex_tileLists = GL.GenTexture();
+        }
+
+        internal void OnResize(int width, int height)
+        {
+            if (!IsStarted)
+                return;
+
+            tilesX = (width + Const.BIN_TILE_SIZE - 1) / Const.BIN_TILE_SIZE;
+            tilesY = (height + Const.BIN_TILE_SIZE - 1) / Const.BIN_TILE_SIZE;
+
+            GL.BindBuffer(BufferTarget.ShaderStorageBuffer, buf_tileLists);
+            GL.BufferData(
+                BufferTarget.ShaderStorageBuffer,
+                tilesX * tilesY * Const.BIN_TILE_STRIDE * sizeof(uint),
+                IntPtr.Zero,
+                BufferUsageHint.DynamicCopy);
+            GL.BindBuffer(BufferTarget.ShaderStorageBuffer, 0);
+
+            GL.BindTexture(TextureTarget.TextureBuffer, tex_tileLists);
+            GL.TexBuffer(TextureBufferTarget.TextureBuffer, SizedInternalFormat.R32ui, buf_tileLists);
+            GL.BindTexture(TextureTarget.TextureBuffer, 0);
+        }
+
+        /// <summary>
+        /// Bins elements for the frame and binds the lists to Const.TILE_LISTS_TEXTURE_UNIT
+        /// </summary>
+        internal void OnFrame(FrameState frame)
+        {
+            GL.UseProgram(h_bin);
+            binUniforms.Set(frame);
+
+            GL.BindBufferBase(BufferRangeTarget.ShaderStorageBuffer, TILE_LISTS_BINDING, buf_tileLists);
+            GL.DispatchCompute(tilesX, tilesY, 1);
+            GL.MemoryBarrier(MemoryBarrierFlags.TextureFetchBarrierBit);
+
+            GL.ActiveTexture(TextureUnit.Texture0 + Const.TILE_LISTS_TEXTURE_UNIT);
+            GL.BindTexture(TextureTarget.TextureBuffer, tex_tileLists);
+            GL.ActiveTexture(TextureUnit.Texture0);
+
+            GL.UseProgram(0);
+        }
+
+        internal void Stop()
+        {
+            if (!IsStarted)
+                return;
+
+            GL.DeleteTexture(tex_tileLists);
+            GL.DeleteBuffers(1, ref buf_tileLists);
+            GL.DeleteProgram(h_bin);
+            h_bin = 0;
+        }
+    }
+}
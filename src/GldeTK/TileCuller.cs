@@ -0,0 +1,85 @@
+﻿using OpenTK.Graphics.OpenGL4;
+using System;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Empty space culling pass (compute_cull.c): bounds the scene over every screen
+    /// tile with interval arithmetic and writes the depth range worth marching
+    /// </summary>
+    public class TileCuller
+    {
+        const int TILE_RANGES_IMAGE_UNIT = 1;
+
+        int h_cull;
+        SceneUniforms cullUniforms;
+
+        int tex_tileRanges;
+
+        int tilesX,
+            tilesY;
+
+        public bool IsStarted => h_cull != 0;
+
+        public void Start()
+        {
+            h_cull = ShaderLoader.Link(
+                ShaderLoader.Compile(ShaderType.ComputeShader, Const.COMPUTE_CULL_FILENAME));
+
+            ShaderLoader.BindMapBlock(h_cull);
+            cullUniforms = new SceneUniforms(h_cull);
+
+            tex_tileRanges = GL.GenTexture();
+        }
+
+        internal void OnResize(int width, int height)
+        {
+            if (!IsStarted)
+                return;
+
+            tilesX = (width + Const.BIN_TILE_SIZE - 1) / Const.BIN_TILE_SIZE;
+            tilesY = (height + Const.BIN_TILE_SIZE - 1) / Const.BIN_TILE_SIZE;
+
+            GL.BindTexture(TextureTarget.Texture2D, tex_tileRanges);
+            GL.TexImage2D(
+                TextureTarget.Texture2D, 0,
+                PixelInternalFormat.Rg32f,
+                tilesX, tilesY, 0,
+                PixelFormat.Rg, PixelType.Float,
+                IntPtr.Zero);
+            GL.TexParameter(TextureTarget.Texture2D, TextureParameterName.TextureMinFilter, (int)TextureMinFilter.Nearest);
+            GL.TexParameter(TextureTarget.Texture2D, TextureParameterName.TextureMagFilter, (int)TextureMagFilter.Nearest);
+            GL.BindTexture(TextureTarget.Texture2D, 0);
+        }
+
+        /// <summary>
+        /// Culls tiles for the frame and binds the ranges to Const.TILE_RANGES_TEXTURE_UNIT
+        /// </summary>
+        /// <param name="tileBinning">Tile lists of the frame are already bound</param>
+        internal void OnFrame(FrameState frame, bool tileBinning)
+        {
+            GL.UseProgram(h_cull);
+            cullUniforms.Set(frame, tileBinning);
+
+            GL.BindImageTexture(TILE_RANGES_IMAGE_UNIT, tex_tileRanges, 0, false, 0, TextureAccess.WriteOnly, SizedInternalFormat.Rg32f);
+            GL.DispatchCompute(tilesX, tilesY, 1);
+            GL.MemoryBarrier(MemoryBarrierFlags.TextureFetchBarrierBit);
+
+            GL.ActiveTexture(TextureUnit.Texture0 + Const.TILE_RANGES_TEXTURE_UNIT);
+            GL.BindTexture(TextureTarget.Texture2D, tex_tileRanges);
+            GL.ActiveTexture(TextureUnit.Texture0);
+
+            GL.UseProgram(0);
+        }
+
+        internal void Stop()
+        {
+            if (!IsStarted)
+                return;
+
+            GL.DeleteTexture(tex_tileRanges);
+            GL.DeleteProgram(h_cull);
+            h_cull = 0;
+        }
+    }
+}
@@ -0,0 +1,79 @@
+﻿using OpenTK;
+using System.IO;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Indexed triangle mesh with vertex normals, counter-clockwise seen from outside.
+    /// The binary file is little-endian: "GTKM", version, vertex count, index count as int32,
+    /// the positions and then the normals as float32 triples, the indices as int32.
+    /// </summary>
+    public class TriangleMesh
+    {
+        const uint MAGIC = 0x4d4b5447;  // "GTKM"
+        const int VERSION = 1;
+
+        public readonly Vector3[] Positions;
+        public readonly Vector3[] Normals;
+        public readonly int[] Indices;
+
+        public int TriangleCount => Indices.Length / 3;
+
+        /// <summary>
+        /// Size of the arrays in bytes, as in the file
+        /// </summary>
+        public long Bytes => Positions.Length * 24L + Indices.Length * 4L;
+
+        public TriangleMesh(Vector3[] positions, Vector3[] normals, int[] indices)
+        {
+            Positions = positions;
+            Normals = normals;
+            Indices = indices;
+        }
+
+        public void Save(string path)
+        {
+            using (var writer = new BinaryWriter(new BufferedStream(File.Create(path), 1 << 16)))
+            {
+                writer.Write(MAGIC);
+                writer.Write(VERSION);
+                writer.Write(Positions.Length);
+                writer.Write(Indices.Length);
+
+                foreach (Vector3[] array in new[] { Positions, Normals })
+                    foreach (Vector3 v in array)
+                    {
+                        writer.Write(v.X);
+                        writer.Write(v.Y);
+                        writer.Write(v.Z);
+                    }
+
+                foreach (int index in Indices)
+                    writer.Write(index);
+            }
+        }
+
+        /// <returns>Null when the file is not a mesh of this version</returns>
+        public static TriangleMesh Load(string path)
+        {
+            using (var reader = new BinaryReader(new BufferedStream(File.OpenRead(path), 1 << 16)))
+            {
+                if (reader.ReadUInt32() != MAGIC || reader.ReadInt32() != VERSION)
+                    return null;
+
+                var positions = new Vector3[reader.ReadInt32()];
+                var normals = new Vector3[positions.Length];
+                var indices = new int[reader.ReadInt32()];
+
+                foreach (Vector3[] array in new[] { positions, normals })
+                    for (int i = 0; i < array.Length; i++)
+                        array[i] = new Vector3(reader.ReadSingle(), reader.ReadSingle(), reader.ReadSingle());
+
+                for (int i = 0; i < indices.Length; i++)
+                    indices[i] = reader.ReadInt32();
+
+                return new TriangleMesh(positions, normals, indices);
+            }
+        }
+    }
+}
@@ -0,0 +1,350 @@
+﻿using OpenTK;
+using System;
+using System.Collections.Concurrent;
+using System.Collections.Generic;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Unique elements of an unbounded world, split into square chunks on the ground plane and
+    /// streamed around the camera. The SdElements block is the GPU pool: Const.STREAM_POOL_CHUNKS
+    /// slots of Const.STREAM_CHUNK_CAPACITY elements, a chunk wanted when all are taken replaces
+    /// the least recently wanted one. Chunks are loaded on the thread pool and kept on the CPU
+    /// until the camera is far, so a chunk evicted from the pool comes back without a load. The
+    /// chunks ahead along the camera velocity are loaded and made resident in the slots nobody
+    /// wants. Residency goes into the SdScene, renderers and Physics see the same elements.
+    /// </summary>
+    public class WorldStreamer
+    {
+        const float VELOCITY_SMOOTHING = 0.1f;  // of the new velocity per update
+        const float PREFETCH_MIN_SPEED = 0.5f;  // m/s
+
+        class Chunk
+        {
+            public int X, Z;
+            public SdElement[] Elements;
+            public int Slot = -1;
+            public long LastUsed;       // last update that wanted it or found it ahead
+            public bool Prefetched;     // made resident ahead of the camera, not yet wanted
+        }
+
+        readonly SdScene scene;
+        readonly Func<int, int, SdElement[]> source;
+        readonly object sync = new object();
+
+        readonly Dictionary<long, Chunk> loaded = new Dictionary<long, Chunk>();
+        readonly HashSet<long> loading = new HashSet<long>();
+        readonly HashSet<long> missed = new HashSet<long>();    // wanted and not resident, counted once
+        readonly ConcurrentQueue<Chunk> completed = new ConcurrentQueue<Chunk>();
+        readonly Chunk[] slots = new Chunk[Const.STREAM_POOL_CHUNKS];
+        readonly List<SdElement> resident = new List<SdElement>(SdScene.MAX_ELEMENTS);
+        readonly List<long> wanted = new List<long>();
+        readonly List<long> ahead = new List<long>();
+        readonly List<long> far = new List<long>();
+
+        // load tasks still running, every one of them may still post its chunk
+        int inFlight;
+        long update;
+        Vector3 lastOrigin;
+        bool hasOrigin;
+        Vector3 velocity;
+
+        public bool Enabled { get; private set; }
+
+        /// <summary>
+        /// Chunks ahead along the camera velocity are loaded and made resident early
+        /// </summary>
+        public bool Prefetch = true;
+
+        public int ResidentChunks { get; private set; }
+
+        public int LoadedChunks => loaded.Count;
+
+        public int Loading => loading.Count;
+
+        /// <param name="source">Elements of the chunk x, z, called on worker threads; Generate by default</param>
+        public WorldStreamer(SdScene scene, Func<int, int, SdElement[]> source = null)
+        {
+            this.scene = scene;
+            this.source = source ?? Generate;
+        }
+
+        public static long Key(int x, int z) => (long)x << 32 | (uint)z;
+
+        /// <summary>
+        /// Procedural stand-in for an authored world: every chunk has its own scatter of elements
+        /// </summary>
+        public static SdElement[] Generate(int x, int z)
+        {
+            int seed = x * 73856093 ^ z * 19349663;
+            int count = 2 + (int)((uint)seed % (Const.STREAM_CHUNK_CAPACITY - 1));
+            var center = new Vector3((x + 0.5f) * Const.STREAM_CHUNK_SIZE, 0f, (z + 0.5f) * Const.STREAM_CHUNK_SIZE);
+
+            // the largest element stays inside its chunk
+            return SdScene.Scatter(count, center, Const.STREAM_CHUNK_SIZE * 0.5f - 1f, seed).ToArray();
+        }
+
+        /// <summary>
+        /// Starts or stops owning the elements of the scene, the scene is emptied either way
+        /// </summary>
+        public void Toggle()
+        {
+            lock (sync)
+            {
+                Enabled = !Enabled;
+
+                for (int i = 0; i < slots.Length; i++)
+                    if (slots[i] != null)
+                    {
+                        slots[i].Slot = -1;
+                        slots[i] = null;
+                    }
+
+                missed.Clear();
+                hasOrigin = false;
+                velocity = Vector3.Zero;
+                ResidentChunks = 0;
+                scene.SetElements(new SdElement[0]);
+            }
+        }
+
+        /// <summary>
+        /// Takes the chunks loaded since the last call, asks for the chunks around origin and ahead
+        /// of it and publishes the new residency to the scene. Called by the input thread.
+        /// </summary>
+        /// <param name="delta">Seconds since the last call</param>
+        public void Update(Vector3 origin, float delta)
+        {
+            lock (sync)
+            {
+                if (!Enabled)
+                    return;
+
+                update++;
+
+                while (completed.TryDequeue(out Chunk chunk))
+                {
+                    loading.Remove(Key(chunk.X, chunk.Z));
+
+                    // a failed load is asked for again while the chunk is wanted
+                    if (chunk.Elements == null)
+                        continue;
+
+                    loaded[Key(chunk.X, chunk.Z)] = chunk;
+                    Profiler.Count(Const.PROFILER_STREAM_LOADS);
+                }
+
+                if (hasOrigin && delta > 0f)
+                    velocity += ((origin - lastOrigin) / delta - velocity) * VELOCITY_SMOOTHING;
+                lastOrigin = origin;
+                hasOrigin = true;
+
+                bool changed = false;
+
+                // nearest first, they get the pool and the workers before the rest
+                Collect(wanted, origin, null);
+                foreach (long key in wanted)
+                {
+                    if (loaded.TryGetValue(key, out Chunk chunk) && chunk.Slot >= 0)
+                    {
+                        chunk.LastUsed = update;
+                        if (chunk.Prefetched)
+                            Profiler.Count(Const.PROFILER_STREAM_PREFETCH_HITS);
+                        chunk.Prefetched = false;
+                        missed.Remove(key);
+                        continue;
+                    }
+
+                    // a chunk waiting for its load or a slot is one miss, not one per update
+                    if (missed.Add(key))
+                        Profiler.Count(Const.PROFILER_STREAM_MISSES);
+
+                    if (chunk == null)
+                        Load(key);
+                    else
+                    {
+                        chunk.LastUsed = update;
+                        changed |= MakeResident(chunk);
+                    }
+                }
+
+                if (Prefetch && velocity.Xz.Length > PREFETCH_MIN_SPEED)
+                {
+                    Collect(ahead, origin + velocity * Const.STREAM_PREFETCH_TIME, wanted);
+                    foreach (long key in ahead)
+                    {
+                        if (!loaded.TryGetValue(key, out Chunk chunk))
+                        {
+                            Load(key);
+                            continue;
+                        }
+
+                        chunk.LastUsed = update;
+                        if (chunk.Slot < 0 && MakeResident(chunk))
+                        {
+                            chunk.Prefetched = true;
+                            changed = true;
+                        }
+                    }
+                }
+
+                Unload(origin);
+
+                if (changed)
+                    Publish();
+            }
+        }
+
+        /// <summary>
+        /// Chunks touching the circle of Const.STREAM_RADIUS around center, nearest first
+        /// </summary>
+        void Collect(List<long> keys, Vector3 center, List<long> except)
+        {
+            keys.Clear();
+
+            float size = Const.STREAM_CHUNK_SIZE,
+                radius = Const.STREAM_RADIUS;
+            int x0 = (int)Math.Floor((center.X - radius) / size),
+                x1 = (int)Math.Floor((center.X + radius) / size),
+                z0 = (int)Math.Floor((center.Z - radius) / size),
+                z1 = (int)Math.Floor((center.Z + radius) / size);
+
+            var distances = new List<KeyValuePair<float, long>>();
+            for (int z = z0; z <= z1; z++)
+                for (int x = x0; x <= x1; x++)
+                {
+                    // nearest point of the chunk square
+                    float dx = center.X - Math.Max(x * size, Math.Min((x + 1) * size, center.X)),
+                        dz = center.Z - Math.Max(z * size, Math.Min((z + 1) * size, center.Z));
+                    float d2 = dx * dx + dz * dz;
+
+                    if (d2 <= radius * radius && (except == null || !except.Contains(Key(x, z))))
+                        distances.Add(new KeyValuePair<float, long>(d2, Key(x, z)));
+                }
+
+            distances.Sort((a, b) => a.Key.CompareTo(b.Key));
+            foreach (KeyValuePair<float, long> entry in distances)
+                keys.Add(entry.Value);
+        }
+
+        void Load(long key)
+        {
+            if (loading.Contains(key) || inFlight >= Const.STREAM_MAX_LOADS)
+                return;
+
+            loading.Add(key);
+            Interlocked.Increment(ref inFlight);
+
+            int x = (int)(key >> 32),
+                z = (int)key;
+
+            Task.Run(() =>
+            {
+                SdElement[] elements = null;
+                try
+                {
+                    elements = source(x, z);
+                    if (elements != null && elements.Length > Const.STREAM_CHUNK_CAPACITY)
+                        Array.Resize(ref elements, Const.STREAM_CHUNK_CAPACITY);
+                }
+                finally
+                {
+                    // posted even when the source failed, no elements frees the key in loading
+                    completed.Enqueue(new Chunk { X = x, Z = z, Elements = elements });
+                    Interlocked.Decrement(ref inFlight);
+                }
+            });
+        }
+
+        /// <summary>
+        /// A free slot or the one of the least recently used chunk, chunks used by this update stay
+        /// </summary>
+        bool MakeResident(Chunk chunk)
+        {
+            int victim = -1;
+            for (int i = 0; i < slots.Length; i++)
+            {
+                if (slots[i] == null)
+                {
+                    victim = i;
+                    break;
+                }
+
+                if (slots[i].LastUsed < update && (victim < 0 || slots[i].LastUsed < slots[victim].LastUsed))
+                    victim = i;
+            }
+
+            if (victim < 0)
+                return false;
+
+            Chunk evicted = slots[victim];
+            if (evicted != null)
+            {
+                evicted.Slot = -1;
+                evicted.Prefetched = false;
+                Profiler.Count(Const.PROFILER_STREAM_EVICTIONS);
+            }
+
+            slots[victim] = chunk;
+            chunk.Slot = victim;
+            return true;
+        }
+
+        /// <summary>
+        /// Drops the CPU copies of the chunks out of the pool and far from the camera
+        /// </summary>
+        void Unload(Vector3 origin)
+        {
+            far.Clear();
+            float reach = Const.STREAM_UNLOAD_RADIUS + Const.STREAM_CHUNK_SIZE;
+
+            foreach (KeyValuePair<long, Chunk> entry in loaded)
+            {
+                Chunk chunk = entry.Value;
+                float dx = (chunk.X + 0.5f) * Const.STREAM_CHUNK_SIZE - origin.X,
+                    dz = (chunk.Z + 0.5f) * Const.STREAM_CHUNK_SIZE - origin.Z;
+
+                if (chunk.Slot < 0 && dx * dx + dz * dz > reach * reach)
+                    far.Add(entry.Key);
+            }
+
+            foreach (long key in far)
+                loaded.Remove(key);
+
+            // misses of chunks left behind before they became resident
+            far.Clear();
+            foreach (long key in missed)
+            {
+                float dx = ((int)(key >> 32) + 0.5f) * Const.STREAM_CHUNK_SIZE - origin.X,
+                    dz = ((int)key + 0.5f) * Const.STREAM_CHUNK_SIZE - origin.Z;
+
+                if (dx * dx + dz * dz > reach * reach)
+                    far.Add(key);
+            }
+
+            foreach (long key in far)
+                missed.Remove(key);
+        }
+
+        /// <summary>
+        /// Elements of the pool in slot order as the new scene, a single swap of the element array
+        /// </summary>
+        void Publish()
+        {
+            resident.Clear();
+            int chunks = 0;
+
+            foreach (Chunk chunk in slots)
+                if (chunk != null)
+                {
+                    resident.AddRange(chunk.Elements);
+                    chunks++;
+                }
+
+            ResidentChunks = chunks;
+            scene.SetElements(resident);
+        }
+    }
+}
@@ -0,0 +1,77 @@
+﻿using System;
+using System.IO;
+using System.Text;
+
+namespace GldeTK
+{
+    /// <summary>
+    /// Uncompressed YUV4MPEG2 stream, 4:2:0 full range (C420jpeg), played by ffplay and mpv
+    /// and accepted by every encoder. Odd sizes lose their last row or column.
+    /// </summary>
+    public class Y4mWriter : IDisposable
+    {
+        static readonly byte[] FRAME_HEADER = Encoding.ASCII.GetBytes("FRAME\n");
+
+        Stream stream;
+        int width,
+            height;
+        byte[] planes;
+
+        public Y4mWriter(string path, int width, int height, int fps)
+        {
+            this.width = width & ~1;
+            this.height = height & ~1;
+            planes = new byte[this.width * this.height * 3 / 2];
+
+            stream = new FileStream(path, FileMode.Create, FileAccess.Write, FileShare.Read, 1 << 20);
+            byte[] header = Encoding.ASCII.GetBytes($"YUV4MPEG2 W{this.width} H{this.height} F{fps}:1 Ip A1:1 C420jpeg\n");
+            stream.Write(header, 0, header.Length);
+        }
+
+        /// <summary>
+        /// Appends one frame
+        /// </summary>
+        /// <param name="rgba">Rows from the bottom up as glReadPixels returns them</param>
+        /// <param name="stride">Pixels per row of rgba</param>
+        public void Write(byte[] rgba, int stride)
+        {
+            int chroma = width * height;
+            int chromaWidth = width / 2;
+            int chromaSize = chromaWidth * (height / 2);
+
+            for (int y = 0; y < height; y += 2)
+                for (int x = 0; x < width; x += 2)
+                {
+                    float r = 0f, g = 0f, b = 0f;
+
+                    // BT.601 luma of the 2x2 block, chroma of its average
+                    for (int k = 0; k < 4; k++)
+                    {
+                        int px = x + (k & 1),
+                            py = y + (k >> 1);
+                        int i = ((height - 1 - py) * stride + px) * 4;
+                        float pr = rgba[i], pg = rgba[i + 1], pb = rgba[i + 2];
+
+                        planes[py * width + px] = (byte)(0.299f * pr + 0.587f * pg + 0.114f * pb + 0.5f);
+                        r += pr; g += pg; b += pb;
+                    }
+
+                    r *= 0.25f; g *= 0.25f; b *= 0.25f;
+                    int c = (y / 2) * chromaWidth + x / 2;
+                    planes[chroma + c] = Clamp(128f - 0.168736f * r - 0.331264f * g + 0.5f * b);
+                    planes[chroma + chromaSize + c] = Clamp(128f + 0.5f * r - 0.418688f * g - 0.081312f * b);
+                }
+
+            stream.Write(FRAME_HEADER, 0, FRAME_HEADER.Length);
+            stream.Write(planes, 0, planes.Length);
+        }
+
+        static byte Clamp(float v) => (byte)Math.Max(0f, Math.Min(255f, v + 0.5f));
+
+        public void Dispose()
+        {
+            stream?.Dispose();
+            stream = null;
+        }
+    }
+}
@@ -0,0 +1,77 @@
+﻿#version 430
+
+// Fills the AO cache (AoCache) around the surfaces of the last frame. Every thread
+// rebuilds one hit from the ray distance of FrameCache and claims the corners of its
+// cell the cache misses, at most uFillBudget cells per frame get their calcAO().
+
+#include "scene.c"
+
+#define GROUP_SIZE 8
+
+layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+
+layout(r32ui, binding = 0) coherent uniform uimage3D aoCacheImage;	// the texture of aoCache
+
+layout(std430, binding = 10) buffer AoCacheFills
+{
+	uint fills;		// cells claimed this frame, zeroed by the host
+};
+
+uniform sampler2D sceneDistance;
+uniform int uFillBudget;
+uniform int uPixelStride;	// every cell covers many pixels
+
+// calcAO() of the static surface closest to the corner of the cell, with its normal
+float cellOcclusion(in ivec3 cell)
+{
+	vec3 p = vec3(cell) * AO_CACHE_CELL;
+	vec3 eps = vec3(0.001, 0.0, 0.0);
+	vec3 nor = normalize(vec3(
+		mapStatic(p + eps.xyy).x - mapStatic(p - eps.xyy).x,
+		mapStatic(p + eps.yxy).x - mapStatic(p - eps.yxy).x,
+		mapStatic(p + eps.yyx).x - mapStatic(p - eps.yyx).x));
+
+	return calcAO(p - nor * mapStatic(p).x, nor, AO_STATIC);
+}
+
+void main(void)
+{
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy) * uPixelStride;
+	if (any(greaterThanEqual(pixel, ivec2(iResolution.xy))))
+		return;
+
+	float t = texelFetch(sceneDistance, pixel, 0).x;
+	if (t >= MARCH_MAX_DIST)
+		return;
+
+	vec3 pos = ro + cameraRay(vec2(pixel) + 0.5) * t;
+	ivec3 base = ivec3(floor(pos / AO_CACHE_CELL));
+
+	if (!aoCacheInside(base, base + 1))
+		return;
+
+	for (int i = 0; i < 8; i++)
+	{
+		ivec3 c = base + ivec3(i & 1, (i >> 1) & 1, i >> 2);
+		ivec3 texel = c & (AO_CACHE_CELLS - 1);
+		uint stamp = aoCacheStamp(c);
+
+		// filled, or claimed by another thread of this frame
+		uint e = imageLoad(aoCacheImage, texel).x;
+		if ((e & AO_CACHE_STAMP) == stamp)
+			continue;
+
+		if (imageAtomicCompSwap(aoCacheImage, texel, e, stamp) != e)
+			continue;
+
+		// over the budget the claim is given back, a later frame asks again
+		if (atomicAdd(fills, 1u) >= uint(uFillBudget))
+		{
+			imageStore(aoCacheImage, texel, uvec4(e));
+			return;
+		}
+
+		uint occ = uint(cellOcclusion(c) * 255.0 + 0.5);
+		imageStore(aoCacheImage, texel, uvec4(AO_CACHE_FILLED | stamp | occ));
+	}
+}
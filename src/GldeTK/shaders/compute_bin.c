@@ -0,0 +1,56 @@
+﻿#version 430
+
+// Screen tile binning of the SdElements list, like tiled light culling.
+// One work group per tile tests every element's bounding sphere, grown by
+// BIN_TILE_REACH, against the tile frustum and writes the survivors into
+// the tile's slot of the list buffer: count, unused, indices...
+
+#include "scene.c"
+
+#define GROUP_SIZE 64
+
+layout(local_size_x = GROUP_SIZE) in;
+
+layout(std430, binding = 5) writeonly buffer TileListsOut
+{
+	uint tileData[];
+};
+
+shared uint s_count;
+
+void main()
+{
+	ivec2 tile = ivec2(gl_WorkGroupID.xy);
+	int base = tileIndex(tile) * BIN_TILE_STRIDE;
+
+	vec3 planes[4];
+	tileFrustum(tile, planes);
+
+	if (gl_LocalInvocationIndex == 0)
+		s_count = 0u;
+	barrier();
+
+	int n = elementCount();
+	for (int i = int(gl_LocalInvocationIndex); i < n; i += GROUP_SIZE)
+	{
+		vec4 bounds = elementBounds(i);
+		vec3 v = bounds.xyz - ro;
+		float r = bounds.w + BIN_TILE_REACH;
+		float depth = dot(v, camProj[2]);
+
+		if (depth + r < 0.0 || depth - r > BIN_TILE_DEPTH
+			|| dot(v, planes[0]) < -r
+			|| dot(v, planes[1]) < -r
+			|| dot(v, planes[2]) < -r
+			|| dot(v, planes[3]) < -r)
+			continue;
+
+		uint slot = atomicAdd(s_count, 1u);
+		if (slot < uint(BIN_TILE_MAX_ELEMENTS))
+			tileData[base + BIN_TILE_HEADER + int(slot)] = uint(i);
+	}
+	barrier();
+
+	if (gl_LocalInvocationIndex == 0)
+		tileData[base] = s_count;	// more than BIN_TILE_MAX_ELEMENTS marks an overflow
+}
@@ -0,0 +1,66 @@
+﻿#version 430
+
+// Empty space culling. One work group per screen tile, every thread bounds
+// map() over one depth slab of the tile frustum with interval arithmetic
+// (mapLower). Slabs proven empty are cut from the front and the back of the
+// tile's depth range; a fully empty tile is not marched at all.
+
+#include "scene.c"
+
+#define GROUP_SIZE 64	// == CULL_SEGMENTS, one slab per thread
+
+layout(local_size_x = GROUP_SIZE) in;
+
+layout(rg32f, binding = 1) uniform writeonly image2D tileRangesOut;	// depth start, end
+
+shared uint s_first;
+shared uint s_last;
+
+void main()
+{
+	ivec2 tile = ivec2(gl_WorkGroupID.xy);
+	int segment = int(gl_LocalInvocationIndex);
+
+	if (segment == 0)
+	{
+		s_first = uint(CULL_SEGMENTS);
+		s_last = 0u;
+	}
+	barrier();
+
+	vec3 d[4];
+	tileCorners(tile, d);
+
+	float z0 = cullSegmentDepth(segment);
+	float z1 = cullSegmentDepth(segment + 1);
+
+	// the slab is a convex hull of its 8 corners
+	vec3 lo = vec3(1e30);
+	vec3 hi = vec3(-1e30);
+	for (int i = 0; i < 4; i++)
+	{
+		vec3 dz = d[i] / dot(d[i], camProj[2]);
+		lo = min(lo, min(ro + dz * z0, ro + dz * z1));
+		hi = max(hi, max(ro + dz * z0, ro + dz * z1));
+	}
+
+	if (mapLower(lo, hi) <= MARCH_MIN_DIST)
+	{
+		atomicMin(s_first, uint(segment));
+		atomicMax(s_last, uint(segment));
+	}
+	barrier();
+
+	if (segment == 0)
+	{
+		vec2 range = vec2(MARCH_MAX_DIST);
+
+		// one more slab behind, relaxed steps may overshoot the last surface
+		if (s_first <= s_last)
+			range = vec2(
+				cullSegmentDepth(int(s_first)),
+				cullSegmentDepth(min(int(s_last) + 2, CULL_SEGMENTS)));
+
+		imageStore(tileRangesOut, tile, vec4(range, 0.0, 0.0));
+	}
+}
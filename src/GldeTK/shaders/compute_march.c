@@ -0,0 +1,118 @@
+﻿#version 430
+
+// Persistent-thread ray marcher. Every work group keeps pulling batches of rays
+// until the queue is drained, marches each ray for at most uStepsPerWave steps
+// and appends the unfinished ones to the output queue. The host swaps queues
+// between waves, so every wave works on a densely packed set of live rays.
+
+#include "scene.c"
+
+#define GROUP_SIZE 64
+#define TILE_SIZE 8	// TILE_SIZE * TILE_SIZE == GROUP_SIZE
+
+layout(local_size_x = GROUP_SIZE) in;
+
+struct RayState
+{
+	vec4 march;		// t, overstep, phx, steps
+	uvec4 pixel;	// x, y
+};
+
+layout(std430, binding = 2) readonly buffer RayQueueIn
+{
+	RayState raysIn[];
+};
+
+layout(std430, binding = 3) writeonly buffer RayQueueOut
+{
+	RayState raysOut[];
+};
+
+layout(std430, binding = 4) buffer RayCounters
+{
+	uint rayCount[2];	// live rays in each queue
+	uint cursor;		// next ray to pick up in the current wave
+};
+
+layout(rgba32f, binding = 0) uniform writeonly image2D hitMap;	// t, material, steps
+
+uniform int uWave;			// 0 - generate primary rays in tile order
+uniform int uLastWave;		// 1 - flush every ray regardless of its state
+uniform int uQueueIn;		// index of the input queue counter
+uniform int uStepsPerWave;
+
+shared uint s_base;
+
+uvec2 tilePixel(uint index)
+{
+	uint tilesX = (uint(iResolution.x) + TILE_SIZE - 1) / TILE_SIZE;
+	uint tile = index / GROUP_SIZE;
+	uint local = index % GROUP_SIZE;
+
+	return uvec2(
+		(tile % tilesX) * TILE_SIZE + local % TILE_SIZE,
+		(tile / tilesX) * TILE_SIZE + local / TILE_SIZE);
+}
+
+void traceRay(uint index)
+{
+	RayState rs;
+
+	if (uWave == 0)
+	{
+		rs.pixel.xy = tilePixel(index);
+		if (rs.pixel.x >= uint(iResolution.x) || rs.pixel.y >= uint(iResolution.y))
+			return;
+	}
+	else
+		rs = raysIn[index];
+
+	uvec2 pixel = rs.pixel.xy;
+
+	tileSelect(ivec2(pixel));
+	vec3 rd = cameraRay(vec2(pixel) + 0.5);
+	tileRangeSelect(ivec2(pixel), rd);
+
+	March m = marchBegin();
+	if (uWave != 0)
+	{
+		m.t = rs.march.x;
+		m.overstep = rs.march.y;
+		m.phx = rs.march.z;
+		m.i = int(rs.march.w);
+	}
+
+	for (int s = 0; s < uStepsPerWave && marchActive(m); s++)
+		marchStep(ro, rd, m);
+
+	if (uLastWave == 0 && marchActive(m))
+	{
+		uint slot = atomicAdd(rayCount[1 - uQueueIn], 1u);
+		raysOut[slot] = RayState(vec4(m.t, m.overstep, m.phx, float(m.i)), uvec4(pixel, 0u, 0u));
+	}
+	else
+		imageStore(hitMap, ivec2(pixel), vec4(marchResult(m), float(m.i), 1.0));
+}
+
+void main()
+{
+	uint total = uWave == 0
+		? ((uint(iResolution.x) + TILE_SIZE - 1) / TILE_SIZE) * ((uint(iResolution.y) + TILE_SIZE - 1) / TILE_SIZE) * GROUP_SIZE
+		: rayCount[uQueueIn];
+
+	for (;;)
+	{
+		barrier();
+		if (gl_LocalInvocationIndex == 0)
+			s_base = atomicAdd(cursor, uint(GROUP_SIZE));
+		barrier();
+
+		uint base = s_base;
+		if (base >= total)
+			break;
+
+		uint index = base + gl_LocalInvocationIndex;
+		if (index < total)
+			traceRay(index);
+	}
+}
@@ -0,0 +1,91 @@
+﻿#version 430
+
+// Rain around the camera stepped against the same map() the marchers draw.
+// The state ping-pongs between two buffers and never goes back to the host.
+
+#include "scene.c"
+#include "particles.c"
+
+#define GROUP_SIZE 256
+
+layout(local_size_x = GROUP_SIZE) in;
+
+layout(std430, binding = 6) readonly buffer ParticlesIn
+{
+	Particle particlesIn[];
+};
+
+layout(std430, binding = 7) writeonly buffer ParticlesOut
+{
+	Particle particlesOut[];
+};
+
+uniform int uParticleCount;
+uniform float uDelta;
+uniform vec4 uEmitter;	// center, radius of the rain disc
+uniform uint uFrame;	// step counter, 0 spreads the first generation over the whole fall
+uniform int uResetClearance;	// 1 - the scene or the sculpt changed, the cached clearances are void
+
+float hash(uint n)
+{
+	n = (n << 13u) ^ n;
+	n = n * (n * n * 15731u + 789221u) + 1376312589u;
+	return float(n & 0x7fffffffu) / float(0x7fffffff);
+}
+
+Particle spawn(uint id)
+{
+	uint seed = id * 4u + uFrame * 0x9e3779b9u;
+	float a = 6.2831853 * hash(seed);
+	float r = uEmitter.w * sqrt(hash(seed + 1u));
+
+	float life = uFrame == 0u ? PARTICLE_LIFE * hash(seed + 2u) : PARTICLE_LIFE;
+	vec3 pos = uEmitter.xyz + vec3(r * cos(a), PARTICLE_HEIGHT * (0.5 + 0.5 * hash(seed + 3u)), r * sin(a));
+
+	return Particle(vec4(pos, life), vec4(0.0, -2.0, 0.0, 0.0));
+}
+
+void main()
+{
+	uint id = gl_GlobalInvocationID.x;
+	if (id >= uint(uParticleCount))
+		return;
+
+	Particle p = particlesIn[id];
+
+	p.pos.w -= uDelta;
+	if (p.pos.w <= 0.0)
+	{
+		particlesOut[id] = spawn(id);
+		return;
+	}
+
+	p.vel.y -= PARTICLE_GRAVITY * uDelta;
+	vec3 move = p.vel.xyz * uDelta;
+	vec3 pos = p.pos.xyz + move;
+
+	// only the static scene is cached, mapStatic() is evaluated once the clearance of the
+	// last evaluation is used up; the bodies move and are measured every step
+	float clearance = uResetClearance != 0 ? 0.0 : p.vel.w - length(move);
+	if (clearance < PARTICLE_RADIUS)
+		clearance = mapStatic(pos).x;
+
+	float d = min(clearance, mapBodies(pos));
+
+	// a second pass resolves corners where the nearest surface changes
+	for (int k = 0; k < 2 && d < PARTICLE_RADIUS; k++)
+	{
+		vec3 nor = calcNormal(pos);
+		float vn = dot(p.vel.xyz, nor);
+
+		pos += nor * (PARTICLE_RADIUS - d);	// back onto the surface
+		if (vn < 0.0)
+			p.vel.xyz -= (1.0 + PARTICLE_RESTITUTION) * vn * nor;
+
+		p.pos.w = min(p.pos.w, PARTICLE_SPLASH_LIFE);
+		clearance = mapStatic(pos).x;
+		d = min(clearance, mapBodies(pos));
+	}
+
+	particlesOut[id] = Particle(vec4(pos, p.pos.w), vec4(p.vel.xyz, clearance));
+}
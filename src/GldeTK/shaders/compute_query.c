@@ -0,0 +1,73 @@
+﻿#version 430
+
+// Physics queries against the scene the marchers draw, batched by the host
+// and read back a frame later (PhysicsQueries).
+
+#include "scene.c"
+
+#define GROUP_SIZE 64
+
+layout(local_size_x = GROUP_SIZE) in;
+
+const int QUERY_RAY = 0;
+const int QUERY_POINT = 1;
+
+struct Query
+{
+	vec4 origin;	// ray origin or point, type
+	vec4 dir;		// ray direction
+};
+
+layout(std430, binding = 8) readonly buffer Queries
+{
+	Query queries[];
+};
+
+layout(std430, binding = 9) writeonly buffer Results
+{
+	vec4 results[];	// distance, normal
+};
+
+uniform int uQueryCount;
+
+// CastRay of Physics, the same steps and hit distance so both sides agree on a hit
+const int PHYS_RAY_MAX_STEPS = 16;		// Const.PHYS_RAY_MAX_STEPS
+const float PHYS_RAY_MIN_DIST = 0.1;	// Const.PHYS_RAY_MIN_DIST
+const float PHYS_RAY_MAX_DIST = 100.0;	// Const.PHYS_RAY_MAX_DIST
+
+float physRay(in vec3 ro, in vec3 rd)
+{
+	float t = 0.0;
+
+	for (int i = 0; i < PHYS_RAY_MAX_STEPS; i++)
+	{
+		float h = map(ro + rd * t).x;
+		t += h;
+
+		if (h < PHYS_RAY_MIN_DIST || t > PHYS_RAY_MAX_DIST)
+			break;
+	}
+
+	return t;
+}
+
+void main()
+{
+	uint i = gl_GlobalInvocationID.x;
+	if (i >= uint(uQueryCount))
+		return;
+
+	Query q = queries[i];
+	vec3 pos = q.origin.xyz;
+	float d;
+
+	if (int(q.origin.w) == QUERY_RAY)
+	{
+		d = physRay(pos, q.dir.xyz);
+		pos += q.dir.xyz * d;
+	}
+	else
+		d = map(pos).x;
+
+	results[i] = vec4(d, calcNormal(pos));
+}
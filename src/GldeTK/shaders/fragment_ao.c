@@ -0,0 +1,21 @@
+﻿#version 330 core
+
+// Ambient occlusion pass of the deferred path, one fragment per AO texel
+
+#include "scene.c"
+#include "gbuffer.c"
+
+void main(void)
+{
+	ivec2 pixel = occlusionSource(ivec2(gl_FragCoord.xy));
+	vec3 pos, nor;
+
+	float occ = 1.0;
+	if (gbufferSurface(pixel, pos, nor))
+	{
+		tileSelect(pixel);
+		occ = occlusion(pos, nor);
+	}
+
+	gl_FragData[0] = vec4(occ);
+}
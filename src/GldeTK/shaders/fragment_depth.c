@@ -0,0 +1,8 @@
+﻿#version 330 core
+
+// Depth prepass of MeshPass, the color targets are masked and the lighting runs only
+// for the fragments left in front
+
+void main(void)
+{
+}
@@ -0,0 +1,23 @@
+﻿#version 330 core
+
+// March pass of the deferred path: only the hit and its normal are stored,
+// the lighting passes read them back in screen order.
+
+#include "scene.c"
+#include "gbuffer.c"
+
+void main(void)
+{
+	tileSelect(ivec2(gl_FragCoord.xy));
+
+	vec3 rd = cameraRay(gl_FragCoord.xy);
+	tileRangeSelect(ivec2(gl_FragCoord.xy), rd);
+
+	vec2 res = castRay(ro, rd);
+
+	// the sky faces the camera, its lighting is all fog anyway
+	vec3 nor = res.x < MARCH_MAX_DIST ? calcNormal(ro + res.x * rd) : -rd;
+
+	gl_FragData[0] = vec4(res, 0.0, 1.0);
+	gl_FragData[1] = vec4(packNormal(nor), 0.0, 1.0);
+}
@@ -0,0 +1,27 @@
+﻿#version 330 core
+
+// Glyphs of the HudFont atlas and solid rectangles, alpha blended over the frame
+
+#define CELL ivec2(6, 8)	// HudFont.CELL_WIDTH, CELL_HEIGHT
+#define COLUMNS 16			// HudFont.ATLAS_COLUMNS
+
+uniform sampler2D uAtlas;
+
+in vec2 vCell;
+flat in int vGlyph;
+flat in vec4 vColor;
+
+out vec4 fragColor;
+
+void main()
+{
+	float coverage = 1.0;
+
+	if (vGlyph >= 0)
+	{
+		ivec2 cell = ivec2(vGlyph % COLUMNS, vGlyph / COLUMNS) * CELL;
+		coverage = texelFetch(uAtlas, cell + min(ivec2(vCell), CELL - 1), 0).r;
+	}
+
+	fragColor = vec4(vColor.rgb, vColor.a * coverage);
+}
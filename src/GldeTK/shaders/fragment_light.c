@@ -0,0 +1,21 @@
+﻿#version 330 core
+
+// Lighting pass of the deferred path: no map() at all, every term
+// comes from the G-buffer and the upsampled shadow and occlusion targets.
+
+#include "scene.c"
+#include "gbuffer.c"
+
+void main(void)
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+
+	vec3 rd = cameraRay(gl_FragCoord.xy);
+	float t = texelFetch(gSurface, pixel, 0).x;
+	vec3 nor = unpackNormal(texelFetch(gNormal, pixel, 0).xy);
+	vec2 occlusion = occlusionUpsample(pixel, rd, t, nor);
+
+	gl_FragData[0] = vec4(tint(light(rd, t, nor, occlusion.x, occlusion.y)), 1.0);
+	gl_FragData[1] = vec4(t);
+	gl_FragDepth = rayDepth(rd, t);
+}
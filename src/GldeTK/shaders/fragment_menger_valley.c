@@ -7,6 +7,9 @@ uniform vec3 CamTa;
 
 varying vec2 fragCoord;
 
+#include "lipschitz.c"
+#include "operators.c"
+
 // Created by inigo quilez - iq/2013
 // License Creative Commons Attribution-NonCommercial-ShareAlike 3.0 Unported License.
 
@@ -173,34 +176,6 @@ vec3 opTwist(vec3 p)
 }
 
 //----------------------------------------------------------------------
-float ScherkDe(vec3 p)
-{
-	float Ex = exp(p.x);
-	float Ey = exp(p.y);
-	float zz = Ex*Ey;
-	float N = Ex*Ex + Ey*Ey;
-	float D = 1.0 + zz*zz;
-	zz = 4.0*sin(p.z)*zz; // can be + or - or change 4 to get elliptic holes
-	if (zz>0.0) N += zz; else D -= zz; // we bring it to the correct eq side :)
-	return abs(log(N / D)) - 0.05; // give it a little thickness so it renders better
-}
-
-float kTower(vec3 p)
-{
-	float z = p.z;
-	float t = 1.5*atan(p.y, p.x);
-	float u = sqrt(p.x*p.x + p.y*p.y);
-	float x = sin(t)*u;
-	float y = cos(t)*u;
-	float ex = exp(x);
-	float ey = exp(y);
-	float zz = ex*ey;
-	float n = ex*ex + ey*ey;
-	float d = 1.0 + zz*zz;
-	zz = 4.0*sin(p.z)*zz;
-	if (zz>0.0) n = n + zz; else d = d - zz;
-	return abs(log(n / d)) - 0.05;
-}
 
 float menger(in vec3 p)
 {
@@ -247,21 +222,6 @@ float fBlob(vec3 p) {
 	return l - 1.5 - 0.2 * (1.5 / 2.)* cos(min(sqrt(1.01 - b / l)*(PI / 0.25), PI));
 }
 
-float sdPlaneSin(vec3 p)
-{
-	return p.y + cos(p.x - iGlobalTime * 0.1) * sin(p.z - iGlobalTime * 0.1) * 0.3;
-}
-
-float fOpUnionRound(float a, float b, float r) {
-	vec2 u = max(vec2(r - a, r - b), vec2(0));
-	return max(r, min(a, b)) - length(u);
-}
-
-float fOpUnionSoft(float a, float b, float r) {
-	float e = max(r - abs(a - b), 0.);
-	return min(a, b) - e*e*0.25 / r;
-}
-
 float mbox(vec3 p)
 {
 	const int iterations = 10;
@@ -392,7 +352,7 @@ vec2 map(in vec3 pos)
 	//vec2 res = vec2(mbox(pos), 15.0);
 
 	/// blob
-	//vec2 res = vec2(sdPlaneSin(pos), 1.0);
+	//vec2 res = vec2(sdPlaneSinBound(pos), 1.0);
 	//res =
 	//	opU(res, vec2(
 	//		fBlob(pos - vec3(0.0, 2.0, 0.0)) + sin(iGlobalTime) * 0.4, 49.0));
@@ -401,8 +361,12 @@ vec2 map(in vec3 pos)
 	vec3 repp = opRep(vec3(pos.x - 5, pos.y - iGlobalTime * 0.5, pos.z - 5), vec3(23));
 	float blob = sdSphere(repp, 1.5);
 
-	vec2 res = vec2(sdPlaneSin(pos), 1.0);
-	res = opU(res, vec2(menger(vec3(pos.x, pos.y - sin(iGlobalTime) * 0.02, pos.z)), 15.0));
+	vec2 res = vec2(sdPlaneSinBound(pos), 1.0);
+
+	// the sponge is carved out of its box, no iteration runs where the box is behind the ground
+	vec3 mpos = vec3(pos.x, pos.y - sin(iGlobalTime) * 0.02, pos.z);
+	if (!fOpUnionFar(res.x, sdBox(opRep(mpos, vec3(10)), vec3(2)), 0.0))
+		res = opU(res, vec2(menger(mpos), 15.0));
 
 	res.x = fOpUnionSoft(res.x, blob, 2.0);
 
@@ -437,7 +401,7 @@ vec2 map(in vec3 pos)
 	//res = opU(res, vec2(sdCylinder6(pos - vec3(1.0, 0.30, 2.0), vec2(0.1, 0.2)), 12.0));
 	//res = opU(res, vec2(sdHexPrism(pos - vec3(-1.0, 0.20, 1.0), vec2(0.25, 0.05)), 17.0));
 
-	////res = opU(res, vec2(kTower(pos - vec3(10.0, -1.0, 10.0)), 41.0));
+	////res = opU(res, vec2(kTowerBound(pos - vec3(10.0, -1.0, 10.0)), 41.0));
 	//
 	//res = opU(res, vec2(opS(
 	//	udRoundBox(pos - vec3(-2.0, 0.2, 1.0), vec3(0.15), 0.05),
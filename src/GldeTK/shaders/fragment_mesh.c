@@ -0,0 +1,23 @@
+﻿#version 330 core
+
+// Rasterized elements lit like the marched surfaces, into the same targets of FrameCache
+
+#include "scene.c"
+
+in vec3 vPos;
+in vec3 vNormal;
+flat in int vElement;
+
+void main(void)
+{
+	vec3 nor = normalize(vNormal);
+	vec3 v = vPos - ro;
+	float t = length(v);
+	vec3 rd = v / t;
+
+	// the facets cut below the curved surfaces, shadow rays start on the element itself
+	vec3 pos = vPos - nor * sdElement(vElement, vPos);
+
+	gl_FragData[0] = vec4(tint(light(rd, t, nor, shadow(pos, nor), 1.0)), 1.0);
+	gl_FragData[1] = vec4(t);
+}
@@ -0,0 +1,24 @@
+﻿#version 430
+
+// Particles composited over the presented frame, hidden where the scene is closer
+
+#include "scene.c"
+
+uniform sampler2D sceneDistance;	// ray distance of the marched image, FrameCache
+
+in float vDistance;
+
+out vec4 fragColor;
+
+void main(void)
+{
+	vec2 c = 2.0 * gl_PointCoord - 1.0;
+
+	if (dot(c, c) > 1.0 || vDistance > texelFetch(sceneDistance, ivec2(gl_FragCoord.xy), 0).x)
+		discard;
+
+	vec3 col = vec3(0.6, 0.7, 0.9);
+	col = mix(col, vec3(0.8, 0.9, 1.0), 1.0 - exp(-0.002 * vDistance * vDistance));	// fog of shade()
+
+	fragColor = vec4(tint(col), 1.0);
+}
@@ -5,7 +5,7 @@ uniform vec3 iResolution;
 uniform vec3 ro;	// camera ray origin
 uniform mat3 camProj;	// camera projection matrix
 
-uniform SdElements
+layout(std140) uniform SdElements
 {
 	vec4 g_map[256];
 };
@@ -5,21 +5,44 @@ uniform vec3 iResolution;
 uniform vec3 ro;	// camera ray origin
 uniform mat3 camProj;	// camera projection matrix
 
-uniform SdElements
+layout(std140) uniform SdElements
 {
 	vec4 g_map[256];
 };
 
 varying vec2 fragCoord;
 
-float ScherkDe(vec3 p)
- {
-  float Ex=exp(p.x); float Ey=exp(p.y); float zz=Ex*Ey;
-  float N = Ex*Ex+Ey*Ey;
-  float D = 1.0+zz*zz;
-  zz = 4.0*sin(p.z)*zz; // can be + or - or change 4 to get elliptic holes
-  if (zz>0.0) N += zz; else D -= zz; // we bring it to the correct eq side :)
-  return abs(log(N/D))-0.05; // give it a little thickness so it renders better
+#define LIPSCHITZ_MODE LIPSCHITZ_LOCAL
+#include "lipschitz.c"
+
+const float SCHERK_FOLD = 2.0;
+
+// ScherkDe over the sin folded domain, scaled back
+float scherkSin(vec3 p)
+{
+	return ScherkDe(vec3(SCHERK_FOLD * sin(p.xy), p.z)) / SCHERK_FOLD;
+}
+
+// Slope bound of scherkSin within distance r of p. The fold scales x and y
+// by |cos|, which grows by at most r over that distance.
+float scherkSinLipschitz(vec3 p, float r)
+{
+	vec2 c = min(abs(cos(p.xy)) + r, 1.0);
+	return LIP_SCHERK_AXIS * length(vec3(c, 1.0 / SCHERK_FOLD));
+}
+
+float scherkSinBound(vec3 p)
+{
+	float d = scherkSin(p);
+
+#if LIPSCHITZ_MODE == LIPSCHITZ_GLOBAL
+	return d / scherkSinLipschitz(p, 1.0);
+#elif LIPSCHITZ_MODE == LIPSCHITZ_LOCAL
+	// a safe step is shorter than d / L(0), so the bound over that ball holds for it
+	return d / scherkSinLipschitz(p, abs(d) / scherkSinLipschitz(p, 0.0));
+#else
+	return lipGradientBound(d, LIP_SLOPE(scherkSin, p), scherkSinLipschitz(p, 1.0));
+#endif
 }
 
 float sdPlaneY(vec3 p)
@@ -64,11 +87,9 @@ vec3 opRep(vec3 p, vec3 c)
 
 vec2 map( in vec3 pos )
 {
+	vec2 res = vec2(scherkSinBound(pos), 45.0);
 
-    float k = 2.0;
-    vec2 res = vec2(ScherkDe(vec3(k*sin(pos.x), k*sin(pos.y), pos.z))/k,45.0);
-    
-    return res;
+	return res;
 }
 
 vec2 castRay(in vec3 ro, in vec3 rd)
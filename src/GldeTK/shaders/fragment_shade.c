@@ -0,0 +1,22 @@
+﻿#version 330 core
+
+// Shading pass of the compute marcher: the march is already done,
+// only the lighting of fragment.c is applied to the stored hits.
+
+#include "scene.c"
+
+uniform sampler2D hitMap;	// t, material, steps
+
+void main(void)
+{
+	tileSelect(ivec2(gl_FragCoord.xy));
+
+	vec3 rd = cameraRay(gl_FragCoord.xy);
+	vec2 res = texelFetch(hitMap, ivec2(gl_FragCoord.xy), 0).xy;
+
+	vec3 col = shade(ro, rd, res);
+
+	gl_FragData[0] = vec4(tint(col), 1.0);
+	gl_FragData[1] = vec4(res.x);
+	gl_FragDepth = rayDepth(rd, res.x);
+}
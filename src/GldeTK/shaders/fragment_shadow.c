@@ -0,0 +1,21 @@
+﻿#version 330 core
+
+// Shadow pass of the deferred path, one fragment per shadow texel
+
+#include "scene.c"
+#include "gbuffer.c"
+
+void main(void)
+{
+	ivec2 pixel = occlusionSource(ivec2(gl_FragCoord.xy));
+	vec3 pos, nor;
+
+	float sha = 1.0;
+	if (gbufferSurface(pixel, pos, nor))
+	{
+		tileSelect(pixel);
+		sha = shadow(pos, nor);
+	}
+
+	gl_FragData[0] = vec4(sha);
+}
@@ -0,0 +1,18 @@
+﻿#version 330 core
+
+// Shadow map pass, ShadowMap.cs: one ray per texel from the plane above
+// the map center down along the light, iResolution is the map size.
+// The hit keeps its softshadow(), the ray towards the light is the same line.
+
+#include "scene.c"
+
+void main(void)
+{
+	vec3 origin = shadowMapOrigin(gl_FragCoord.xy / iResolution.xy);
+	vec3 lig = g_shadowLight.xyz;
+
+	float t = castRay(origin, -lig).x;
+	float sha = t < MARCH_MAX_DIST ? softshadow(origin - lig * t, lig) : 1.0;
+
+	gl_FragData[0] = vec4(t, sha, 0.0, 1.0);
+}
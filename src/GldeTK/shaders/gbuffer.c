@@ -0,0 +1,97 @@
+﻿// G-buffer of the deferred path, DeferredShading.cs. Include it after scene.c.
+
+uniform sampler2D gSurface;		// t, material of the primary ray
+uniform sampler2D gNormal;		// octahedral normal
+uniform sampler2D gShadow;		// shadow() towards g_light, 1 / uOcclusionScale resolution
+uniform sampler2D gOcclusion;	// occlusion(), same resolution
+uniform int uOcclusionScale;	// 1, 2, 4 - G-buffer pixels per shadow and AO texel
+
+const float UPSAMPLE_PLANE_TOLERANCE = 0.02;	// distance from the tangent plane per ray distance
+const float UPSAMPLE_NORMAL_POWER = 8.0;
+
+vec2 signNotZero(in vec2 v)
+{
+	return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Unit vector to two components, octahedral mapping
+vec2 packNormal(in vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signNotZero(n.xy);
+}
+
+vec3 unpackNormal(in vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+	return normalize(n);
+}
+
+// Surface point of the pixel, false when the primary ray left the scene
+bool gbufferSurface(in ivec2 pixel, out vec3 pos, out vec3 nor)
+{
+	float t = texelFetch(gSurface, pixel, 0).x;
+
+	pos = ro + t * cameraRay(vec2(pixel) + 0.5);
+	nor = unpackNormal(texelFetch(gNormal, pixel, 0).xy);
+
+	return t < MARCH_MAX_DIST;
+}
+
+// G-buffer pixel a shadow and AO texel is computed for, the center of its block
+ivec2 occlusionSource(in ivec2 texel)
+{
+	return min(texel * uOcclusionScale + uOcclusionScale / 2, ivec2(iResolution.xy) - 1);
+}
+
+// Shadow and AO of a G-buffer pixel: joint bilateral upsampling of the nearest four texels,
+// texels of other surfaces (off the tangent plane or turned away) are left out so edges do not bleed
+vec2 occlusionUpsample(in ivec2 pixel, in vec3 rd, in float t, in vec3 nor)
+{
+	if (uOcclusionScale == 1)
+		return vec2(texelFetch(gShadow, pixel, 0).x, texelFetch(gOcclusion, pixel, 0).x);
+
+	if (t >= MARCH_MAX_DIST)
+		return vec2(1.0);
+
+	ivec2 size = textureSize(gShadow, 0);
+	vec2 p = (vec2(pixel) + 0.5) / float(uOcclusionScale) - 0.5;
+	ivec2 base = ivec2(floor(p));
+	vec2 f = p - vec2(base);
+
+	vec2 sum = vec2(0.0);
+	float weight = 0.0;
+	vec3 pos = ro + t * rd;
+	vec2 nearest = vec2(1.0);
+	float nearestPlane = MARCH_MAX_DIST;
+
+	for (int i = 0; i < 4; i++)
+	{
+		ivec2 o = ivec2(i & 1, i >> 1);
+		ivec2 texel = clamp(base + o, ivec2(0), size - 1);
+		ivec2 source = occlusionSource(texel);
+
+		vec3 ps, ns;
+		gbufferSurface(source, ps, ns);
+		vec2 value = vec2(texelFetch(gShadow, texel, 0).x, texelFetch(gOcclusion, texel, 0).x);
+
+		float plane = abs(dot(ps - pos, nor));
+		float w = (o.x == 1 ? f.x : 1.0 - f.x) * (o.y == 1 ? f.y : 1.0 - f.y)
+			* max(0.0, 1.0 - plane / (UPSAMPLE_PLANE_TOLERANCE * t))
+			* pow(max(dot(ns, nor), 0.0), UPSAMPLE_NORMAL_POWER);
+
+		sum += value * w;
+		weight += w;
+
+		if (plane < nearestPlane)
+		{
+			nearestPlane = plane;
+			nearest = value;
+		}
+	}
+
+	// no texel on this surface, thinner than a texel
+	return weight > 1e-4 ? sum / weight : nearest;
+}
@@ -0,0 +1,104 @@
+﻿// Non-metric fields and their Lipschitz bounds. A field f with |grad f| <= L
+// guarantees only f / L of empty space around a point, so that is the distance
+// bound handed to the marcher. Metric SDFs have L = 1 and need nothing, so
+// every primitive keeps its own bound and unions stay plain min().
+//
+// LIPSCHITZ_MODE picks how L is found, define it before the include:
+//   LIPSCHITZ_GLOBAL   - one constant per field, always safe
+//   LIPSCHITZ_LOCAL    - slope of the domain warp around the point, safe, longer steps
+//   LIPSCHITZ_GRADIENT - measured slope of the field, fewest steps, may overshoot
+//
+// Needs iGlobalTime declared before the include.
+
+#define LIPSCHITZ_GLOBAL 0
+#define LIPSCHITZ_LOCAL 1
+#define LIPSCHITZ_GRADIENT 2
+
+#ifndef LIPSCHITZ_MODE
+#define LIPSCHITZ_MODE LIPSCHITZ_LOCAL
+#endif
+
+const float LIP_SCHERK_AXIS = 2.0;		// every partial of ScherkDe is within [-2, 2]
+const float LIP_SCHERK = 3.4641;		// 2 sqrt(3)
+const float LIP_KTOWER = 4.6904;		// polar warp stretches arcs 1.5x: sqrt((1.5 * 2 sqrt(2))^2 + 2^2)
+const float LIP_PLANE_SIN = 1.0440;		// sqrt(1 + 0.3^2)
+
+const float LIP_GRADIENT_EPS = 0.001;
+const float LIP_GRADIENT_MARGIN = 1.25;	// the slope ahead of the point is unknown
+
+// Slope of the field f at p, central differences
+#define LIP_DIFF(f, p, e) (f((p) + (e)) - f((p) - (e)))
+#define LIP_SLOPE(f, p) (length(vec3(LIP_DIFF(f, p, vec3(LIP_GRADIENT_EPS, 0.0, 0.0)), LIP_DIFF(f, p, vec3(0.0, LIP_GRADIENT_EPS, 0.0)), LIP_DIFF(f, p, vec3(0.0, 0.0, LIP_GRADIENT_EPS)))) / (2.0 * LIP_GRADIENT_EPS))
+
+// Distance bound from a measured slope, never worse than the global bound L
+float lipGradientBound(float d, float slope, float L)
+{
+	return d / clamp(slope * LIP_GRADIENT_MARGIN, 1.0, L);
+}
+
+//----------------------------------------------------------------------
+
+float ScherkDe(vec3 p)
+{
+	float Ex = exp(p.x);
+	float Ey = exp(p.y);
+	float zz = Ex*Ey;
+	float N = Ex*Ex + Ey*Ey;
+	float D = 1.0 + zz*zz;
+	zz = 4.0*sin(p.z)*zz; // can be + or - or change 4 to get elliptic holes
+	if (zz>0.0) N += zz; else D -= zz; // we bring it to the correct eq side :)
+	return abs(log(N / D)) - 0.05; // give it a little thickness so it renders better
+}
+
+// NOTE: atan() jumps across the negative x axis, the tower has a seam there
+float kTower(vec3 p)
+{
+	float z = p.z;
+	float t = 1.5*atan(p.y, p.x);
+	float u = sqrt(p.x*p.x + p.y*p.y);
+	float x = sin(t)*u;
+	float y = cos(t)*u;
+	float ex = exp(x);
+	float ey = exp(y);
+	float zz = ex*ey;
+	float n = ex*ex + ey*ey;
+	float d = 1.0 + zz*zz;
+	zz = 4.0*sin(p.z)*zz;
+	if (zz>0.0) n = n + zz; else d = d - zz;
+	return abs(log(n / d)) - 0.05;
+}
+
+float sdPlaneSin(vec3 p)
+{
+	return p.y + cos(p.x - iGlobalTime * 0.1) * sin(p.z - iGlobalTime * 0.1) * 0.3;
+}
+
+//----------------------------------------------------------------------
+
+float ScherkBound(vec3 p)
+{
+	float d = ScherkDe(p);
+
+#if LIPSCHITZ_MODE == LIPSCHITZ_GRADIENT
+	return lipGradientBound(d, LIP_SLOPE(ScherkDe, p), LIP_SCHERK);
+#else
+	return d / LIP_SCHERK;
+#endif
+}
+
+float kTowerBound(vec3 p)
+{
+	float d = kTower(p);
+
+#if LIPSCHITZ_MODE == LIPSCHITZ_GRADIENT
+	return lipGradientBound(d, LIP_SLOPE(kTower, p), LIP_KTOWER);
+#else
+	return d / LIP_KTOWER;
+#endif
+}
+
+// the slope hardly changes, 1.044 is already within 5% of the local bound
+float sdPlaneSinBound(vec3 p)
+{
+	return sdPlaneSin(p) / LIP_PLANE_SIN;
+}
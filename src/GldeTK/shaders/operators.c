@@ -0,0 +1,92 @@
+﻿// Blending operators of two distances and the bounds that let an operand be skipped.
+// Union, difference (a minus b) and intersection, each in four blends r wide:
+//   Round   - quarter circle fillet, hg_sdf
+//   Soft    - quadratic, union only, hg_sdf
+//   Chamfer - 45 degree bevel, hg_sdf
+//   Smooth  - polynomial smooth minimum, iq
+// A blend changes the result only where both operands are within r of it, so an operand
+// whose lower bound (a bounding volume, Lipschitz bound) is far enough cannot matter and is
+// not evaluated at all. Evaluate the cheap operand first, test the expensive one's bound:
+//
+//   float d = fOpUnionFar(a, sdSphere(p - c, R), r) ? a : fOpUnionRound(a, expensive(p), r);
+//
+// Metric inputs only, the bounds hold for r >= 0. SdOperators.cs is the CPU side.
+
+const float OP_SQRT_HALF = 0.70710678;
+
+//----------------------------------------------------------------------
+
+float fOpUnionRound(float a, float b, float r)
+{
+	vec2 u = max(vec2(r - a, r - b), vec2(0.0));
+	return max(r, min(a, b)) - length(u);
+}
+
+float fOpUnionSoft(float a, float b, float r)
+{
+	float e = max(r - abs(a - b), 0.0);
+	return min(a, b) - e * e * 0.25 / r;
+}
+
+float fOpUnionChamfer(float a, float b, float r)
+{
+	return min(min(a, b), (a - r + b) * OP_SQRT_HALF);
+}
+
+float fOpUnionSmooth(float a, float b, float r)
+{
+	float h = clamp(0.5 + 0.5 * (b - a) / r, 0.0, 1.0);
+	return mix(b, a, h) - r * h * (1.0 - h);
+}
+
+float fOpIntersectionRound(float a, float b, float r)
+{
+	vec2 u = max(vec2(r + a, r + b), vec2(0.0));
+	return min(-r, max(a, b)) + length(u);
+}
+
+float fOpIntersectionChamfer(float a, float b, float r)
+{
+	return max(max(a, b), (a + r + b) * OP_SQRT_HALF);
+}
+
+float fOpIntersectionSmooth(float a, float b, float r)
+{
+	return -fOpUnionSmooth(-a, -b, r);
+}
+
+float fOpDifferenceRound(float a, float b, float r)
+{
+	return fOpIntersectionRound(a, -b, r);
+}
+
+float fOpDifferenceChamfer(float a, float b, float r)
+{
+	return fOpIntersectionChamfer(a, -b, r);
+}
+
+float fOpDifferenceSmooth(float a, float b, float r)
+{
+	return -fOpUnionSmooth(-a, b, r);
+}
+
+//----------------------------------------------------------------------
+
+// Every union of a with b is exactly a when b >= bBound is this far, r = 0 is min()
+bool fOpUnionFar(float a, float bBound, float r)
+{
+	return bBound >= max(a, 0.0) + r;
+}
+
+// Every difference a minus b is exactly a when b >= bBound is this far, r = 0 is max(a, -b)
+bool fOpDifferenceFar(float a, float bBound, float r)
+{
+	return bBound >= max(-a, 0.0) + r;
+}
+
+// Every intersection of a with b is at least bBound, a safe distance though not the exact
+// one, which is what a marcher needs away from the surface
+bool fOpIntersectionFar(float a, float bBound, float r)
+{
+	return bBound >= max(a, 0.0) + r;
+}
@@ -0,0 +1,16 @@
+﻿// Particle state shared by compute_particles.c and the particle draw pass.
+// Include it after scene.c.
+
+struct Particle
+{
+	vec4 pos;	// xyz, remaining life
+	vec4 vel;	// xyz, clearance - lower bound of mapStatic() at pos
+};
+
+const float PARTICLE_RADIUS = 0.03;
+const float PARTICLE_RESTITUTION = 0.3;
+const float PARTICLE_LIFE = 4.0;		// s
+const float PARTICLE_SPLASH_LIFE = 0.3;	// s, left after the first contact
+const float PARTICLE_HEIGHT = 12.0;		// rain starts above the emitter
+const float PARTICLE_GRAVITY = 9.8;
+const float PARTICLE_MAX_POINT = 4.0;	// pixels
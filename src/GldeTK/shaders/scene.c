@@ -0,0 +1,777 @@
+﻿// Scene shared by every render path: the fullscreen fragment marcher,
+// the compute marcher and its shading pass. Include it right after #version.
+
+uniform vec3 iResolution;
+
+// per-frame values computed on the host, FrameParams.cs
+layout(std140) uniform FrameParams
+{
+	mat3 camProj;		// camera projection matrix
+	vec3 ro;			// camera ray origin
+	float iGlobalTime;
+	vec4 g_light;		// xyz - direction to the light
+	vec4 uBodyGrid;		// grid corner, cell size
+	vec2 uJitter;		// subpixel offset of the camera rays, progressive supersampling
+	int uBodyCount;		// dynamic bodies listed in the grid, 0 - none
+	vec4 g_shadowLight;		// xyz - light direction of the shadow map, w - 1 when the map is valid
+	vec4 g_shadowCenter;	// xyz - center of the shadow map, w - half extent
+	vec4 g_aoCache;			// xyz - first cell of the AO cache window, w - generation, 0 - off
+	vec4 g_sculptLo;		// xyz - lowest corner of the Sculpt bricks, w - 1 when there are any
+	vec4 g_sculptHi;		// xyz - highest corner
+};
+
+layout(std140) uniform SdElements
+{
+	vec4 g_map[256];	// [0] scene parameters, [1].x element count, then 2 vec4 per element
+};
+
+uniform int uTileBinning;			// 1 - elements come from the per-tile lists
+uniform usamplerBuffer tileLists;	// written by compute_bin.c
+uniform int uTileCulling;			// 1 - primary rays march only the tile's depth range
+uniform sampler2D tileRanges;		// written by compute_cull.c
+uniform int uRasterElements;		// 1 - primary rays leave the elements to the mesh pass, MeshPass
+uniform samplerBuffer bodies;		// position, radius of RigidBodies
+uniform usamplerBuffer bodyGrid;	// start of every cell list, then the lists, BodyGrid
+uniform sampler2D shadowMap;		// ray distance from the plane of the map, softshadow() of the hit, ShadowMap
+uniform usampler3D aoCache;			// AO of the static scene at the cell corners, AoCache
+uniform sampler3D sculptAtlas;		// 9x9x9 samples of the edited ground per brick, SculptBricks
+uniform usampler3D sculptMap;		// atlas slot + 1 of every brick of the grid, 0 - none
+
+const float MARCH_MAX_DIST = 100.0;
+const float MARCH_MIN_DIST = 0.0002;
+const int MARCH_MAX_STEPS = 100;
+
+const int SD_ELEMENTS_OFFSET = 2;
+const int SD_SPHERE = 0;
+const int SD_BOX = 1;
+const int SD_CYLINDER = 2;
+
+const int BIN_TILE_SIZE = 16;			// pixels
+const int BIN_TILE_HEADER = 4;			// count, unused
+const int BIN_TILE_STRIDE = 128;
+const int BIN_TILE_MAX_ELEMENTS = BIN_TILE_STRIDE - BIN_TILE_HEADER;
+const float BIN_TILE_REACH = 1.0;		// soft shadow penumbra and normal sampling around the surface
+const float BIN_TILE_DEPTH = 50.0;		// binned depth range, farther rays evaluate every element
+const int CULL_SEGMENTS = 64;			// depth slabs per tile, quadratic spacing
+const ivec3 BODY_GRID_CELLS = ivec3(32, 8, 32);
+const float SHADOW_MAP_HEIGHT = 0.5 * MARCH_MAX_DIST;	// ray origins above the center, along the light
+const float SHADOW_MAP_NORMAL_OFFSET = 1.5;				// texels, lookups leave the surface along its normal
+const float SHADOW_MAP_BIAS = 1.0;						// texels
+const float AO_CACHE_CELL = 0.125;
+const ivec3 AO_CACHE_SHIFT = ivec3(8, 6, 8);			// log2 of the cells of the window
+const ivec3 AO_CACHE_CELLS = ivec3(1) << AO_CACHE_SHIFT;
+const uint AO_CACHE_FILLED = 0x80000000u;
+const uint AO_CACHE_STAMP = 0x7fffff00u;				// generation, wrap of the window, below 8 bits of AO
+const float RASTER_NEAR = 0.05;							// depth range of the camera projection
+const float RASTER_FAR = MARCH_MAX_DIST;
+const vec3 SCULPT_ORIGIN = vec3(-64.0, -8.0, -64.0);	// lowest corner of the brick grid
+const ivec3 SCULPT_BRICKS = ivec3(64, 16, 64);
+const int SCULPT_BRICK_CELLS = 8;
+const int SCULPT_SAMPLES = SCULPT_BRICK_CELLS + 1;		// per side of a brick in the atlas
+const float SCULPT_BRICK = 2.0;							// m, 8 cells of 0.25
+const int SCULPT_ATLAS_BRICKS = 16;						// per side of the atlas
+const float SCULPT_MARGIN = 0.5;						// no edit is closer to a point out of the bricks
+
+float sdPlaneY(vec3 p)
+{
+	return p.y;
+}
+
+float sdSphere(vec3 p, float s)
+{
+	return length(p) - s;
+}
+
+float sdBox(vec3 p, vec3 b)
+{
+	vec3 d = abs(p) - b;
+	return min(max(d.x, max(d.y, d.z)), 0.0) + length(max(d, 0.0));
+}
+
+float sdCylinder(vec3 p, float r, float height) {
+	float d = length(p.xz) - r;
+	d = max(d, abs(p.y) - height);
+	return d;
+}
+
+float sdCylinderInf(vec3 p, float r) {
+	return  length(p.xz) - r;
+}
+
+//----------------------------------------------------------------------
+
+float opA(float d1, float d2)
+{
+	return min(d2, d1);
+}
+
+vec3 opRep(vec3 p, vec3 c)
+{
+	return mod(p, c) - 0.5 * c;
+}
+
+//----------------------------------------------------------------------
+
+int elementCount()
+{
+	return int(g_map[1].x);
+}
+
+vec4 elementBounds(int i)	// center, radius
+{
+	return vec4(g_map[SD_ELEMENTS_OFFSET + 2 * i].xyz, g_map[SD_ELEMENTS_OFFSET + 2 * i + 1].w);
+}
+
+float sdElement(int i, vec3 p)
+{
+	vec4 a = g_map[SD_ELEMENTS_OFFSET + 2 * i];		// position, type
+	vec4 b = g_map[SD_ELEMENTS_OFFSET + 2 * i + 1];	// size, bounding radius
+	vec3 q = p - a.xyz;
+	int type = int(a.w);
+
+	if (type == SD_SPHERE)
+		return sdSphere(q, b.x);
+
+	if (type == SD_BOX)
+		return sdBox(q, b.xyz);
+
+	return sdCylinder(q, b.x, b.y);
+}
+
+// Tile of the current pixel, -1 evaluates the full element list
+int g_tileBase = -1;
+vec3 g_tilePlanes[4];
+
+// Set during a primary march only, shadows, AO and normals still see the rasterized elements
+bool g_rasterElements = false;
+
+vec3 cameraRay(in vec2 fragCoord);
+
+// Camera rays through the corners of a tile, counter-clockwise
+void tileCorners(in ivec2 tile, out vec3 corners[4])
+{
+	vec2 p0 = vec2(tile * BIN_TILE_SIZE);
+	vec2 p1 = p0 + float(BIN_TILE_SIZE);
+
+	corners[0] = cameraRay(p0);
+	corners[1] = cameraRay(vec2(p1.x, p0.y));
+	corners[2] = cameraRay(p1);
+	corners[3] = cameraRay(vec2(p0.x, p1.y));
+}
+
+// Inward normals of the side planes of a tile frustum, planes pass through ro
+void tileFrustum(in ivec2 tile, out vec3 planes[4])
+{
+	vec3 c = cameraRay(vec2(tile * BIN_TILE_SIZE) + 0.5 * float(BIN_TILE_SIZE));
+	vec3 d[4];
+	tileCorners(tile, d);
+
+	for (int i = 0; i < 4; i++)
+	{
+		planes[i] = normalize(cross(d[i], d[(i + 1) % 4]));
+		planes[i] *= sign(dot(planes[i], c));
+	}
+}
+
+int tileIndex(in ivec2 tile)
+{
+	int tilesX = (int(iResolution.x) + BIN_TILE_SIZE - 1) / BIN_TILE_SIZE;
+	return tile.y * tilesX + tile.x;
+}
+
+void tileSelect(in ivec2 pixel)
+{
+	if (uTileBinning == 0)
+		return;
+
+	ivec2 tile = pixel / BIN_TILE_SIZE;
+	int base = tileIndex(tile) * BIN_TILE_STRIDE;
+
+	if (texelFetch(tileLists, base).x > uint(BIN_TILE_MAX_ELEMENTS))
+		return;	// overflown tile keeps the full list
+
+	g_tileBase = base;
+	tileFrustum(tile, g_tilePlanes);
+}
+
+float mapElements(in vec3 pos)
+{
+	float d = MARCH_MAX_DIST;
+	if (g_rasterElements)
+		return d;
+
+	vec3 v = pos - ro;
+	float depth = dot(v, camProj[2]);
+
+	if (g_tileBase >= 0
+		&& depth <= BIN_TILE_DEPTH
+		&& dot(v, g_tilePlanes[0]) >= 0.0
+		&& dot(v, g_tilePlanes[1]) >= 0.0
+		&& dot(v, g_tilePlanes[2]) >= 0.0
+		&& dot(v, g_tilePlanes[3]) >= 0.0)
+	{
+		// inside the binned frustum only listed elements are within the reach
+		int n = int(texelFetch(tileLists, g_tileBase).x);
+		for (int k = 0; k < n; k++)
+			d = min(d, sdElement(int(texelFetch(tileLists, g_tileBase + BIN_TILE_HEADER + k).x), pos));
+
+		return d;
+	}
+
+	int n = elementCount();
+	for (int i = 0; i < n; i++)
+		d = min(d, sdElement(i, pos));
+
+	return d;
+}
+
+// Every cell lists the bodies reaching within half a cell of it, so an unlisted
+// body is at least that margin plus the distance to the cell border away.
+float mapBodies(in vec3 pos)
+{
+	if (uBodyCount == 0)
+		return MARCH_MAX_DIST;
+
+	float cell = uBodyGrid.w;
+	float margin = 0.5 * cell;
+	vec3 size = vec3(BODY_GRID_CELLS) * cell;
+	vec3 g = pos - uBodyGrid.xyz;
+
+	// listed bodies keep the margin to the grid border too
+	float outside = sdBox(g - 0.5 * size, 0.5 * size);
+	if (outside > 0.0)
+		return outside + margin;
+
+	ivec3 c = min(ivec3(g / cell), BODY_GRID_CELLS - 1);
+	vec3 q = g - vec3(c) * cell;
+	vec3 border = min(q, cell - q);
+	float d = margin + min(border.x, min(border.y, border.z));
+
+	int index = (c.z * BODY_GRID_CELLS.y + c.y) * BODY_GRID_CELLS.x + c.x;
+	int last = int(texelFetch(bodyGrid, index + 1).x);
+	for (int k = int(texelFetch(bodyGrid, index).x); k < last; k++)
+	{
+		vec4 b = texelFetch(bodies, int(texelFetch(bodyGrid, k).x));
+		d = min(d, length(pos - b.xyz) - b.w);
+	}
+
+	return d;
+}
+
+// Ground plane with the Sculpt edits, the baked bricks where there are any, same as Sculpt.Distance.
+// Bricks hold no edit farther than the margin, so out of them the field is at most the margin.
+float mapSculpt(in vec3 pos)
+{
+	float d = sdPlaneY(pos);
+	if (g_sculptLo.w == 0.0)
+		return d;
+
+	// out of the bricks by a, the edits are the margin farther
+	float a = sdBox(pos - 0.5 * (g_sculptLo.xyz + g_sculptHi.xyz), 0.5 * (g_sculptHi.xyz - g_sculptLo.xyz));
+	if (a > 0.0)
+		return min(d, a + SCULPT_MARGIN);
+
+	vec3 g = (pos - SCULPT_ORIGIN) / SCULPT_BRICK;
+	ivec3 b = min(ivec3(g), SCULPT_BRICKS - 1);
+	int slot = int(texelFetch(sculptMap, b, 0).x) - 1;
+	if (slot < 0)
+		return min(d, SCULPT_MARGIN);
+
+	// the texture unit interpolates between the corner samples of the brick
+	ivec3 atlas = ivec3(slot, slot / SCULPT_ATLAS_BRICKS, slot / (SCULPT_ATLAS_BRICKS * SCULPT_ATLAS_BRICKS)) % SCULPT_ATLAS_BRICKS;
+	vec3 texel = vec3(atlas * SCULPT_SAMPLES) + 0.5 + (g - vec3(b)) * float(SCULPT_BRICK_CELLS);
+
+	return texture(sculptAtlas, texel / float(SCULPT_ATLAS_BRICKS * SCULPT_SAMPLES)).x;
+}
+
+// Scene without the bodies, it changes only with the SdElements and the Sculpt
+vec2 mapStatic(in vec3 pos)
+{
+	vec2 res = vec2(mapSculpt(pos), 1.0);
+
+	vec3 prep = opRep(pos, vec3(10.0));
+
+	res.x =
+		opA(
+			res.x,
+			sdSphere(prep, g_map[0].x));
+
+	prep = opRep(pos, vec3(7.0, 0.0, 9.0));
+
+	res.x =
+		opA(
+			res.x,
+			sdBox(prep, g_map[0].yzw));
+
+	prep = opRep(pos, vec3(12.0, 0.0, 13.0));
+
+	res.x =
+		opA(
+			res.x,
+			sdCylinder(prep, 1.0, 30.0));
+
+	res.x =
+		opA(
+			res.x,
+			mapElements(pos));
+
+	res.y = 45.0;
+
+	return res;
+}
+
+vec2 map(in vec3 pos)
+{
+	vec2 res = mapStatic(pos);
+
+	res.x =
+		opA(
+			res.x,
+			mapBodies(pos));
+
+	return res;
+}
+
+// Interval bound of map() ----------------------------------------------
+
+// Smallest |opRep(x, c)| over x in [lo, hi], c == 0 leaves the axis unrepeated
+float minAbsRep(float lo, float hi, float c)
+{
+	if (c == 0.0)
+		return lo > 0.0 ? lo : (hi < 0.0 ? -hi : 0.0);
+
+	if (hi - lo >= c)
+		return 0.0;
+
+	float a = mod(lo, c) - 0.5 * c;
+	float b = mod(hi, c) - 0.5 * c;
+
+	if (a <= b)	// inside one cell
+		return a > 0.0 ? a : (b < 0.0 ? -b : 0.0);
+
+	// crosses the cell border at +-c/2
+	return min(max(a, 0.0), max(-b, 0.0));
+}
+
+vec3 minAbsRep(vec3 lo, vec3 hi, vec3 c)
+{
+	return vec3(
+		minAbsRep(lo.x, hi.x, c.x),
+		minAbsRep(lo.y, hi.y, c.y),
+		minAbsRep(lo.z, hi.z, c.z));
+}
+
+// Lower bound of map().x over the box [lo, hi], keep in sync with map().
+// The primitives are symmetric and grow with |p| per axis, so feeding them
+// the smallest |p| of the box bounds them from below.
+float mapLower(in vec3 lo, in vec3 hi)
+{
+	float d = lo.y;
+
+	// the edited ground may rise anywhere in its bricks
+	if (g_sculptLo.w != 0.0)
+		d = min(d, length(max(max(lo - g_sculptHi.xyz, g_sculptLo.xyz - hi), 0.0)));
+
+	d = min(d, sdSphere(minAbsRep(lo, hi, vec3(10.0)), g_map[0].x));
+	d = min(d, sdBox(minAbsRep(lo, hi, vec3(7.0, 0.0, 9.0)), g_map[0].yzw));
+	d = min(d, sdCylinder(minAbsRep(lo, hi, vec3(12.0, 0.0, 13.0)), 1.0, 30.0));
+
+	int n = elementCount();
+	for (int i = 0; i < n; i++)
+	{
+		vec4 b = elementBounds(i);
+		d = min(d, length(max(max(lo - b.xyz, b.xyz - hi), 0.0)) - b.w);
+	}
+
+	// bodies stay the margin inside their grid
+	if (uBodyCount > 0)
+	{
+		vec3 gridLo = uBodyGrid.xyz + 0.5 * uBodyGrid.w;
+		vec3 gridHi = uBodyGrid.xyz + (vec3(BODY_GRID_CELLS) - 0.5) * uBodyGrid.w;
+		d = min(d, length(max(max(lo - gridHi, gridLo - hi), 0.0)));
+	}
+
+	return d;
+}
+
+float cullSegmentDepth(int i)
+{
+	float s = float(i) / float(CULL_SEGMENTS);
+	return MARCH_MAX_DIST * s * s;
+}
+
+// Primary ray range, narrowed by the tile culling
+float g_rayStart = 0.0;
+float g_rayEnd = MARCH_MAX_DIST;
+
+void tileRangeSelect(in ivec2 pixel, in vec3 rd)
+{
+	if (uTileCulling == 0)
+		return;
+
+	// depth along the view axis to distance along the ray
+	vec2 range = texelFetch(tileRanges, pixel / BIN_TILE_SIZE, 0).xy / dot(rd, camProj[2]);
+
+	g_rayStart = min(range.x, MARCH_MAX_DIST);
+	g_rayEnd = min(range.y, MARCH_MAX_DIST);
+}
+
+//----------------------------------------------------------------------
+
+// Relaxed (over-stepping) sphere tracing split into resumable steps,
+// so a march can be suspended and continued by the compute marcher.
+struct March
+{
+	float t;
+	float overstep;
+	float phx;	// previous step distance
+	int i;
+	vec2 h;		// last map() sample
+};
+
+March marchBegin()
+{
+	g_rasterElements = uRasterElements != 0;
+	return March(g_rayStart, 0.0, MARCH_MAX_DIST, 0, vec2(1.0));
+}
+
+bool marchActive(in March m)
+{
+	return m.i < MARCH_MAX_STEPS && m.t < g_rayEnd && m.h.x >= MARCH_MIN_DIST;
+}
+
+// castRay() output, a ray leaving a culled range sees nothing up to the far plane
+vec2 marchResult(in March m)
+{
+	g_rasterElements = false;
+
+	if (m.t >= g_rayEnd && m.h.x >= MARCH_MIN_DIST)
+		return vec2(max(m.t, MARCH_MAX_DIST), m.h.y);
+
+	return vec2(m.t, m.h.y);
+}
+
+void marchStep(in vec3 ro, in vec3 rd, inout March m)
+{
+	m.h = map(ro + rd * m.t);
+
+	if (m.h.x > m.overstep)
+	{
+		m.overstep = m.h.x * min(1.0, 0.5 * m.h.x / m.phx);
+		m.t += m.h.x * 0.5 + m.overstep;
+		m.phx = m.h.x;
+		m.i++;
+	}
+	else
+	{
+		m.t -= m.overstep;
+		m.phx = MARCH_MAX_DIST;
+		m.h.x = 1.0;
+		m.overstep = 0.0;
+	}
+}
+
+vec2 castRay(in vec3 ro, in vec3 rd)
+{
+	March m = marchBegin();
+
+	while (marchActive(m))
+		marchStep(ro, rd, m);
+
+	return marchResult(m);
+}
+
+// classic
+vec2 castRay2(in vec3 ro, in vec3 rd)
+{
+	//TODO move to external constants w/ uniq names
+	const float MAX_DIST = 1000;
+	const float MIN_DIST = 0.0002;
+	const int MAX_RAY_STEPS = 100;
+
+	float t = 0.0;
+	vec2 h = vec2(1.0);
+
+	int i = 0;
+	while(i < MAX_RAY_STEPS && t < MAX_DIST)
+	{
+		h = map(ro + rd * t);
+
+		if (h.x < MIN_DIST)
+			break;
+
+		t += h.x;
+
+		i++;
+	}
+
+	if (t > MAX_DIST)
+		h.y = -1.0;
+
+	return vec2(t, h.y);
+}
+
+// TODO generalize over map() it similar
+float softshadow(in vec3 ro, in vec3 rd)
+{
+	const float INIT_T = 0.02;
+	const float INIT_RES = 0.1;
+	const float MAX_DIST = 25;
+	const float MIN_DIST = 0.001;
+	const int MAX_RAY_STEPS = 256;		// higher -> longer shadow distance
+	const float SHADOW_SMOOTH = 8.0;	// lower ~ smother, higher -> sharper
+
+	float res = 1.0;
+	float t = INIT_T;
+	for (int i = 0; i < MAX_RAY_STEPS; i++)
+	{
+		float h = map(ro + rd * t).x;
+		res = min(res, SHADOW_SMOOTH * h / t);
+		t += clamp(h, INIT_T, INIT_RES);
+		if (h < MIN_DIST || t > MAX_DIST) break;
+	}
+
+	return clamp(res, 0.0, 1.0);
+
+}
+
+// Orthographic frame of the shadow map, z along the light
+mat3 shadowBasis(in vec3 lig)
+{
+	vec3 up = abs(lig.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+	vec3 u = normalize(cross(up, lig));
+	return mat3(u, cross(lig, u), lig);
+}
+
+// Ray origin of a shadow map texel, uv in [0, 1]
+vec3 shadowMapOrigin(in vec2 uv)
+{
+	return g_shadowCenter.xyz + shadowBasis(g_shadowLight.xyz) * vec3((2.0 * uv - 1.0) * g_shadowCenter.w, SHADOW_MAP_HEIGHT);
+}
+
+// xy - uv of the point in the shadow map, z - its distance from the plane of the ray origins
+vec3 shadowMapCoord(in vec3 pos)
+{
+	vec3 d = (pos - g_shadowCenter.xyz) * shadowBasis(g_shadowLight.xyz);
+	return vec3(0.5 + 0.5 * d.xy / g_shadowCenter.w, SHADOW_MAP_HEIGHT - d.z);
+}
+
+// The ray of a shadow map texel runs down the shadow ray of its first hit, so the map
+// stores softshadow() of the hit and the lookup only tells whether the point is that hit.
+// Bilinear between the four nearest texels, hidden ones count as umbra.
+float shadowMapLookup(in vec3 pos, in vec3 nor)
+{
+	ivec2 size = textureSize(shadowMap, 0);
+	float texel = 2.0 * g_shadowCenter.w / float(size.x);
+
+	vec3 c = shadowMapCoord(pos + nor * SHADOW_MAP_NORMAL_OFFSET * texel);
+	vec2 p = c.xy * vec2(size) - 0.5;
+	ivec2 base = ivec2(floor(p));
+	vec2 f = p - vec2(base);
+	float depth = c.z - SHADOW_MAP_BIAS * texel;
+
+	vec4 lit;
+	for (int i = 0; i < 4; i++)
+	{
+		vec2 s = texelFetch(shadowMap, clamp(base + ivec2(i & 1, i >> 1), ivec2(0), size - 1), 0).xy;
+		lit[i] = s.x >= depth ? s.y : 0.0;
+	}
+
+	return mix(mix(lit.x, lit.y, f.x), mix(lit.z, lit.w, f.x), f.y);
+}
+
+// Shadow towards g_light: the cached shadow map where it covers the point, softshadow() elsewhere
+float shadow(in vec3 pos, in vec3 nor)
+{
+	if (g_shadowLight.w > 0.0)
+	{
+		vec2 uv = shadowMapCoord(pos).xy;
+		if (all(greaterThan(uv, vec2(0.0))) && all(lessThan(uv, vec2(1.0))))
+			return shadowMapLookup(pos, nor);
+	}
+
+	return softshadow(pos, g_light.xyz);
+}
+
+//vec3 calcNormal2(in vec3 p)
+//{
+//	return normalize(cross(dFdx(p), dFdy(p)));
+//}
+
+vec3 calcNormal(in vec3 pos)
+{
+	vec3 eps = vec3(0.001, 0.0, 0.0);
+	vec3 nor = vec3(
+		map(pos + eps.xyy).x - map(pos - eps.xyy).x,
+		map(pos + eps.yxy).x - map(pos - eps.yxy).x,
+		map(pos + eps.yyx).x - map(pos - eps.yyx).x);
+	return normalize(nor);
+}
+
+// Ambient occlusion from a few map() samples along the normal
+const int AO_SCENE = 0;
+const int AO_STATIC = 1;
+const int AO_BODIES = 2;
+
+// occluders - AO_SCENE, AO_STATIC or AO_BODIES
+float calcAO(in vec3 pos, in vec3 nor, in int occluders)
+{
+	float occ = 0.0;
+	float sca = 1.0;
+
+	for (int i = 0; i < 5; i++)
+	{
+		float hr = 0.01 + 0.12 * float(i) / 4.0;
+		vec3 p = nor * hr + pos;
+		float dd = occluders == AO_STATIC ? mapStatic(p).x : occluders == AO_BODIES ? mapBodies(p) : map(p).x;
+		occ += -(dd - hr) * sca;
+		sca *= 0.95;
+	}
+
+	return clamp(1.0 - 3.0 * occ, 0.0, 1.0);
+}
+
+float calcAO(in vec3 pos, in vec3 nor)
+{
+	return calcAO(pos, nor, AO_SCENE);
+}
+
+// Generation and wrap of the window a cached cell was filled for, the texel is shared by
+// every cell AO_CACHE_CELLS apart
+uint aoCacheStamp(in ivec3 cell)
+{
+	ivec3 wrap = cell >> AO_CACHE_SHIFT;
+	return (uint(g_aoCache.w) << 20) | (uint(wrap.z & 63) << 14) | (uint(wrap.x & 63) << 8);
+}
+
+bool aoCacheInside(in ivec3 lo, in ivec3 hi)
+{
+	ivec3 first = ivec3(g_aoCache.xyz);
+	return all(greaterThanEqual(lo, first)) && all(lessThan(hi, first + AO_CACHE_CELLS));
+}
+
+// Trilinear AO of the static scene, false while a corner of the cell is not filled
+bool aoCacheLookup(in vec3 pos, out float occ)
+{
+	vec3 p = pos / AO_CACHE_CELL;
+	ivec3 base = ivec3(floor(p));
+	vec3 f = p - vec3(base);
+	occ = 1.0;
+
+	if (!aoCacheInside(base, base + 1))
+		return false;
+
+	float v[8];
+	for (int i = 0; i < 8; i++)
+	{
+		ivec3 c = base + ivec3(i & 1, (i >> 1) & 1, i >> 2);
+		uint e = texelFetch(aoCache, c & (AO_CACHE_CELLS - 1), 0).x;
+
+		if ((e & (AO_CACHE_FILLED | AO_CACHE_STAMP)) != (AO_CACHE_FILLED | aoCacheStamp(c)))
+			return false;
+
+		v[i] = float(e & 0xffu) / 255.0;
+	}
+
+	occ = mix(
+		mix(mix(v[0], v[1], f.x), mix(v[2], v[3], f.x), f.y),
+		mix(mix(v[4], v[5], f.x), mix(v[6], v[7], f.x), f.y),
+		f.z);
+	return true;
+}
+
+// calcAO(), the static scene from the cache where it is filled, the moving bodies always live
+float occlusion(in vec3 pos, in vec3 nor)
+{
+	float occ;
+	if (g_aoCache.w > 0.0 && aoCacheLookup(pos, occ))
+		return uBodyCount > 0 ? occ * calcAO(pos, nor, AO_BODIES) : occ;
+
+	return calcAO(pos, nor);
+}
+
+// Lighting of a surface point at ray distance t, sha and occ are shadow() and occlusion(),
+// occ is 1 on the forward paths, AO is left to the deferred passes
+vec3 light(in vec3 rd, in float t, in vec3 nor, in float sha, in float occ)
+{
+	vec3 col = vec3(1.0);
+	vec3 ref = reflect(rd, nor);
+
+	// lighitng
+	vec3  lig = g_light.xyz;
+	//vec3  lig = normalize(vec3(-0.6, 0.7, -0.5));
+	float amb = clamp(0.5 + 0.5 * nor.y, 0.0, 1.0);
+	float dif = clamp(dot(nor, lig), 0.0, 1.0);
+	float spe = pow(clamp(dot(ref, lig), 0.0, 1.0), 16.0);
+
+	dif *= sha;
+
+	vec3 lin = vec3(0.0);
+	lin += dif;
+	lin += 1.20 * spe *dif;
+	lin += 0.20 * amb * occ;
+	col *= lin;
+
+	col = mix(col, vec3(0.8, 0.9, 1.0), 1.0 - exp(-0.002 * t * t));	// distance fog
+
+	return vec3(clamp(col, 0.0, 1.0));
+}
+
+// Lighting of an already marched ray, res is castRay() output
+vec3 shade(in vec3 ro, in vec3 rd, in vec2 res)
+{
+	float t = res.x;
+	vec3 pos = ro + t * rd;
+	vec3 nor = calcNormal(pos);
+
+	return light(rd, t, nor, shadow(pos, nor), 1.0);
+}
+
+mat3 setCamera(in vec3 ro, in vec3 ta)
+{
+	const vec3 up = vec3(0.0, 1.0, 0.0);
+
+	vec3 cw = normalize(ta - ro);
+	vec3 cu = normalize(cross(cw, up));
+	vec3 cv = normalize(cross(cu, cw));
+
+	return mat3(cu, cv, cw);
+}
+
+// World space direction of the camera ray through a pixel
+vec3 cameraRay(in vec2 fragCoord)
+{
+	vec2 q = (fragCoord.xy + uJitter) / iResolution.xy;
+	vec2 p = -1.0 + 2.0 * q;
+	p.x *= iResolution.x / iResolution.y;
+	return camProj * normalize(vec3(p.xy, 2.0));
+}
+
+// Window depth of a hit at ray distance t in the camera projection, the far plane on a miss
+float rayDepth(in vec3 rd, in float t)
+{
+	if (t >= MARCH_MAX_DIST)
+		return 1.0;
+
+	float z = clamp(t * dot(rd, camProj[2]), RASTER_NEAR, RASTER_FAR);
+	return RASTER_FAR * (z - RASTER_NEAR) / (z * (RASTER_FAR - RASTER_NEAR));
+}
+
+// Clip position of a world point, the inverse of cameraRay() with the jitter of the sample
+// and the depth of rayDepth(), so rasterized and marched surfaces meet in the depth test
+vec4 cameraClip(in vec3 pos)
+{
+	vec3 v = transpose(camProj) * (pos - ro);
+	vec2 p = 2.0 * v.xy;
+	p.x /= iResolution.x / iResolution.y;
+	p -= 2.0 * uJitter / iResolution.xy * v.z;
+
+	float a = (RASTER_FAR + RASTER_NEAR) / (RASTER_FAR - RASTER_NEAR);
+	float b = -2.0 * RASTER_FAR * RASTER_NEAR / (RASTER_FAR - RASTER_NEAR);
+	return vec4(p, a * v.z + b, v.z);
+}
+
+vec3 tint(in vec3 col)
+{
+	return pow(col, vec3(0.8545));
+}
@@ -0,0 +1,27 @@
+﻿#version 330 core
+
+// One quad per instance of Hud: a glyph of the atlas or a solid rectangle
+
+#define CELL vec2(6.0, 8.0)	// HudFont.CELL_WIDTH, CELL_HEIGHT
+
+layout(location = 0) in ivec4 aInstance;	// x | y << 16, width | height << 16 in pixels from the top left, glyph, rgba8
+
+uniform vec2 uResolution;
+
+out vec2 vCell;			// position in the atlas cell
+flat out int vGlyph;	// -1 is a solid rectangle
+flat out vec4 vColor;
+
+void main()
+{
+	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+	vec2 pos = vec2(aInstance.x & 0xffff, aInstance.x >> 16);
+	vec2 size = vec2(aInstance.y & 0xffff, aInstance.y >> 16);
+	vec2 p = (pos + corner * size) / uResolution;
+
+	gl_Position = vec4(p.x * 2.0 - 1.0, 1.0 - p.y * 2.0, 0.0, 1.0);
+
+	vCell = corner * CELL;
+	vGlyph = aInstance.z;
+	vColor = vec4((aInstance.www >> ivec3(0, 8, 16)) & 0xff, (aInstance.w >> 24) & 0xff) / 255.0;
+}
@@ -0,0 +1,32 @@
+﻿#version 330 core
+
+// Unit meshes of MeshPass, one instance per element of the SdElements block. The vertex
+// is placed like sdElement() places the primitive and projected by cameraClip().
+
+#include "scene.c"
+
+layout(location = 0) in vec3 aPosition;	// unit sphere, box or cylinder
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in int aElement;	// per instance, index of the element
+
+out vec3 vPos;
+out vec3 vNormal;
+flat out int vElement;
+
+// the depth prepass and the lit pass are separate programs and must rasterize the same depth
+invariant gl_Position;
+
+void main()
+{
+	vec4 a = g_map[SD_ELEMENTS_OFFSET + 2 * aElement];		// position, type
+	vec4 b = g_map[SD_ELEMENTS_OFFSET + 2 * aElement + 1];	// size, bounding radius
+	int type = int(a.w);
+
+	vec3 scale = type == SD_SPHERE ? b.xxx : type == SD_BOX ? b.xyz : b.xyx;
+
+	vPos = a.xyz + aPosition * scale;
+	vNormal = aNormal / scale;	// inverse transpose of the scale
+	vElement = aElement;
+
+	gl_Position = cameraClip(vPos);
+}
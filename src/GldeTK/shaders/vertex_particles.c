@@ -0,0 +1,29 @@
+﻿#version 430
+
+// Particles drawn as points straight from the state buffer of compute_particles.c
+
+#include "scene.c"
+#include "particles.c"
+
+layout(std430, binding = 6) readonly buffer ParticlesIn
+{
+	Particle particles[];
+};
+
+out float vDistance;	// along the camera ray, compared with the marched distance
+
+void main()
+{
+	vec3 pos = particles[gl_VertexID].pos.xyz;
+
+	// inverse of cameraRay(), camProj is orthonormal
+	vec3 v = transpose(camProj) * (pos - ro);
+	vec2 p = 2.0 * v.xy;
+	p.x /= iResolution.x / iResolution.y;
+
+	// behind the camera w < 0 and the point is clipped
+	gl_Position = vec4(p, 0.0, v.z);
+	gl_PointSize = clamp(2.0 * PARTICLE_RADIUS * iResolution.y / v.z, 1.0, PARTICLE_MAX_POINT);
+
+	vDistance = length(pos - ro);
+}